@@ -0,0 +1,462 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cpprest/http_client.h>
+#include <nlohmann/json.hpp>
+
+#include "polling_scheduler.h"
+#include "transcription_models.h"
+
+// Keeps one http_client per scheme/host/port, so that all requests to the same host share
+// the client's pooled, kept-alive connections instead of setting up a new connection each time.
+class HttpClientPool
+{
+public:
+    explicit HttpClientPool(const web::http::client::http_client_config& config = web::http::client::http_client_config())
+        : m_config(config)
+    {
+    }
+
+    // Sends a request to an absolute URI through the pooled client of its host.
+    pplx::task<web::http::http_response> Request(const web::uri& absoluteUri, web::http::http_request request)
+    {
+        request.set_request_uri(absoluteUri.resource());
+        return ClientFor(absoluteUri).request(request);
+    }
+
+    size_t HostCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_clients.size();
+    }
+
+private:
+    web::http::client::http_client& ClientFor(const web::uri& absoluteUri)
+    {
+        auto authority = absoluteUri.authority();
+        auto key = authority.to_string();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_clients.find(key);
+        if (it == m_clients.end())
+        {
+            it = m_clients.emplace(key, std::make_unique<web::http::client::http_client>(authority, m_config)).first;
+        }
+        return *it->second;
+    }
+
+    web::http::client::http_client_config m_config;
+    mutable std::mutex m_mutex;
+    std::map<utility::string_t, std::unique_ptr<web::http::client::http_client>> m_clients;
+};
+
+// Settings of the batch transcription client.
+struct BatchTranscriptionOptions
+{
+    // The transcriptions endpoint, e.g. https://<region>.cris.ai/api/speechtotext/v2.0/Transcriptions/.
+    // Point it to a local mock HTTP server for testing, e.g. samples/cpp/mock-speech-service/mock_transcription_service.py
+    // at http://localhost:8081/api/speechtotext/v2.0/Transcriptions/.
+    utility::string_t ServiceUrl;
+    utility::string_t SubscriptionKey;
+
+    // Maximum number of transcriptions that are submitted to the service and not yet completed.
+    size_t MaxConcurrentJobs = 16;
+
+    // Picks the delay between two status checks of a transcription.
+    PollingPolicy Polling;
+
+    // Status checks that fall due within the same timer tick are sent together in one wake-up.
+    std::chrono::milliseconds TimerResolution{ 250 };
+    size_t TimerSlots = 512;
+};
+
+// State of a single transcription tracked by the client.
+struct TranscriptionJob
+{
+    TranscriptionJob(size_t index, const TranscriptionDefinition& definition)
+        : Index(index), Definition(definition)
+    {
+    }
+
+    // Position of the definition in the submitted batch.
+    size_t Index;
+    TranscriptionDefinition Definition;
+
+    // The transcription status location returned by the service.
+    utility::string_t Location;
+
+    // The last status fetched from the service.
+    Transcription Status;
+
+    // Polling state and the delay before the next status check.
+    PollingPolicy::State Polling;
+    std::chrono::milliseconds NextPollDelay{ 0 };
+
+    bool Completed = false;
+    bool Succeeded = false;
+
+    // Describes why the transcription could not be submitted or tracked.
+    std::string Error;
+};
+
+// Submits many transcription definitions with bounded concurrency, and tracks all outstanding
+// transcriptions from a single scheduler loop. Status checks are scheduled on a timer wheel with
+// per-job adaptive intervals, and checks that fall due together are sent in one batch.
+// Requests to the same host reuse pooled connections.
+class BatchTranscriptionClient
+{
+public:
+    using JobCompletedCallback = std::function<void(const TranscriptionJob&)>;
+
+    explicit BatchTranscriptionClient(const BatchTranscriptionOptions& options)
+        : m_options(options)
+    {
+        if (m_options.MaxConcurrentJobs == 0)
+        {
+            throw std::invalid_argument("MaxConcurrentJobs must be greater than 0.");
+        }
+    }
+
+    // Submits all definitions and blocks until every transcription has completed or failed, and onCompleted has
+    // been called for it. onCompleted is called once per definition on a separate thread, one call at a time, so
+    // that processing a result, e.g. downloading it, does not hold up the submissions and status checks of the
+    // other jobs. If onCompleted throws, it is not called for further jobs, and Run() rethrows the exception.
+    void Run(const std::vector<TranscriptionDefinition>& definitions, const JobCompletedCallback& onCompleted)
+    {
+        using Clock = TimerWheel<std::shared_ptr<TranscriptionJob>>::Clock;
+
+        CompletionQueue completions(onCompleted);
+
+        std::deque<std::shared_ptr<TranscriptionJob>> pending;
+        for (size_t i = 0; i < definitions.size(); i++)
+        {
+            pending.push_back(std::make_shared<TranscriptionJob>(i, definitions[i]));
+        }
+
+        TimerWheel<std::shared_ptr<TranscriptionJob>> wheel(m_options.TimerResolution, m_options.TimerSlots);
+        size_t active = 0;
+
+        // Reports completed jobs, which frees their slots, and schedules the next check of all others.
+        auto retire = [&](const std::vector<std::shared_ptr<TranscriptionJob>>& jobs)
+        {
+            auto now = Clock::now();
+            for (const auto& job : jobs)
+            {
+                if (job->Completed)
+                {
+                    active--;
+                    completions.Post(job);
+                }
+                else
+                {
+                    wheel.Schedule(job, now + job->NextPollDelay);
+                }
+            }
+        };
+
+        while (!pending.empty() || active > 0)
+        {
+            // Fill the free slots with new submissions.
+            std::vector<std::shared_ptr<TranscriptionJob>> submitted;
+            while (!pending.empty() && active + submitted.size() < m_options.MaxConcurrentJobs)
+            {
+                submitted.push_back(pending.front());
+                pending.pop_front();
+            }
+            WaitAll(submitted, [this](const std::shared_ptr<TranscriptionJob>& job) { return SubmitAsync(job); });
+            active += submitted.size();
+            retire(submitted);
+
+            if (wheel.Empty())
+            {
+                continue;
+            }
+
+            // Sleep until the next check falls due, then send all checks that are due in one batch.
+            std::this_thread::sleep_until(wheel.NextDue());
+            // Jobs without a status location were throttled on submission, and are submitted again.
+            auto due = wheel.Advance(Clock::now());
+            WaitAll(due, [this](const std::shared_ptr<TranscriptionJob>& job) { return job->Location.empty() ? SubmitAsync(job) : PollAsync(job); });
+            retire(due);
+        }
+        completions.Finish();
+    }
+
+    // Downloads a result file through the pooled connections.
+    std::string FetchResult(const std::string& resultUrl)
+    {
+        auto response = m_httpClients.Request(web::uri(utility::conversions::to_string_t(resultUrl)), CreateRequest(web::http::methods::GET)).get();
+        if (response.status_code() != web::http::status_codes::OK)
+        {
+            throw std::runtime_error("Fetching the transcription result returned unexpected http code " + std::to_string(response.status_code()));
+        }
+        return response.extract_utf8string().get();
+    }
+
+    // Gives access to the pooled connections, e.g. to stream result bodies.
+    HttpClientPool& HttpClients()
+    {
+        return m_httpClients;
+    }
+
+    web::http::http_request CreateRequest(const web::http::method& method) const
+    {
+        web::http::http_request request(method);
+        request.headers().add(U("Ocp-Apim-Subscription-Key"), m_options.SubscriptionKey);
+        return request;
+    }
+
+private:
+    // Calls the completion callback for the completed jobs on a dedicated thread, in the order they completed.
+    class CompletionQueue final
+    {
+    public:
+        explicit CompletionQueue(const JobCompletedCallback& onCompleted)
+            : m_onCompleted(onCompleted), m_thread([this]() { Process(); })
+        {
+        }
+
+        CompletionQueue(const CompletionQueue&) = delete;
+        CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+        ~CompletionQueue()
+        {
+            Stop();
+        }
+
+        void Post(std::shared_ptr<TranscriptionJob> job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(std::move(job));
+            }
+            m_wakeUp.notify_one();
+        }
+
+        // Waits until the callback was called for all posted jobs. Rethrows the exception of the callback, if any.
+        void Finish()
+        {
+            Stop();
+            if (m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+        }
+
+    private:
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wakeUp.notify_one();
+            if (m_thread.joinable())
+            {
+                m_thread.join();
+            }
+        }
+
+        void Process()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;)
+            {
+                m_wakeUp.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty())
+                {
+                    return;
+                }
+                auto job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+
+                lock.unlock();
+                if (!m_error)
+                {
+                    try
+                    {
+                        m_onCompleted(*job);
+                    }
+                    catch (...)
+                    {
+                        m_error = std::current_exception();
+                    }
+                }
+                lock.lock();
+            }
+        }
+
+        const JobCompletedCallback& m_onCompleted;
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::deque<std::shared_ptr<TranscriptionJob>> m_jobs;
+        bool m_stopping = false;
+        // Written by the thread only, and read after it was joined.
+        std::exception_ptr m_error;
+        std::thread m_thread;
+    };
+
+    template<class StartFunction>
+    static void WaitAll(const std::vector<std::shared_ptr<TranscriptionJob>>& jobs, StartFunction start)
+    {
+        std::vector<pplx::task<void>> tasks;
+        tasks.reserve(jobs.size());
+        for (const auto& job : jobs)
+        {
+            tasks.push_back(start(job));
+        }
+        if (!tasks.empty())
+        {
+            pplx::when_all(tasks.begin(), tasks.end()).wait();
+        }
+    }
+
+    static void Fail(TranscriptionJob& job, const std::string& error)
+    {
+        job.Completed = true;
+        job.Succeeded = false;
+        job.Error = error;
+    }
+
+    pplx::task<void> SubmitAsync(std::shared_ptr<TranscriptionJob> job)
+    {
+        auto request = CreateRequest(web::http::methods::POST);
+        nlohmann::json definitionJSON = job->Definition;
+        request.set_body(definitionJSON.dump(), "application/json");
+
+        pplx::task<web::http::http_response> responseTask;
+        try
+        {
+            responseTask = m_httpClients.Request(web::uri(m_options.ServiceUrl), request);
+        }
+        catch (const std::exception& e)
+        {
+            // E.g. a malformed service URL, which web::uri rejects before any request is sent.
+            Fail(*job, std::string("Failed to send the transcription: ") + e.what());
+            return pplx::task_from_result();
+        }
+        return responseTask.then([this, job](pplx::task<web::http::http_response> task)
+        {
+            try
+            {
+                auto response = task.get();
+                auto retryAfter = RetryAfterSeconds(response);
+
+                // The service is throttling or temporarily unavailable, so submit again later. The job keeps its
+                // slot meanwhile, which holds back further submissions.
+                if (response.status_code() == 429 || response.status_code() == web::http::status_codes::ServiceUnavailable)
+                {
+                    job->NextPollDelay = m_options.Polling.NextDelay(job->Polling, "Submitting", retryAfter);
+                    return;
+                }
+                if (response.status_code() != web::http::status_codes::Accepted)
+                {
+                    Fail(*job, "Unexpected status code " + std::to_string(response.status_code()));
+                    return;
+                }
+                job->Location = response.headers()[U("location")];
+                if (job->Location.empty())
+                {
+                    Fail(*job, "The service did not return the location of the transcription.");
+                    return;
+                }
+                job->NextPollDelay = m_options.Polling.InitialDelay(job->Polling);
+
+                // The service may already tell when the status is worth checking.
+                if (retryAfter >= 0)
+                {
+                    job->NextPollDelay = std::chrono::seconds(retryAfter);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                Fail(*job, e.what());
+            }
+        });
+    }
+
+    pplx::task<void> PollAsync(std::shared_ptr<TranscriptionJob> job)
+    {
+        pplx::task<web::http::http_response> responseTask;
+        try
+        {
+            responseTask = m_httpClients.Request(web::uri(job->Location), CreateRequest(web::http::methods::GET));
+        }
+        catch (const std::exception& e)
+        {
+            // E.g. a malformed Location header returned by the service.
+            Fail(*job, std::string("Failed to check the transcription status: ") + e.what());
+            return pplx::task_from_result();
+        }
+        return responseTask.then([this, job](pplx::task<web::http::http_response> task)
+        {
+            try
+            {
+                auto response = task.get();
+                auto retryAfter = RetryAfterSeconds(response);
+
+                // The service is throttling or temporarily unavailable, so check again later.
+                if (response.status_code() == 429 || response.status_code() == web::http::status_codes::ServiceUnavailable)
+                {
+                    job->NextPollDelay = m_options.Polling.NextDelay(job->Polling, job->Polling.LastStatus, retryAfter);
+                    return;
+                }
+                if (response.status_code() != web::http::status_codes::OK)
+                {
+                    Fail(*job, "Fetching the transcription returned unexpected http code " + std::to_string(response.status_code()));
+                    return;
+                }
+
+                auto statusJSON = nlohmann::json::parse(response.extract_utf8string().get());
+                job->Status = statusJSON;
+
+                if (!_stricmp(job->Status.status.c_str(), "Failed"))
+                {
+                    Fail(*job, job->Status.statusMessage);
+                }
+                else if (!_stricmp(job->Status.status.c_str(), "Succeeded"))
+                {
+                    job->Completed = true;
+                    job->Succeeded = true;
+                }
+                else
+                {
+                    job->NextPollDelay = m_options.Polling.NextDelay(job->Polling, job->Status.status, retryAfter);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                Fail(*job, e.what());
+            }
+        });
+    }
+
+    // Returns the delay-seconds value of the Retry-After header, or -1 if there is none.
+    static int RetryAfterSeconds(const web::http::http_response& response)
+    {
+        auto it = response.headers().find(U("Retry-After"));
+        if (it == response.headers().end())
+        {
+            return -1;
+        }
+        return PollingPolicy::ParseRetryAfter(utility::conversions::to_utf8string(it->second));
+    }
+
+    BatchTranscriptionOptions m_options;
+    HttpClientPool m_httpClients;
+};
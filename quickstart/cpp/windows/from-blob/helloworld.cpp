@@ -9,12 +9,22 @@
 #include <Windows.h>
 #include <locale>
 #include <codecvt>
+#include <fstream>
 #include <string>
+#include <vector>
 
 #include <cpprest/http_client.h>
 #include <cpprest/filestream.h>
 #include <nlohmann/json.hpp>
 
+#include "transcription_models.h"
+#include "batch_transcription_client.h"
+#include "transcription_result_parser.h"
+#include "transcription_result_store.h"
+#include "result_store_benchmark.h"
+#include "transcription_result_v3.h"
+#include "transcription_result_v3_benchmark.h"
+
 using namespace std;
 using namespace utility;                    // Common utilities like string conversions
 using namespace web;                        // Common features like URIs.
@@ -28,233 +38,49 @@ const string_t subscriptionKey = U("YourSubscriptionKey");
 const string name = "Simple transcription";
 const string description = "Simple transcription description";
 const string myLocale = "en-US";
-const string recordingsBlobUri = "YourFileUrl";
-
-class TranscriptionDefinition {
-private:
-    TranscriptionDefinition(string name,
-        string description,
-        string locale,
-        string recordingsUrl,
-        std::list<string> models) {
-
-        Name = name;
-        Description = description;
-        RecordingsUrl = recordingsUrl;
-        Locale = locale;
-        Models = models;
-    }
-
-public:
-    string Name;
-    string Description;
-    string RecordingsUrl;
-    string Locale;
-    std::list<string> Models;
-    std::map<string, string> properties;
-
-    static TranscriptionDefinition Create(string name, string description, string locale, string recordingsUrl) {
-        return TranscriptionDefinition(name, description, locale, recordingsUrl, std::list<string>());
-    }
-    static TranscriptionDefinition Create(string name, string description, string locale, string recordingsUrl,
-        std::list<string> models) {
-        return TranscriptionDefinition(name, description, locale, recordingsUrl, models);
-    }
-};
-
-void to_json(nlohmann::json& j, const TranscriptionDefinition& t) {
-    j = nlohmann::json{
-            { "description", t.Description },
-            { "locale", t.Locale },
-            { "models", t.Models },
-            { "name", t.Name },
-            { "properties", t.properties },
-            { "recordingsurl",t.RecordingsUrl }
-    };
-};
-
-void from_json(const nlohmann::json& j, TranscriptionDefinition& t) {
-    j.at("locale").get_to(t.Locale);
-    j.at("models").get_to(t.Models);
-    j.at("name").get_to(t.Name);
-    j.at("properties").get_to(t.properties);
-    j.at("recordingsurl").get_to(t.RecordingsUrl);
-}
-
-class Transcription {
-public:
-    string name;
-    string description;
-    string locale;
-    string recordingsUrl;
-    map<string, string> resultsUrls;
-    string id;
-    string createdDateTime;
-    string lastActionDateTime;
-    string status;
-    string statusMessage;
-};
-
-void to_json(nlohmann::json& j, const Transcription& t) {
-    j = nlohmann::json{
-            { "description", t.description },
-            { "locale", t.locale },
-            { "createddatetime", t.createdDateTime },
-            { "name", t.name },
-            { "id", t.id },
-            { "recordingsurl",t.recordingsUrl },
-            { "resultUrls", t.resultsUrls},
-            { "status", t.status},
-            { "statusMessage", t.statusMessage},
-    };
-};
-
-void from_json(const nlohmann::json& j, Transcription& t) {
-    j.at("description").get_to(t.description);
-    j.at("locale").get_to(t.locale);
-    j.at("createdDateTime").get_to(t.createdDateTime);
-    j.at("name").get_to(t.name);
-    j.at("recordingsUrl").get_to(t.recordingsUrl);
-    t.resultsUrls = j.at("resultsUrls").get<map<string, string>>();
-    j.at("status").get_to(t.status);
-    t.statusMessage = j.value("statusMessage", "");
-}
-class Result
-{
-public:
-    string Lexical;
-    string ITN;
-    string MaskedITN;
-    string Display;
-};
-void from_json(const nlohmann::json& j, Result& r) {
-    j.at("Lexical").get_to(r.Lexical);
-    j.at("ITN").get_to(r.ITN);
-    j.at("MaskedITN").get_to(r.MaskedITN);
-    j.at("Display").get_to(r.Display);
-}
+const vector<string> recordingsBlobUris = { "YourFileUrl" };
 
-class NBest : public Result
-{
-public:
-    double Confidence;
-};
-void from_json(const nlohmann::json& j, NBest& nb) {
-    j.at("Confidence").get_to(nb.Confidence);
-    j.at("Lexical").get_to(nb.Lexical);
-    j.at("ITN").get_to(nb.ITN);
-    j.at("MaskedITN").get_to(nb.MaskedITN);
-    j.at("Display").get_to(nb.Display);
-}
+// Maximum number of transcriptions that are running on the service at the same time.
+const size_t maxConcurrentTranscriptions = 16;
 
-class SegmentResult
-{
-public:
-    string RecognitionStatus;
-    ULONG Offset;
-    ULONG Duration;
-    std::list<NBest> NBest;
-};
-void from_json(const nlohmann::json& j, SegmentResult& sr) {
-    j.at("RecognitionStatus").get_to(sr.RecognitionStatus);
-    j.at("Offset").get_to(sr.Offset);
-    j.at("Duration").get_to(sr.Duration);
-    sr.NBest = j.at("NBest").get<list<NBest>>();
-}
-
-class AudioFileResult
-{
-public:
-    string AudioFileName;
-    std::list<SegmentResult> SegmentResults;
-    std::list<Result> CombinedResults;
-};
-void from_json(const nlohmann::json& j, AudioFileResult& arf) {
-    j.at("AudioFileName").get_to(arf.AudioFileName);
-    arf.SegmentResults = j.at("SegmentResults").get<list<SegmentResult>>();
-    arf.CombinedResults = j.at("CombinedResults").get<list<Result>>();
-}
-
-class RootObject {
-public:
-    std::list<AudioFileResult> AudioFileResults;
-};
-void from_json(const nlohmann::json& j, RootObject& r) {
-    r.AudioFileResults = j.at("AudioFileResults").get<list<AudioFileResult>>();
-}
-
-
-void recognizeSpeech()
+void recognizeSpeech(const string_t& serviceUrl)
 {
     std::wstring_convert<std::codecvt_utf8_utf16<wchar_t >> converter;
 
-    utility::string_t service_url = U("https://") + region + U(".cris.ai/api/speechtotext/v2.0/Transcriptions/");
-    uri u(service_url);
-
-    http_client c(u);
-    http_request msg(methods::POST);
-    msg.headers().add(U("Content-Type"), U("application/json"));
-    msg.headers().add(U("Ocp-Apim-Subscription-Key"), subscriptionKey);
-
-    auto transportdef = TranscriptionDefinition::Create(name, description, myLocale, recordingsBlobUri);
-
-    nlohmann::json transportdefJSON = transportdef;
-
-    msg.set_body(transportdefJSON.dump());
+    BatchTranscriptionOptions options;
+    options.ServiceUrl = serviceUrl;
+    options.SubscriptionKey = subscriptionKey;
+    options.MaxConcurrentJobs = maxConcurrentTranscriptions;
 
-    auto response = c.request(msg).get();
-    auto statusCode = response.status_code();
-
-    if (statusCode != status_codes::Accepted)
+    // Creates one transcription definition per recording. Add more recordings to transcribe them as a batch.
+    vector<TranscriptionDefinition> definitions;
+    for (const auto& recordingsUri : recordingsBlobUris)
     {
-        cout << "Unexpected status code " << statusCode << endl;
-        return;
+        definitions.push_back(TranscriptionDefinition::Create(name, description, myLocale, recordingsUri));
     }
 
-    string_t transcriptionLocation = response.headers()[U("location")];
-
-    cout << "Transcription status is located at " << converter.to_bytes(transcriptionLocation) << endl;
-
-    http_client statusCheckClient(transcriptionLocation);
-    http_request statusCheckMessage(methods::GET);
-    statusCheckMessage.headers().add(U("Ocp-Apim-Subscription-Key"), subscriptionKey);
+    BatchTranscriptionClient client(options);
 
-    bool completed = false;
-
-    while (!completed)
+    client.Run(definitions, [&](const TranscriptionJob& job)
     {
-        auto statusResponse = statusCheckClient.request(statusCheckMessage).get();
-        auto statusResponseCode = statusResponse.status_code();
+        cout << "Transcription of " << job.Definition.RecordingsUrl << " is located at " << converter.to_bytes(job.Location) << endl;
 
-        if (statusResponseCode != status_codes::OK)
+        if (!job.Succeeded)
         {
-            cout << "Fetching the transcription returned unexpected http code " << statusResponseCode << endl;
+            cout << "Transcription has failed " << job.Error << endl;
             return;
         }
 
-        auto body = statusResponse.extract_string().get();
-        auto statusJSON = nlohmann::json::parse(body);
-        Transcription transcriptionStatus = statusJSON;
+        cout << "Success!" << endl;
+        auto resultsUrls = job.Status.resultsUrls;
+        string result = resultsUrls["channel_0"];
+        cout << "Transcription has completed. Results are at " << result << endl;
+        cout << "Fetching results" << endl;
 
-        if (!_stricmp(transcriptionStatus.status.c_str(), "Failed"))
+        // Streams the result file, so that neither the document nor its DOM is ever held in memory.
+        try
         {
-            completed = true;
-            cout << "Transcription has failed " << transcriptionStatus.statusMessage << endl;
-        }
-        else if (!_stricmp(transcriptionStatus.status.c_str(), "Succeeded"))
-        {
-            completed = true;
-            cout << "Success!" << endl;
-            string result = transcriptionStatus.resultsUrls["channel_0"];
-            cout << "Transcription has completed. Results are at " << result << endl;
-            cout << "Fetching results" << endl;
-
-            http_client result_client(converter.from_bytes(result));
-            http_request resultMessage(methods::GET);
-            resultMessage.headers().add(U("Ocp-Apim-Subscription-Key"), subscriptionKey);
-
-            auto resultResponse = result_client.request(resultMessage).get();
-
+            auto resultResponse = client.HttpClients().Request(uri(converter.from_bytes(result)), client.CreateRequest(methods::GET)).get();
             auto responseCode = resultResponse.status_code();
 
             if (responseCode != status_codes::OK)
@@ -263,47 +89,97 @@ void recognizeSpeech()
                 return;
             }
 
-            auto resultBody = resultResponse.extract_string().get();
-
-            nlohmann::json resultJSON = nlohmann::json::parse(resultBody);
-            RootObject root = resultJSON;
-
-            for (AudioFileResult af : root.AudioFileResults)
+            // Every segment is printed as soon as it is parsed, so memory use does not grow with the result size.
+            // The number of segments of an audio file is known once all of them were parsed.
+            SegmentResultEvents events;
+            events.OnSegment = [](size_t, const string&, const SegmentResult& segResult)
             {
-                cout << "There were " << af.SegmentResults.size() << " results in " << af.AudioFileName << endl;
+                cout << "Status: " << segResult.RecognitionStatus << endl;
 
-                for (SegmentResult segResult : af.SegmentResults)
+                if (!_stricmp(segResult.RecognitionStatus.c_str(), "success") && segResult.NBest.size() > 0)
                 {
-                    cout << "Status: " << segResult.RecognitionStatus << endl;
-
-                    if (!_stricmp(segResult.RecognitionStatus.c_str(), "success") && segResult.NBest.size() > 0)
-                    {
-                        cout << "Best text result was: '" << segResult.NBest.front().Display << "'" << endl;
-                    }
+                    cout << "Best text result was: '" << segResult.NBest[0].Display << "'" << endl;
                 }
-            }
+            };
+            events.OnAudioFileEnd = [](size_t, const string& audioFileName, size_t segmentCount)
+            {
+                cout << "There were " << segmentCount << " results in " << audioFileName << endl;
+            };
+            ParseSegmentResults(resultResponse.body(), events);
         }
-        else if (!_stricmp(transcriptionStatus.status.c_str(), "Running"))
+        catch (const exception& e)
         {
-            cout << "Transcription is running." << endl;
+            cout << e.what() << endl;
         }
-        else if (!_stricmp(transcriptionStatus.status.c_str(), "NotStarted"))
+    });
+}
+
+// Prints the phrases of a v3 result file, as produced by the v3 batch transcription API.
+void printResultV3(const wstring& fileName)
+{
+    ifstream file(fileName, ios::binary);
+    if (!file)
+    {
+        throw runtime_error("Cannot open the result file.");
+    }
+    vector<char> document((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    struct PrintHandler
+    {
+        void OnCombinedPhrase(const TranscriptionResultV3::CombinedPhrase& phrase)
         {
-            cout << "Transcription has not started." << endl;
+            cout << "Channel " << phrase.Channel << ": '" << phrase.Display.ToString() << "'" << endl;
         }
 
-        if (!completed) {
-            Sleep(5000);
+        void OnRecognizedPhrase(const TranscriptionResultV3::RecognizedPhrase& phrase)
+        {
+            cout << "Status: " << phrase.RecognitionStatus.ToString() << " at " << phrase.OffsetInTicks << " ticks" << endl;
+            if (phrase.NBestCount > 0)
+            {
+                cout << "Best text result was: '" << phrase.NBest[0].Display.ToString() << "'" << endl;
+            }
         }
+    };
 
-    }
+    TranscriptionResultV3::Decoder decoder;
+    PrintHandler handler;
+    auto header = decoder.Decode(document.data(), document.size(), handler);
+    cout << "There were " << header.RecognizedPhraseCount << " results in " << header.Source.ToString() << endl;
 }
 
-int wmain()
+// Usage: quickstart.exe [transcriptions endpoint]
+//        quickstart.exe --benchmark-results [segment count]
+//        quickstart.exe --decode-v3 <result file>
+//        quickstart.exe --benchmark-v3 [total MB] [document MB]
+// The endpoint defaults to the service in your region. Pass the URL of a local mock HTTP server, e.g.
+// http://localhost:8081/api/speechtotext/v2.0/Transcriptions/ of samples/cpp/mock-speech-service/mock_transcription_service.py,
+// to test without the service.
+// --benchmark-results compares the result models on synthetic segments, without calling the service.
+// --decode-v3 prints a v3 result file, and --benchmark-v3 measures the v3 decoder on synthetic results.
+int wmain(int argc, wchar_t** argv)
 {
     try
     {
-        recognizeSpeech();
+        if (argc > 1 && wstring(argv[1]) == L"--benchmark-results")
+        {
+            ResultStoreBenchmark::Run(argc > 2 ? static_cast<size_t>(_wtoi64(argv[2])) : 1000000);
+            return 0;
+        }
+        if (argc > 2 && wstring(argv[1]) == L"--decode-v3")
+        {
+            printResultV3(argv[2]);
+            return 0;
+        }
+        if (argc > 1 && wstring(argv[1]) == L"--benchmark-v3")
+        {
+            TranscriptionResultV3Benchmark::Run(argc > 2 ? _wtoi64(argv[2]) : 4096, argc > 3 ? _wtoi64(argv[3]) : 64);
+            return 0;
+        }
+
+        auto serviceUrl = argc > 1
+            ? string_t(argv[1])
+            : U("https://") + region + U(".cris.ai/api/speechtotext/v2.0/Transcriptions/");
+        recognizeSpeech(serviceUrl);
     }
     catch (exception e)
     {
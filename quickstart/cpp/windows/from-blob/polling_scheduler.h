@@ -0,0 +1,242 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Picks the delay before the next status check of a transcription.
+// Every status has its own base interval. While the status stays the same the interval grows
+// exponentially up to MaxInterval, or up to MaxRunningInterval for running jobs, whose completion should be
+// noticed soon; a status transition starts over at the new status' base interval.
+// A Retry-After value sent by the service takes precedence over the computed interval.
+struct PollingPolicy
+{
+    // Jobs that have not started wait in the service queue, so there is no need to check them often.
+    std::chrono::milliseconds NotStartedInterval{ 10000 };
+    // Running jobs are checked more often, so that their completion is noticed quickly.
+    std::chrono::milliseconds RunningInterval{ 2000 };
+    // Used for any other status, and for a submission or status check that failed transiently.
+    std::chrono::milliseconds DefaultInterval{ 5000 };
+
+    double BackoffFactor = 2.0;
+    std::chrono::milliseconds MinInterval{ 500 };
+    std::chrono::milliseconds MaxInterval{ 60000 };
+    // Running jobs back off only a little, so that a completion is noticed at most this late.
+    std::chrono::milliseconds MaxRunningInterval{ 5000 };
+
+    // Polling state of a single transcription.
+    struct State
+    {
+        std::string LastStatus;
+        std::chrono::milliseconds Interval{ 0 };
+    };
+
+    // The delay before the first status check after submission.
+    std::chrono::milliseconds InitialDelay(State& state) const
+    {
+        state.LastStatus = "NotStarted";
+        state.Interval = NotStartedInterval;
+        return Clamp(state.Interval);
+    }
+
+    // The delay before the next status check, given the status just fetched and the Retry-After
+    // value of the response in seconds (negative if there was none).
+    std::chrono::milliseconds NextDelay(State& state, const std::string& status, int retryAfterSeconds) const
+    {
+        if (status != state.LastStatus || state.Interval.count() == 0)
+        {
+            state.LastStatus = status;
+            state.Interval = BaseInterval(status);
+        }
+        else
+        {
+            state.Interval = std::chrono::milliseconds(static_cast<long long>(state.Interval.count() * BackoffFactor));
+            state.Interval = (std::min)(state.Interval, status == "Running" ? MaxRunningInterval : MaxInterval);
+        }
+
+        if (retryAfterSeconds >= 0)
+        {
+            return Clamp(std::chrono::seconds(retryAfterSeconds));
+        }
+        return Clamp(state.Interval);
+    }
+
+    // Parses the delay-seconds form of a Retry-After header. Returns -1 for the HTTP-date form or invalid values.
+    static int ParseRetryAfter(const std::string& value)
+    {
+        if (value.empty())
+        {
+            return -1;
+        }
+        char* end = nullptr;
+        long seconds = std::strtol(value.c_str(), &end, 10);
+        if (end == value.c_str() || *end != '\0' || seconds < 0)
+        {
+            return -1;
+        }
+        return static_cast<int>(seconds);
+    }
+
+private:
+    std::chrono::milliseconds BaseInterval(const std::string& status) const
+    {
+        if (status == "NotStarted")
+        {
+            return NotStartedInterval;
+        }
+        if (status == "Running")
+        {
+            return RunningInterval;
+        }
+        return DefaultInterval;
+    }
+
+    std::chrono::milliseconds Clamp(std::chrono::milliseconds interval) const
+    {
+        return (std::max)(MinInterval, (std::min)(interval, MaxInterval));
+    }
+};
+
+// Hashed timer wheel. Deadlines are rounded up to the wheel's resolution, so that all entries
+// that fall due within the same tick are returned together by a single Advance() call.
+// Entries scheduled further than one rotation ahead wait in their slot for the remaining rounds.
+template<class T>
+class TimerWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerWheel(std::chrono::milliseconds resolution, size_t slotCount, Clock::time_point start = Clock::now())
+        : m_resolution(resolution), m_slots(slotCount), m_currentTick(0), m_start(start)
+    {
+        if (resolution.count() <= 0 || slotCount == 0)
+        {
+            throw std::invalid_argument("The timer wheel needs a positive resolution and at least one slot.");
+        }
+    }
+
+    // Schedules an entry to fall due at the specified time. Times in the past fall due with the next tick.
+    void Schedule(T value, Clock::time_point due)
+    {
+        auto tick = (std::max)(TickOf(due), m_currentTick);
+        auto& slot = m_slots[tick % m_slots.size()];
+        slot.push_back(Entry{ tick, std::move(value) });
+        m_count++;
+    }
+
+    // Removes and returns all entries that are due at the specified time.
+    std::vector<T> Advance(Clock::time_point now)
+    {
+        std::vector<T> due;
+        auto nowTick = ElapsedTicks(now);
+
+        // Every slot needs to be visited at most once per call, even after a long sleep.
+        auto lastTick = (std::min)(nowTick, m_currentTick + m_slots.size() - 1);
+        for (; m_currentTick <= lastTick; m_currentTick++)
+        {
+            auto& slot = m_slots[m_currentTick % m_slots.size()];
+            for (size_t i = 0; i < slot.size();)
+            {
+                if (slot[i].Tick <= nowTick)
+                {
+                    due.push_back(std::move(slot[i].Value));
+                    slot[i] = std::move(slot.back());
+                    slot.pop_back();
+                    m_count--;
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+        m_currentTick = (std::max)(m_currentTick, nowTick);
+        return due;
+    }
+
+    // The earliest time at which an entry falls due. Only valid if the wheel is not empty.
+    Clock::time_point NextDue() const
+    {
+        // Entries of the current rotation are found by walking the slots in order.
+        for (uint64_t tick = m_currentTick; tick < m_currentTick + m_slots.size(); tick++)
+        {
+            for (const auto& entry : m_slots[tick % m_slots.size()])
+            {
+                if (entry.Tick == tick)
+                {
+                    return TimeOf(tick);
+                }
+            }
+        }
+
+        // All entries are at least one rotation ahead.
+        auto next = std::numeric_limits<uint64_t>::max();
+        for (const auto& slot : m_slots)
+        {
+            for (const auto& entry : slot)
+            {
+                next = (std::min)(next, entry.Tick);
+            }
+        }
+        return TimeOf(next);
+    }
+
+    bool Empty() const
+    {
+        return m_count == 0;
+    }
+
+    size_t Size() const
+    {
+        return m_count;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t Tick;
+        T Value;
+    };
+
+    Clock::time_point TimeOf(uint64_t tick) const
+    {
+        return m_start + m_resolution * static_cast<long long>(tick);
+    }
+
+    // Rounds up, so that an entry never falls due before its deadline.
+    uint64_t TickOf(Clock::time_point time) const
+    {
+        if (time <= m_start)
+        {
+            return 0;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(time - m_start).count();
+        return static_cast<uint64_t>((elapsed + m_resolution.count() - 1) / m_resolution.count());
+    }
+
+    // The number of ticks that have fully elapsed at the specified time.
+    uint64_t ElapsedTicks(Clock::time_point time) const
+    {
+        if (time <= m_start)
+        {
+            return 0;
+        }
+        return static_cast<uint64_t>((time - m_start) / m_resolution);
+    }
+
+    std::chrono::milliseconds m_resolution;
+    std::vector<std::vector<Entry>> m_slots;
+    uint64_t m_currentTick;
+    Clock::time_point m_start;
+    size_t m_count = 0;
+};
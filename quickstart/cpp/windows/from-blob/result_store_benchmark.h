@@ -0,0 +1,187 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "transcription_models.h"
+#include "transcription_result_store.h"
+
+// Compares the result models on synthetic data: the object model with std::list containers that was used
+// before, the current object model of transcription_models.h with std::vector, and the columnar
+// TranscriptionResultStore.
+// Each model is built from the same segments and then scanned once, summing offsets, durations and the
+// length of the best Display text, which is the typical post-processing access pattern.
+namespace ResultStoreBenchmark
+{
+    // Copy of the list-based object model that was used before, with std::list for the n-best entries, the
+    // segments and the combined results. Only the ticks are 64-bit, as in the current model, so that both scans
+    // compute the same checksum.
+    struct ListSegmentResult
+    {
+        std::string RecognitionStatus;
+        uint64_t Offset;
+        uint64_t Duration;
+        std::list<::NBest> NBest;
+    };
+
+    struct ListAudioFileResult
+    {
+        std::string AudioFileName;
+        std::list<ListSegmentResult> SegmentResults;
+        std::list<Result> CombinedResults;
+    };
+
+    inline ListSegmentResult ToListModel(const SegmentResult& segment)
+    {
+        ListSegmentResult result;
+        result.RecognitionStatus = segment.RecognitionStatus;
+        result.Offset = segment.Offset;
+        result.Duration = segment.Duration;
+        result.NBest.assign(segment.NBest.begin(), segment.NBest.end());
+        return result;
+    }
+
+    inline SegmentResult ToVectorModel(const SegmentResult& segment)
+    {
+        return segment;
+    }
+
+    struct ScanResult
+    {
+        uint64_t Ticks = 0;
+        uint64_t DisplayChars = 0;
+    };
+
+    inline std::vector<SegmentResult> CreateSegments(size_t count)
+    {
+        // Real results repeat a small set of statuses and many short phrases.
+        const char* phrases[] = { "Hello.", "How are you?", "Thank you for calling.", "Please hold the line.",
+                                  "Can I have your account number?", "Goodbye." };
+        const size_t phraseCount = sizeof(phrases) / sizeof(phrases[0]);
+
+        std::vector<SegmentResult> segments(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            auto& segment = segments[i];
+            segment.RecognitionStatus = "Success";
+            segment.Offset = static_cast<uint64_t>(i) * 20000000;
+            segment.Duration = 15000000;
+            for (size_t n = 0; n < 3; n++)
+            {
+                ::NBest nbest;
+                nbest.Confidence = 0.9 - n * 0.1;
+                nbest.Display = phrases[(i + n) % phraseCount];
+                nbest.Lexical = nbest.Display;
+                nbest.ITN = nbest.Display;
+                nbest.MaskedITN = nbest.Display;
+                segment.NBest.push_back(nbest);
+            }
+        }
+        return segments;
+    }
+
+    template<class AudioFile>
+    ScanResult Scan(const std::vector<AudioFile>& files)
+    {
+        ScanResult result;
+        for (const auto& file : files)
+        {
+            for (const auto& segment : file.SegmentResults)
+            {
+                result.Ticks += segment.Offset + segment.Duration;
+                if (!segment.NBest.empty())
+                {
+                    result.DisplayChars += segment.NBest.front().Display.size();
+                }
+            }
+        }
+        return result;
+    }
+
+    inline ScanResult Scan(const TranscriptionResultStore& store)
+    {
+        ScanResult result;
+        store.ForEachSegment([&](const TranscriptionResultStore::SegmentView& segment)
+        {
+            result.Ticks += segment.Offset() + segment.Duration();
+            if (segment.NBestCount() > 0)
+            {
+                result.DisplayChars += segment.NBest(0).Display().Size;
+            }
+        });
+        return result;
+    }
+
+    template<class Function>
+    double MeasureMilliseconds(Function function)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    inline void Report(const char* model, double buildMs, double scanMs, const ScanResult& scan)
+    {
+        std::cout << model << ": build " << buildMs << " ms, scan " << scanMs << " ms"
+                  << " (checksum " << scan.Ticks << "/" << scan.DisplayChars << ")" << std::endl;
+    }
+
+    // Builds the files of an object model from the segments; convert copies a segment into the model's type.
+    template<class AudioFile, class Convert>
+    void RunObjectModel(const char* model, const std::vector<SegmentResult>& segments, size_t segmentsPerFile, Convert convert)
+    {
+        std::vector<AudioFile> files;
+        auto buildMs = MeasureMilliseconds([&]()
+        {
+            for (size_t i = 0; i < segments.size(); i++)
+            {
+                if (i % segmentsPerFile == 0)
+                {
+                    files.emplace_back();
+                    files.back().AudioFileName = "file" + std::to_string(files.size() - 1) + ".wav";
+                }
+                files.back().SegmentResults.push_back(convert(segments[i]));
+            }
+        });
+
+        ScanResult scan;
+        auto scanMs = MeasureMilliseconds([&]() { scan = Scan(files); });
+        Report(model, buildMs, scanMs, scan);
+    }
+
+    inline void Run(size_t segmentCount, size_t segmentsPerFile = 1000)
+    {
+        std::cout << "Comparing result models with " << segmentCount << " segments" << std::endl;
+        auto segments = CreateSegments(segmentCount);
+
+        RunObjectModel<ListAudioFileResult>("std::list objects  ", segments, segmentsPerFile, ToListModel);
+        RunObjectModel<AudioFileResult>("std::vector objects", segments, segmentsPerFile, ToVectorModel);
+
+        TranscriptionResultStore store;
+        auto buildMs = MeasureMilliseconds([&]()
+        {
+            for (size_t i = 0; i < segments.size(); i++)
+            {
+                if (i % segmentsPerFile == 0)
+                {
+                    store.BeginAudioFile("file" + std::to_string(store.AudioFileCount()) + ".wav");
+                }
+                store.AddSegment(segments[i]);
+            }
+            store.Seal();
+        });
+
+        ScanResult scan;
+        auto scanMs = MeasureMilliseconds([&]() { scan = Scan(store); });
+        Report("columnar store     ", buildMs, scanMs, scan);
+        std::cout << "columnar store uses " << store.Bytes() << " bytes for " << store.Strings().Count() << " distinct strings" << std::endl;
+    }
+}
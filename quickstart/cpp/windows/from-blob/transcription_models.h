@@ -0,0 +1,168 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+class TranscriptionDefinition {
+private:
+    TranscriptionDefinition(std::string name,
+        std::string description,
+        std::string locale,
+        std::string recordingsUrl,
+        std::list<std::string> models) {
+
+        Name = name;
+        Description = description;
+        RecordingsUrl = recordingsUrl;
+        Locale = locale;
+        Models = models;
+    }
+
+public:
+    std::string Name;
+    std::string Description;
+    std::string RecordingsUrl;
+    std::string Locale;
+    std::list<std::string> Models;
+    std::map<std::string, std::string> properties;
+
+    static TranscriptionDefinition Create(std::string name, std::string description, std::string locale, std::string recordingsUrl) {
+        return TranscriptionDefinition(name, description, locale, recordingsUrl, std::list<std::string>());
+    }
+    static TranscriptionDefinition Create(std::string name, std::string description, std::string locale, std::string recordingsUrl,
+        std::list<std::string> models) {
+        return TranscriptionDefinition(name, description, locale, recordingsUrl, models);
+    }
+};
+
+inline void to_json(nlohmann::json& j, const TranscriptionDefinition& t) {
+    j = nlohmann::json{
+            { "description", t.Description },
+            { "locale", t.Locale },
+            { "models", t.Models },
+            { "name", t.Name },
+            { "properties", t.properties },
+            { "recordingsurl",t.RecordingsUrl }
+    };
+};
+
+inline void from_json(const nlohmann::json& j, TranscriptionDefinition& t) {
+    j.at("locale").get_to(t.Locale);
+    j.at("models").get_to(t.Models);
+    j.at("name").get_to(t.Name);
+    j.at("properties").get_to(t.properties);
+    j.at("recordingsurl").get_to(t.RecordingsUrl);
+}
+
+class Transcription {
+public:
+    std::string name;
+    std::string description;
+    std::string locale;
+    std::string recordingsUrl;
+    std::map<std::string, std::string> resultsUrls;
+    std::string id;
+    std::string createdDateTime;
+    std::string lastActionDateTime;
+    std::string status;
+    std::string statusMessage;
+};
+
+inline void to_json(nlohmann::json& j, const Transcription& t) {
+    j = nlohmann::json{
+            { "description", t.description },
+            { "locale", t.locale },
+            { "createddatetime", t.createdDateTime },
+            { "name", t.name },
+            { "id", t.id },
+            { "recordingsurl",t.recordingsUrl },
+            { "resultUrls", t.resultsUrls},
+            { "status", t.status},
+            { "statusMessage", t.statusMessage},
+    };
+};
+
+inline void from_json(const nlohmann::json& j, Transcription& t) {
+    j.at("description").get_to(t.description);
+    j.at("locale").get_to(t.locale);
+    j.at("createdDateTime").get_to(t.createdDateTime);
+    j.at("name").get_to(t.name);
+    j.at("recordingsUrl").get_to(t.recordingsUrl);
+    t.resultsUrls = j.at("resultsUrls").get<std::map<std::string, std::string>>();
+    j.at("status").get_to(t.status);
+    t.statusMessage = j.value("statusMessage", "");
+}
+class Result
+{
+public:
+    std::string Lexical;
+    std::string ITN;
+    std::string MaskedITN;
+    std::string Display;
+};
+inline void from_json(const nlohmann::json& j, Result& r) {
+    j.at("Lexical").get_to(r.Lexical);
+    j.at("ITN").get_to(r.ITN);
+    j.at("MaskedITN").get_to(r.MaskedITN);
+    j.at("Display").get_to(r.Display);
+}
+
+class NBest : public Result
+{
+public:
+    double Confidence;
+};
+inline void from_json(const nlohmann::json& j, NBest& nb) {
+    j.at("Confidence").get_to(nb.Confidence);
+    j.at("Lexical").get_to(nb.Lexical);
+    j.at("ITN").get_to(nb.ITN);
+    j.at("MaskedITN").get_to(nb.MaskedITN);
+    j.at("Display").get_to(nb.Display);
+}
+
+class SegmentResult
+{
+public:
+    std::string RecognitionStatus;
+    // In ticks of 100 ns; 32 bits would wrap after about 7 minutes of audio.
+    uint64_t Offset;
+    uint64_t Duration;
+    std::vector<NBest> NBest;
+};
+inline void from_json(const nlohmann::json& j, SegmentResult& sr) {
+    j.at("RecognitionStatus").get_to(sr.RecognitionStatus);
+    j.at("Offset").get_to(sr.Offset);
+    j.at("Duration").get_to(sr.Duration);
+    sr.NBest = j.at("NBest").get<std::vector<NBest>>();
+}
+
+class AudioFileResult
+{
+public:
+    std::string AudioFileName;
+    std::vector<SegmentResult> SegmentResults;
+    std::vector<Result> CombinedResults;
+};
+inline void from_json(const nlohmann::json& j, AudioFileResult& arf) {
+    j.at("AudioFileName").get_to(arf.AudioFileName);
+    arf.SegmentResults = j.at("SegmentResults").get<std::vector<SegmentResult>>();
+    arf.CombinedResults = j.at("CombinedResults").get<std::vector<Result>>();
+}
+
+class RootObject {
+public:
+    std::vector<AudioFileResult> AudioFileResults;
+};
+inline void from_json(const nlohmann::json& j, RootObject& r) {
+    r.AudioFileResults = j.at("AudioFileResults").get<std::vector<AudioFileResult>>();
+}
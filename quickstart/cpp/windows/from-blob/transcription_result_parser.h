@@ -0,0 +1,343 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "transcription_models.h"
+
+// Called once per segment of a result file, in document order.
+using SegmentResultCallback = std::function<void(size_t audioFileIndex, const std::string& audioFileName, const SegmentResult& segment)>;
+
+// Callbacks for the audio files of a result file, in document order. Every audio file is reported, also one
+// without segments: OnAudioFileBegin, then OnSegment for each of its segments, then OnAudioFileEnd.
+// Callbacks that are not set are skipped.
+struct SegmentResultEvents
+{
+    std::function<void(size_t audioFileIndex, const std::string& audioFileName)> OnAudioFileBegin;
+    SegmentResultCallback OnSegment;
+    std::function<void(size_t audioFileIndex, const std::string& audioFileName, size_t segmentCount)> OnAudioFileEnd;
+};
+
+// SAX handler for the transcription result format. Only the segment that is currently being parsed
+// is materialized; it is converted to a SegmentResult, handed to the callback and discarded, so memory
+// use does not grow with the length of the result file. CombinedResults are skipped.
+// JSON members are unordered: if the AudioFileName of an audio file follows its SegmentResults, the segments of
+// that file are held back until the name is known. An audio file without AudioFileName is rejected.
+class SegmentResultSaxHandler
+{
+public:
+    using json = nlohmann::json;
+
+    explicit SegmentResultSaxHandler(const SegmentResultCallback& onSegment)
+        : SegmentResultSaxHandler(SegmentResultEvents{ nullptr, onSegment, nullptr })
+    {
+    }
+
+    explicit SegmentResultSaxHandler(const SegmentResultEvents& events)
+        : m_events(events)
+    {
+    }
+
+    bool null() { return Value(nullptr); }
+    bool boolean(bool value) { return Value(value); }
+    bool number_integer(json::number_integer_t value) { return Value(value); }
+    bool number_unsigned(json::number_unsigned_t value) { return Value(value); }
+    bool number_float(json::number_float_t value, const json::string_t&) { return Value(value); }
+
+    bool string(json::string_t& value)
+    {
+        if (!IsCapturing() && m_path.size() == audioFileDepth && m_key == "AudioFileName")
+        {
+            m_audioFileName = value;
+            BeginAudioFile();
+            return true;
+        }
+        return Value(std::move(value));
+    }
+
+    // Binary values are not part of the result format. Declared as a template so that the handler
+    // works with nlohmann::json versions with and without binary value support.
+    template<class BinaryType>
+    bool binary(BinaryType&)
+    {
+        return true;
+    }
+
+    bool start_object(std::size_t)
+    {
+        if (IsCapturing())
+        {
+            m_build.push_back(AddChild(json::object()));
+        }
+        else if (IsSegmentStart())
+        {
+            m_segment = json::object();
+            m_build.push_back(&m_segment);
+        }
+        else if (IsAudioFileStart())
+        {
+            m_audioFileIndex = m_audioFileCount++;
+            m_audioFileName.clear();
+            m_hasAudioFileName = false;
+            m_segmentCount = 0;
+        }
+        Push(false);
+        return true;
+    }
+
+    bool end_object()
+    {
+        Pop();
+        if (IsCapturing())
+        {
+            m_build.pop_back();
+            if (m_build.empty())
+            {
+                SegmentResult segment = m_segment;
+                m_segment = nullptr;
+                m_segmentCount++;
+                if (m_hasAudioFileName)
+                {
+                    OnSegment(segment);
+                }
+                else
+                {
+                    m_pendingSegments.push_back(std::move(segment));
+                }
+            }
+        }
+        else if (IsAudioFileStart())
+        {
+            return EndAudioFile();
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t)
+    {
+        if (IsCapturing())
+        {
+            m_build.push_back(AddChild(json::array()));
+        }
+        Push(true);
+        return true;
+    }
+
+    bool end_array()
+    {
+        Pop();
+        if (IsCapturing())
+        {
+            m_build.pop_back();
+        }
+        return true;
+    }
+
+    bool key(json::string_t& value)
+    {
+        m_key = value;
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& e)
+    {
+        m_error = "Invalid transcription result at byte " + std::to_string(position) + ": " + e.what();
+        return false;
+    }
+
+    const std::string& Error() const { return m_error; }
+
+private:
+    // Nesting of a segment object: root object, AudioFileResults array, audio file object, SegmentResults array.
+    static constexpr size_t audioFileDepth = 3;
+    static constexpr size_t segmentDepth = 4;
+
+    struct Frame
+    {
+        bool IsArray;
+        // The member name under which the container appears in its parent object.
+        std::string Key;
+    };
+
+    bool IsCapturing() const { return !m_build.empty(); }
+
+    // Reports the start of the audio file once its name is known, and the segments held back until then.
+    void BeginAudioFile()
+    {
+        if (m_hasAudioFileName)
+        {
+            return;
+        }
+        m_hasAudioFileName = true;
+        if (m_events.OnAudioFileBegin)
+        {
+            m_events.OnAudioFileBegin(m_audioFileIndex, m_audioFileName);
+        }
+        for (const auto& segment : m_pendingSegments)
+        {
+            OnSegment(segment);
+        }
+        m_pendingSegments.clear();
+    }
+
+    bool EndAudioFile()
+    {
+        if (!m_hasAudioFileName)
+        {
+            m_error = "Invalid transcription result: audio file " + std::to_string(m_audioFileIndex) + " has no AudioFileName.";
+            return false;
+        }
+        if (m_events.OnAudioFileEnd)
+        {
+            m_events.OnAudioFileEnd(m_audioFileIndex, m_audioFileName, m_segmentCount);
+        }
+        return true;
+    }
+
+    void OnSegment(const SegmentResult& segment)
+    {
+        if (m_events.OnSegment)
+        {
+            m_events.OnSegment(m_audioFileIndex, m_audioFileName, segment);
+        }
+    }
+
+    bool IsAudioFileStart() const
+    {
+        return m_path.size() == audioFileDepth - 1 && m_path[1].IsArray && m_path[1].Key == "AudioFileResults";
+    }
+
+    bool IsSegmentStart() const
+    {
+        return m_path.size() == segmentDepth && m_path[1].Key == "AudioFileResults" &&
+            m_path[3].IsArray && m_path[3].Key == "SegmentResults";
+    }
+
+    void Push(bool isArray)
+    {
+        bool inObject = !m_path.empty() && !m_path.back().IsArray;
+        m_path.push_back(Frame{ isArray, inObject ? m_key : std::string() });
+    }
+
+    void Pop()
+    {
+        m_path.pop_back();
+    }
+
+    // Adds a value to the container that is being built, and returns a pointer to the stored value.
+    json* AddChild(json&& value)
+    {
+        auto& parent = *m_build.back();
+        if (parent.is_array())
+        {
+            parent.push_back(std::move(value));
+            return &parent.back();
+        }
+        auto& member = parent[m_key];
+        member = std::move(value);
+        return &member;
+    }
+
+    template<class T>
+    bool Value(T&& value)
+    {
+        if (IsCapturing())
+        {
+            AddChild(json(std::forward<T>(value)));
+        }
+        return true;
+    }
+
+    SegmentResultEvents m_events;
+
+    std::vector<Frame> m_path;
+    std::string m_key;
+
+    size_t m_audioFileCount = 0;
+    size_t m_audioFileIndex = 0;
+    std::string m_audioFileName;
+    bool m_hasAudioFileName = false;
+    size_t m_segmentCount = 0;
+    std::vector<SegmentResult> m_pendingSegments;
+
+    json m_segment;
+    std::vector<json*> m_build;
+
+    std::string m_error;
+};
+
+// Parses a transcription result document from a stream and reports every audio file and segment.
+inline void ParseSegmentResults(std::istream& input, const SegmentResultEvents& events)
+{
+    SegmentResultSaxHandler handler(events);
+    if (!nlohmann::json::sax_parse(input, &handler))
+    {
+        throw std::runtime_error(handler.Error());
+    }
+}
+
+// Parses a transcription result document from a stream and reports every segment through the callback.
+inline void ParseSegmentResults(std::istream& input, const SegmentResultCallback& onSegment)
+{
+    ParseSegmentResults(input, SegmentResultEvents{ nullptr, onSegment, nullptr });
+}
+
+#ifdef _WIN32
+#include <cpprest/streams.h>
+
+// Adapts the body stream of an HTTP response to std::istream. Bytes are pulled in fixed-size
+// blocks as they arrive from the network, so the body is never buffered as a whole.
+class HttpBodyStreamBuffer : public std::streambuf
+{
+public:
+    explicit HttpBodyStreamBuffer(concurrency::streams::istream body, size_t blockSize = 64 * 1024)
+        : m_body(body), m_block(blockSize)
+    {
+        setg(m_block.data(), m_block.data(), m_block.data());
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+        {
+            return traits_type::to_int_type(*gptr());
+        }
+
+        auto read = m_body.streambuf().getn(reinterpret_cast<uint8_t*>(m_block.data()), m_block.size()).get();
+        if (read == 0)
+        {
+            return traits_type::eof();
+        }
+        setg(m_block.data(), m_block.data(), m_block.data() + read);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    concurrency::streams::istream m_body;
+    std::vector<char> m_block;
+};
+
+// Parses a transcription result from the body of an HTTP response while it is being received.
+inline void ParseSegmentResults(concurrency::streams::istream body, const SegmentResultEvents& events)
+{
+    HttpBodyStreamBuffer buffer(body);
+    std::istream input(&buffer);
+    ParseSegmentResults(input, events);
+}
+
+inline void ParseSegmentResults(concurrency::streams::istream body, const SegmentResultCallback& onSegment)
+{
+    ParseSegmentResults(body, SegmentResultEvents{ nullptr, onSegment, nullptr });
+}
+#endif
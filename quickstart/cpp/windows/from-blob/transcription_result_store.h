@@ -0,0 +1,294 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "transcription_models.h"
+
+// Non-owning reference to a string stored in a StringPool. Valid as long as the pool is not modified.
+struct StringRef
+{
+    const char* Data;
+    size_t Size;
+
+    std::string ToString() const
+    {
+        return std::string(Data, Size);
+    }
+
+    bool Equals(const char* value) const
+    {
+        return std::strlen(value) == Size && std::memcmp(Data, value, Size) == 0;
+    }
+};
+
+// Stores every distinct string once, back to back in a single buffer. Strings are identified by
+// a 32-bit id. Recognition results repeat a lot (statuses, and mostly identical Lexical/ITN/MaskedITN/Display
+// forms), so interning saves both memory and the allocations of one std::string per field.
+class StringPool
+{
+public:
+    StringPool()
+    {
+        // Id 0 is the empty string.
+        Intern(std::string());
+    }
+
+    uint32_t Intern(const std::string& value)
+    {
+        auto it = m_ids.find(value);
+        if (it != m_ids.end())
+        {
+            return it->second;
+        }
+
+        auto id = static_cast<uint32_t>(m_entries.size());
+        m_entries.push_back(Entry{ m_buffer.size(), value.size() });
+        m_buffer.append(value);
+        m_ids.emplace(value, id);
+        return id;
+    }
+
+    StringRef Get(uint32_t id) const
+    {
+        const auto& entry = m_entries.at(id);
+        return StringRef{ m_buffer.data() + entry.Offset, entry.Size };
+    }
+
+    size_t Count() const
+    {
+        return m_entries.size();
+    }
+
+    // Number of bytes of string data, excluding the lookup index.
+    size_t Bytes() const
+    {
+        return m_buffer.size() + m_entries.size() * sizeof(Entry);
+    }
+
+    // Drops the lookup index once no more strings are added. Get() keeps working.
+    void Seal()
+    {
+        std::unordered_map<std::string, uint32_t>().swap(m_ids);
+    }
+
+private:
+    struct Entry
+    {
+        size_t Offset;
+        size_t Size;
+    };
+
+    std::string m_buffer;
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, uint32_t> m_ids;
+};
+
+// Columnar store of transcription results. Every field is kept in its own flat vector, and strings
+// are interned, so that millions of segments can be kept and scanned without one heap allocation per
+// object. Segments of an audio file, and alternatives of a segment, are contiguous index ranges.
+//
+// Results are read through lightweight views that refer to the store by index and never copy.
+class TranscriptionResultStore
+{
+public:
+    class NBestView
+    {
+    public:
+        double Confidence() const { return m_store->m_nbestConfidence[m_index]; }
+        StringRef Lexical() const { return m_store->m_strings.Get(m_store->m_nbestLexical[m_index]); }
+        StringRef ITN() const { return m_store->m_strings.Get(m_store->m_nbestItn[m_index]); }
+        StringRef MaskedITN() const { return m_store->m_strings.Get(m_store->m_nbestMaskedItn[m_index]); }
+        StringRef Display() const { return m_store->m_strings.Get(m_store->m_nbestDisplay[m_index]); }
+
+    private:
+        friend class TranscriptionResultStore;
+        NBestView(const TranscriptionResultStore* store, size_t index) : m_store(store), m_index(index) {}
+
+        const TranscriptionResultStore* m_store;
+        size_t m_index;
+    };
+
+    class SegmentView
+    {
+    public:
+        StringRef RecognitionStatus() const { return m_store->m_strings.Get(m_store->m_segmentStatus[m_index]); }
+        uint64_t Offset() const { return m_store->m_segmentOffset[m_index]; }
+        uint64_t Duration() const { return m_store->m_segmentDuration[m_index]; }
+
+        size_t NBestCount() const { return m_store->m_segmentNBestCount[m_index]; }
+        NBestView NBest(size_t i) const { return NBestView(m_store, m_store->m_segmentFirstNBest[m_index] + i); }
+
+    private:
+        friend class TranscriptionResultStore;
+        SegmentView(const TranscriptionResultStore* store, size_t index) : m_store(store), m_index(index) {}
+
+        const TranscriptionResultStore* m_store;
+        size_t m_index;
+    };
+
+    class AudioFileView
+    {
+    public:
+        StringRef AudioFileName() const { return m_store->m_strings.Get(m_store->m_files[m_index].NameId); }
+        size_t SegmentCount() const { return m_store->m_files[m_index].SegmentCount; }
+        SegmentView Segment(size_t i) const { return SegmentView(m_store, m_store->m_files[m_index].FirstSegment + i); }
+
+        template<class Function>
+        void ForEachSegment(Function function) const
+        {
+            const auto& file = m_store->m_files[m_index];
+            for (size_t i = 0; i < file.SegmentCount; i++)
+            {
+                function(SegmentView(m_store, file.FirstSegment + i));
+            }
+        }
+
+    private:
+        friend class TranscriptionResultStore;
+        AudioFileView(const TranscriptionResultStore* store, size_t index) : m_store(store), m_index(index) {}
+
+        const TranscriptionResultStore* m_store;
+        size_t m_index;
+    };
+
+    // Starts a new audio file. Segments added afterwards belong to it.
+    void BeginAudioFile(const std::string& audioFileName)
+    {
+        m_files.push_back(FileRecord{ m_strings.Intern(audioFileName), m_segmentOffset.size(), 0 });
+    }
+
+    // Appends a segment to the current audio file.
+    void AddSegment(const SegmentResult& segment)
+    {
+        if (m_files.empty())
+        {
+            throw std::logic_error("BeginAudioFile must be called before segments are added.");
+        }
+
+        m_segmentStatus.push_back(m_strings.Intern(segment.RecognitionStatus));
+        m_segmentOffset.push_back(segment.Offset);
+        m_segmentDuration.push_back(segment.Duration);
+        m_segmentFirstNBest.push_back(static_cast<uint32_t>(m_nbestConfidence.size()));
+        m_segmentNBestCount.push_back(static_cast<uint32_t>(segment.NBest.size()));
+
+        for (const auto& nbest : segment.NBest)
+        {
+            m_nbestConfidence.push_back(nbest.Confidence);
+            m_nbestLexical.push_back(m_strings.Intern(nbest.Lexical));
+            m_nbestItn.push_back(m_strings.Intern(nbest.ITN));
+            m_nbestMaskedItn.push_back(m_strings.Intern(nbest.MaskedITN));
+            m_nbestDisplay.push_back(m_strings.Intern(nbest.Display));
+        }
+
+        m_files.back().SegmentCount++;
+    }
+
+    // Appends all audio files of a parsed result document.
+    void Add(const RootObject& root)
+    {
+        for (const auto& audioFile : root.AudioFileResults)
+        {
+            BeginAudioFile(audioFile.AudioFileName);
+            for (const auto& segment : audioFile.SegmentResults)
+            {
+                AddSegment(segment);
+            }
+        }
+    }
+
+    // Releases spare capacity and the string lookup index once all results are added.
+    void Seal()
+    {
+        m_strings.Seal();
+        m_files.shrink_to_fit();
+        m_segmentStatus.shrink_to_fit();
+        m_segmentOffset.shrink_to_fit();
+        m_segmentDuration.shrink_to_fit();
+        m_segmentFirstNBest.shrink_to_fit();
+        m_segmentNBestCount.shrink_to_fit();
+        m_nbestConfidence.shrink_to_fit();
+        m_nbestLexical.shrink_to_fit();
+        m_nbestItn.shrink_to_fit();
+        m_nbestMaskedItn.shrink_to_fit();
+        m_nbestDisplay.shrink_to_fit();
+    }
+
+    size_t AudioFileCount() const { return m_files.size(); }
+    AudioFileView AudioFile(size_t i) const { return AudioFileView(this, i); }
+
+    size_t SegmentCount() const { return m_segmentOffset.size(); }
+    SegmentView Segment(size_t i) const { return SegmentView(this, i); }
+
+    template<class Function>
+    void ForEachAudioFile(Function function) const
+    {
+        for (size_t i = 0; i < m_files.size(); i++)
+        {
+            function(AudioFileView(this, i));
+        }
+    }
+
+    // Visits all segments of all audio files in order.
+    template<class Function>
+    void ForEachSegment(Function function) const
+    {
+        for (size_t i = 0; i < m_segmentOffset.size(); i++)
+        {
+            function(SegmentView(this, i));
+        }
+    }
+
+    // Direct access to the offset and duration columns, e.g. for vectorized post-processing.
+    const std::vector<uint64_t>& Offsets() const { return m_segmentOffset; }
+    const std::vector<uint64_t>& Durations() const { return m_segmentDuration; }
+
+    const StringPool& Strings() const { return m_strings; }
+
+    // Approximate number of bytes used by the stored results.
+    size_t Bytes() const
+    {
+        return m_strings.Bytes() +
+            m_files.capacity() * sizeof(FileRecord) +
+            m_segmentStatus.capacity() * sizeof(uint32_t) +
+            m_segmentOffset.capacity() * sizeof(uint64_t) +
+            m_segmentDuration.capacity() * sizeof(uint64_t) +
+            m_segmentFirstNBest.capacity() * sizeof(uint32_t) +
+            m_segmentNBestCount.capacity() * sizeof(uint32_t) +
+            m_nbestConfidence.capacity() * sizeof(double) +
+            (m_nbestLexical.capacity() + m_nbestItn.capacity() + m_nbestMaskedItn.capacity() + m_nbestDisplay.capacity()) * sizeof(uint32_t);
+    }
+
+private:
+    struct FileRecord
+    {
+        uint32_t NameId;
+        size_t FirstSegment;
+        size_t SegmentCount;
+    };
+
+    StringPool m_strings;
+    std::vector<FileRecord> m_files;
+
+    // Segment columns.
+    std::vector<uint32_t> m_segmentStatus;
+    std::vector<uint64_t> m_segmentOffset;
+    std::vector<uint64_t> m_segmentDuration;
+    std::vector<uint32_t> m_segmentFirstNBest;
+    std::vector<uint32_t> m_segmentNBestCount;
+
+    // NBest columns.
+    std::vector<double> m_nbestConfidence;
+    std::vector<uint32_t> m_nbestLexical;
+    std::vector<uint32_t> m_nbestItn;
+    std::vector<uint32_t> m_nbestMaskedItn;
+    std::vector<uint32_t> m_nbestDisplay;
+};
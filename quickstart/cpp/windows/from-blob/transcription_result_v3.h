@@ -0,0 +1,756 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Decoder for the v3 transcription result format described by samples/batch/transcriptionresult_v3.schema.json.
+//
+// The decoder works in place on a buffer that holds the whole result document. Strings are returned as
+// views into that buffer, so decoding allocates nothing per value; the only allocation is the nBest scratch
+// vector, which is reused across phrases and documents. The member names of every object of the schema are
+// dispatched on FNV-1a hashes that are computed at compile time, and only the members the decoder reports
+// are validated: they must be present if the schema requires them, and have the type and range it defines.
+// All other members (e.g. timestamp, the ISO 8601 offset/duration strings and words) are skipped.
+namespace TranscriptionResultV3
+{
+    // View of a JSON string in the input buffer, without the quotes. Escape sequences are kept as they
+    // are in the input; ToString() decodes them.
+    struct Text
+    {
+        const char* Data = nullptr;
+        size_t Size = 0;
+        bool HasEscapes = false;
+
+        bool Equals(const char* value) const
+        {
+            return !HasEscapes && std::strlen(value) == Size && std::memcmp(Data, value, Size) == 0;
+        }
+
+        std::string ToString() const;
+    };
+
+    // #root/combinedRecognizedPhrases/items
+    struct CombinedPhrase
+    {
+        uint32_t Channel = 0;
+        Text Lexical;
+        Text ITN;
+        Text MaskedITN;
+        Text Display;
+    };
+
+    // #root/recognizedPhrases/items/nBest/items
+    struct NBestEntry
+    {
+        double Confidence = 0;
+        // 0 if the result has no speaker separation.
+        uint32_t Speaker = 0;
+        Text Lexical;
+        Text ITN;
+        Text MaskedITN;
+        Text Display;
+    };
+
+    // #root/recognizedPhrases/items. NBest points to scratch storage of the decoder and is only valid
+    // during the callback.
+    struct RecognizedPhrase
+    {
+        Text RecognitionStatus;
+        uint32_t Channel = 0;
+        uint64_t OffsetInTicks = 0;
+        uint64_t DurationInTicks = 0;
+        const NBestEntry* NBest = nullptr;
+        size_t NBestCount = 0;
+    };
+
+    // #root, without the phrase arrays, which are reported through the handler.
+    struct Header
+    {
+        Text Source;
+        uint64_t DurationInTicks = 0;
+        size_t CombinedPhraseCount = 0;
+        size_t RecognizedPhraseCount = 0;
+    };
+
+    class DecodeError : public std::runtime_error
+    {
+    public:
+        DecodeError(size_t position, const std::string& message)
+            : std::runtime_error("Invalid transcription result at byte " + std::to_string(position) + ": " + message),
+              m_position(position)
+        {
+        }
+
+        size_t Position() const { return m_position; }
+
+    private:
+        size_t m_position;
+    };
+
+    namespace Schema
+    {
+        // FNV-1a. Used at compile time for the member names of the schema, and at run time for the
+        // member names in the input. Two names of the same object that collide fail to compile as
+        // duplicate case labels.
+        constexpr uint32_t Hash(const char* name, uint32_t hash = 2166136261u)
+        {
+            return *name == '\0' ? hash : Hash(name + 1, (hash ^ static_cast<uint8_t>(*name)) * 16777619u);
+        }
+
+        inline uint32_t Hash(const Text& name)
+        {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < name.Size; i++)
+            {
+                hash = (hash ^ static_cast<uint8_t>(name.Data[i])) * 16777619u;
+            }
+            return hash;
+        }
+    }
+
+    // Pull tokenizer over the input buffer. Never reads past the end of the buffer, which does not need
+    // to be null-terminated.
+    class Cursor
+    {
+    public:
+        Cursor(const char* data, size_t size)
+            : m_begin(data), m_pos(data), m_end(data + size)
+        {
+        }
+
+        [[noreturn]] void Fail(const std::string& message) const
+        {
+            throw DecodeError(static_cast<size_t>(m_pos - m_begin), message);
+        }
+
+        char Peek()
+        {
+            SkipWhitespace();
+            if (m_pos == m_end)
+            {
+                Fail("unexpected end of input");
+            }
+            return *m_pos;
+        }
+
+        void Expect(char c)
+        {
+            if (Peek() != c)
+            {
+                Fail(std::string("expected '") + c + "'");
+            }
+            m_pos++;
+        }
+
+        bool TryConsume(char c)
+        {
+            if (Peek() != c)
+            {
+                return false;
+            }
+            m_pos++;
+            return true;
+        }
+
+        void ExpectEnd()
+        {
+            SkipWhitespace();
+            if (m_pos != m_end)
+            {
+                Fail("unexpected data after the result object");
+            }
+        }
+
+        Text ReadString()
+        {
+            Expect('"');
+            Text text;
+            text.Data = m_pos;
+            for (;;)
+            {
+                if (m_pos == m_end)
+                {
+                    Fail("unterminated string");
+                }
+                auto c = static_cast<uint8_t>(*m_pos);
+                if (c == '"')
+                {
+                    break;
+                }
+                if (c == '\\')
+                {
+                    text.HasEscapes = true;
+                    if (++m_pos == m_end)
+                    {
+                        Fail("unterminated string");
+                    }
+                }
+                else if (c < 0x20)
+                {
+                    Fail("control character in string");
+                }
+                m_pos++;
+            }
+            text.Size = static_cast<size_t>(m_pos - text.Data);
+            m_pos++;
+            return text;
+        }
+
+        // Schema type integer with minimum 0.
+        uint64_t ReadUnsigned()
+        {
+            if (Peek() == '-')
+            {
+                Fail("expected a non-negative integer");
+            }
+            uint64_t value = 0;
+            auto start = m_pos;
+            while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+            {
+                auto digit = static_cast<uint64_t>(*m_pos - '0');
+                if (value > (UINT64_MAX - digit) / 10)
+                {
+                    Fail("integer out of range");
+                }
+                value = value * 10 + digit;
+                m_pos++;
+            }
+            if (m_pos == start || (m_pos != m_end && (*m_pos == '.' || *m_pos == 'e' || *m_pos == 'E')))
+            {
+                Fail("expected a non-negative integer");
+            }
+            return value;
+        }
+
+        uint32_t ReadUnsigned32()
+        {
+            auto value = ReadUnsigned();
+            if (value > UINT32_MAX)
+            {
+                Fail("integer out of range");
+            }
+            return static_cast<uint32_t>(value);
+        }
+
+        // Schema type number with minimum 0.0 and maximum 1.0.
+        double ReadUnitNumber()
+        {
+            auto value = ReadNonNegativeNumber();
+            if (value > 1.0)
+            {
+                Fail("number out of range");
+            }
+            return value;
+        }
+
+        // Schema type number with minimum 0.0.
+        double ReadNonNegativeNumber()
+        {
+            if (Peek() == '-')
+            {
+                Fail("expected a non-negative number");
+            }
+
+            // Up to 19 significant digits are kept exactly, which is more than a double holds.
+            uint64_t mantissa = 0;
+            int digits = 0;
+            int exponent = 0;
+            auto start = m_pos;
+            for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; m_pos++)
+            {
+                AddDigit(mantissa, digits, exponent, *m_pos, false);
+            }
+            if (m_pos == start)
+            {
+                Fail("expected a number");
+            }
+            if (m_pos != m_end && *m_pos == '.')
+            {
+                m_pos++;
+                auto fractionStart = m_pos;
+                for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; m_pos++)
+                {
+                    AddDigit(mantissa, digits, exponent, *m_pos, true);
+                }
+                if (m_pos == fractionStart)
+                {
+                    Fail("expected a digit after the decimal point");
+                }
+            }
+            if (m_pos != m_end && (*m_pos == 'e' || *m_pos == 'E'))
+            {
+                m_pos++;
+                bool negative = false;
+                if (m_pos != m_end && (*m_pos == '+' || *m_pos == '-'))
+                {
+                    negative = *m_pos == '-';
+                    m_pos++;
+                }
+                auto exponentStart = m_pos;
+                int value = 0;
+                for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; m_pos++)
+                {
+                    value = (std::min)(value * 10 + (*m_pos - '0'), 100000);
+                }
+                if (m_pos == exponentStart)
+                {
+                    Fail("expected a digit in the exponent");
+                }
+                exponent += negative ? -value : value;
+            }
+            return ScaleByPowerOf10(static_cast<double>(mantissa), exponent);
+        }
+
+        // Skips a value of any type. Only the nesting of objects and arrays, and strings are checked.
+        void SkipValue()
+        {
+            auto c = Peek();
+            if (c == '"')
+            {
+                ReadString();
+                return;
+            }
+            if (c == '{' || c == '[')
+            {
+                m_pos++;
+                size_t depth = 1;
+                while (depth > 0)
+                {
+                    if (m_pos == m_end)
+                    {
+                        Fail("unexpected end of input");
+                    }
+                    c = *m_pos;
+                    if (c == '"')
+                    {
+                        ReadString();
+                        continue;
+                    }
+                    if (c == '{' || c == '[')
+                    {
+                        depth++;
+                    }
+                    else if (c == '}' || c == ']')
+                    {
+                        depth--;
+                    }
+                    m_pos++;
+                }
+                return;
+            }
+
+            // Number or literal.
+            auto start = m_pos;
+            while (m_pos != m_end && *m_pos != ',' && *m_pos != '}' && *m_pos != ']' && !IsWhitespace(*m_pos))
+            {
+                m_pos++;
+            }
+            if (m_pos == start)
+            {
+                Fail("expected a value");
+            }
+        }
+
+        // Calls onMember(key) for every member; onMember must consume the value.
+        template<class Function>
+        void ReadObject(Function onMember)
+        {
+            Expect('{');
+            if (TryConsume('}'))
+            {
+                return;
+            }
+            do
+            {
+                auto key = ReadString();
+                Expect(':');
+                onMember(key);
+            } while (TryConsume(','));
+            Expect('}');
+        }
+
+        // Calls onElement(index) for every element; onElement must consume the element. Returns the element count.
+        template<class Function>
+        size_t ReadArray(Function onElement)
+        {
+            Expect('[');
+            if (TryConsume(']'))
+            {
+                return 0;
+            }
+            size_t count = 0;
+            do
+            {
+                onElement(count++);
+            } while (TryConsume(','));
+            Expect(']');
+            return count;
+        }
+
+        // Fails unless all fields in names[i] with bit i set in required have been seen.
+        void RequireFields(uint32_t seen, std::initializer_list<const char*> names, const char* object) const
+        {
+            uint32_t bit = 1;
+            for (auto name : names)
+            {
+                if ((seen & bit) == 0)
+                {
+                    Fail(std::string("missing required field '") + name + "' in " + object);
+                }
+                bit <<= 1;
+            }
+        }
+
+    private:
+        static bool IsWhitespace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        void SkipWhitespace()
+        {
+            while (m_pos != m_end && IsWhitespace(*m_pos))
+            {
+                m_pos++;
+            }
+        }
+
+        static void AddDigit(uint64_t& mantissa, int& digits, int& exponent, char c, bool isFraction)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+                if (mantissa != 0)
+                {
+                    digits++;
+                }
+                if (isFraction)
+                {
+                    exponent--;
+                }
+            }
+            else if (!isFraction)
+            {
+                exponent++;
+            }
+        }
+
+        static double ScaleByPowerOf10(double value, int exponent)
+        {
+            static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+            if (value == 0)
+            {
+                return 0;
+            }
+            if (exponent >= 0 && exponent <= 22)
+            {
+                return value * powers[exponent];
+            }
+            if (exponent < 0 && exponent >= -22)
+            {
+                return value / powers[-exponent];
+            }
+            return value * std::pow(10.0, exponent);
+        }
+
+        const char* m_begin;
+        const char* m_pos;
+        const char* m_end;
+    };
+
+    // Decodes v3 result documents. Reuse one decoder for many documents to reuse its scratch storage.
+    //
+    // The handler needs these members:
+    //     void OnCombinedPhrase(const CombinedPhrase& phrase);
+    //     void OnRecognizedPhrase(const RecognizedPhrase& phrase);
+    // Phrases are reported in document order. All views point into the input buffer.
+    class Decoder
+    {
+    public:
+        template<class Handler>
+        Header Decode(const char* data, size_t size, Handler& handler)
+        {
+            Cursor cursor(data, size);
+            Header header;
+            uint32_t seen = 0;
+
+            cursor.ReadObject([&](const Text& key)
+            {
+                switch (Schema::Hash(key))
+                {
+                case Schema::Hash("source"):
+                    if (!key.Equals("source")) break;
+                    header.Source = cursor.ReadString();
+                    seen |= 1 << 0;
+                    return;
+                case Schema::Hash("durationInTicks"):
+                    if (!key.Equals("durationInTicks")) break;
+                    header.DurationInTicks = cursor.ReadUnsigned();
+                    seen |= 1 << 1;
+                    return;
+                case Schema::Hash("combinedRecognizedPhrases"):
+                    if (!key.Equals("combinedRecognizedPhrases")) break;
+                    header.CombinedPhraseCount = cursor.ReadArray([&](size_t) { handler.OnCombinedPhrase(ReadCombinedPhrase(cursor)); });
+                    seen |= 1 << 2;
+                    return;
+                case Schema::Hash("recognizedPhrases"):
+                    if (!key.Equals("recognizedPhrases")) break;
+                    header.RecognizedPhraseCount = cursor.ReadArray([&](size_t) { handler.OnRecognizedPhrase(ReadRecognizedPhrase(cursor)); });
+                    seen |= 1 << 3;
+                    return;
+                }
+                cursor.SkipValue();
+            });
+            cursor.RequireFields(seen, { "source", "durationInTicks", "combinedRecognizedPhrases", "recognizedPhrases" }, "the result");
+            cursor.ExpectEnd();
+            return header;
+        }
+
+    private:
+        static CombinedPhrase ReadCombinedPhrase(Cursor& cursor)
+        {
+            CombinedPhrase phrase;
+            uint32_t seen = 0;
+
+            cursor.ReadObject([&](const Text& key)
+            {
+                switch (Schema::Hash(key))
+                {
+                case Schema::Hash("channel"):
+                    if (!key.Equals("channel")) break;
+                    phrase.Channel = cursor.ReadUnsigned32();
+                    seen |= 1 << 0;
+                    return;
+                case Schema::Hash("lexical"):
+                    if (!key.Equals("lexical")) break;
+                    phrase.Lexical = cursor.ReadString();
+                    seen |= 1 << 1;
+                    return;
+                case Schema::Hash("itn"):
+                    if (!key.Equals("itn")) break;
+                    phrase.ITN = cursor.ReadString();
+                    seen |= 1 << 2;
+                    return;
+                case Schema::Hash("maskedITN"):
+                    if (!key.Equals("maskedITN")) break;
+                    phrase.MaskedITN = cursor.ReadString();
+                    seen |= 1 << 3;
+                    return;
+                case Schema::Hash("display"):
+                    if (!key.Equals("display")) break;
+                    phrase.Display = cursor.ReadString();
+                    seen |= 1 << 4;
+                    return;
+                }
+                cursor.SkipValue();
+            });
+            cursor.RequireFields(seen, { "channel", "lexical", "itn", "maskedITN", "display" }, "a combined recognized phrase");
+            return phrase;
+        }
+
+        RecognizedPhrase ReadRecognizedPhrase(Cursor& cursor)
+        {
+            RecognizedPhrase phrase;
+            uint32_t seen = 0;
+            m_nbest.clear();
+
+            cursor.ReadObject([&](const Text& key)
+            {
+                switch (Schema::Hash(key))
+                {
+                case Schema::Hash("recognitionStatus"):
+                    if (!key.Equals("recognitionStatus")) break;
+                    phrase.RecognitionStatus = cursor.ReadString();
+                    seen |= 1 << 0;
+                    return;
+                case Schema::Hash("channel"):
+                    if (!key.Equals("channel")) break;
+                    phrase.Channel = cursor.ReadUnsigned32();
+                    seen |= 1 << 1;
+                    return;
+                case Schema::Hash("offsetInTicks"):
+                    if (!key.Equals("offsetInTicks")) break;
+                    phrase.OffsetInTicks = cursor.ReadUnsigned();
+                    seen |= 1 << 2;
+                    return;
+                case Schema::Hash("durationInTicks"):
+                    if (!key.Equals("durationInTicks")) break;
+                    phrase.DurationInTicks = cursor.ReadUnsigned();
+                    seen |= 1 << 3;
+                    return;
+                case Schema::Hash("nBest"):
+                    if (!key.Equals("nBest")) break;
+                    cursor.ReadArray([&](size_t) { m_nbest.push_back(ReadNBestEntry(cursor)); });
+                    seen |= 1 << 4;
+                    return;
+                }
+                cursor.SkipValue();
+            });
+            cursor.RequireFields(seen, { "recognitionStatus", "channel", "offsetInTicks", "durationInTicks", "nBest" }, "a recognized phrase");
+
+            phrase.NBest = m_nbest.data();
+            phrase.NBestCount = m_nbest.size();
+            return phrase;
+        }
+
+        static NBestEntry ReadNBestEntry(Cursor& cursor)
+        {
+            NBestEntry entry;
+            uint32_t seen = 0;
+
+            cursor.ReadObject([&](const Text& key)
+            {
+                switch (Schema::Hash(key))
+                {
+                case Schema::Hash("confidence"):
+                    if (!key.Equals("confidence")) break;
+                    entry.Confidence = cursor.ReadUnitNumber();
+                    seen |= 1 << 0;
+                    return;
+                case Schema::Hash("lexical"):
+                    if (!key.Equals("lexical")) break;
+                    entry.Lexical = cursor.ReadString();
+                    seen |= 1 << 1;
+                    return;
+                case Schema::Hash("itn"):
+                    if (!key.Equals("itn")) break;
+                    entry.ITN = cursor.ReadString();
+                    seen |= 1 << 2;
+                    return;
+                case Schema::Hash("maskedITN"):
+                    if (!key.Equals("maskedITN")) break;
+                    entry.MaskedITN = cursor.ReadString();
+                    seen |= 1 << 3;
+                    return;
+                case Schema::Hash("display"):
+                    if (!key.Equals("display")) break;
+                    entry.Display = cursor.ReadString();
+                    seen |= 1 << 4;
+                    return;
+                case Schema::Hash("speaker"):
+                    if (!key.Equals("speaker")) break;
+                    entry.Speaker = cursor.ReadUnsigned32();
+                    if (entry.Speaker < 1)
+                    {
+                        cursor.Fail("speaker must be at least 1");
+                    }
+                    return;
+                }
+                cursor.SkipValue();
+            });
+            cursor.RequireFields(seen, { "confidence", "lexical", "itn", "maskedITN", "display" }, "an nBest entry");
+            return entry;
+        }
+
+        std::vector<NBestEntry> m_nbest;
+    };
+
+    inline void AppendUtf8(std::string& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    inline bool ParseHex4(const char* p, const char* end, uint32_t& value)
+    {
+        if (end - p < 4)
+        {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char c = p[i];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    inline std::string Text::ToString() const
+    {
+        if (!HasEscapes)
+        {
+            return std::string(Data, Size);
+        }
+
+        std::string out;
+        out.reserve(Size);
+        const char* end = Data + Size;
+        for (const char* p = Data; p < end; p++)
+        {
+            if (*p != '\\' || p + 1 == end)
+            {
+                out += *p;
+                continue;
+            }
+            switch (*++p)
+            {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                uint32_t codePoint;
+                if (!ParseHex4(p + 1, end, codePoint))
+                {
+                    throw std::runtime_error("Invalid \\u escape sequence in transcription result string.");
+                }
+                p += 4;
+
+                // Characters outside the basic multilingual plane are encoded as surrogate pairs.
+                uint32_t low;
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF && end - p > 6 && p[1] == '\\' && p[2] == 'u' &&
+                    ParseHex4(p + 3, end, low) && low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                AppendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                // \" \\ and \/
+                out += *p;
+                break;
+            }
+        }
+        return out;
+    }
+}
@@ -0,0 +1,118 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "transcription_result_v3.h"
+
+// Measures the throughput of the v3 decoder. A synthetic result document of the requested size is
+// generated once and decoded repeatedly until the requested total volume has been processed, so that
+// multi-GB result sets can be simulated without holding them in memory. For reference, the same document
+// is also parsed once into an nlohmann::json DOM.
+namespace TranscriptionResultV3Benchmark
+{
+    // Accumulates values of every phrase, so that the decoding work cannot be optimized away.
+    struct ChecksumHandler
+    {
+        uint64_t Phrases = 0;
+        uint64_t Ticks = 0;
+        uint64_t DisplayChars = 0;
+
+        void OnCombinedPhrase(const TranscriptionResultV3::CombinedPhrase& phrase)
+        {
+            DisplayChars += phrase.Display.Size;
+        }
+
+        void OnRecognizedPhrase(const TranscriptionResultV3::RecognizedPhrase& phrase)
+        {
+            Phrases++;
+            Ticks += phrase.OffsetInTicks + phrase.DurationInTicks;
+            if (phrase.NBestCount > 0)
+            {
+                DisplayChars += phrase.NBest[0].Display.Size;
+            }
+        }
+    };
+
+    // Creates a result document of about the specified size, shaped like a real result with word-level timestamps.
+    inline std::string CreateDocument(size_t targetBytes)
+    {
+        const char* words[] = { "hello", "thank", "you", "for", "calling", "please", "hold", "the", "line" };
+        const size_t wordCount = sizeof(words) / sizeof(words[0]);
+
+        std::string document =
+            "{\"source\":\"https://contoso.blob.core.windows.net/audio/call.wav\",\"timestamp\":\"2020-06-16T09:30:21Z\","
+            "\"durationInTicks\":0,\"duration\":\"PT0S\",\"combinedRecognizedPhrases\":[{\"channel\":0,\"lexical\":\"hello\","
+            "\"itn\":\"hello\",\"maskedITN\":\"hello\",\"display\":\"Hello.\"}],\"recognizedPhrases\":[";
+        document.reserve(targetBytes + 4096);
+
+        uint64_t offset = 0;
+        for (size_t i = 0; document.size() < targetBytes; i++)
+        {
+            if (i > 0)
+            {
+                document += ',';
+            }
+
+            std::string lexical;
+            std::string wordArray;
+            uint64_t wordOffset = offset;
+            for (size_t w = 0; w < 6; w++)
+            {
+                const char* word = words[(i + w) % wordCount];
+                lexical += (w > 0 ? " " : "") + std::string(word);
+                wordArray += std::string(w > 0 ? "," : "") + "{\"word\":\"" + word + "\",\"offset\":\"PT1S\",\"duration\":\"PT0.3S\","
+                    "\"offsetInTicks\":" + std::to_string(wordOffset) + ",\"durationInTicks\":3000000,\"confidence\":0.91}";
+                wordOffset += 3000000;
+            }
+
+            document += "{\"recognitionStatus\":\"Success\",\"channel\":0,\"offset\":\"PT1S\",\"duration\":\"PT1.8S\","
+                "\"offsetInTicks\":" + std::to_string(offset) + ",\"durationInTicks\":18000000,\"nBest\":[";
+            for (int n = 0; n < 2; n++)
+            {
+                document += std::string(n > 0 ? "," : "") + "{\"confidence\":0.9" + std::to_string(n) + ",\"speaker\":1,"
+                    "\"lexical\":\"" + lexical + "\",\"itn\":\"" + lexical + "\",\"maskedITN\":\"" + lexical + "\",\"display\":\"" + lexical + ".\","
+                    "\"words\":[" + wordArray + "]}";
+            }
+            document += "]}";
+            offset += 20000000;
+        }
+        document += "]}";
+        return document;
+    }
+
+    inline void Run(uint64_t totalMegabytes, uint64_t documentMegabytes)
+    {
+        auto document = CreateDocument(static_cast<size_t>(documentMegabytes) * 1024 * 1024);
+        auto passes = (std::max)(static_cast<uint64_t>(1), totalMegabytes / (std::max)(static_cast<uint64_t>(1), documentMegabytes));
+        std::cout << "Decoding a " << document.size() << " byte v3 result " << passes << " times" << std::endl;
+
+        TranscriptionResultV3::Decoder decoder;
+        ChecksumHandler handler;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t pass = 0; pass < passes; pass++)
+        {
+            decoder.Decode(document.data(), document.size(), handler);
+        }
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto bytes = static_cast<double>(document.size()) * passes;
+        std::cout << "v3 decoder: " << bytes / (1024 * 1024 * 1024) << " GB in " << seconds << " s, "
+                  << bytes / (1024 * 1024) / seconds << " MB/s, " << handler.Phrases / seconds << " phrases/s"
+                  << " (checksum " << handler.Ticks << "/" << handler.DisplayChars << ")" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        auto dom = nlohmann::json::parse(document);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "nlohmann::json DOM: " << document.size() / (1024.0 * 1024) / seconds << " MB/s ("
+                  << dom.at("recognizedPhrases").size() << " phrases)" << std::endl;
+    }
+}
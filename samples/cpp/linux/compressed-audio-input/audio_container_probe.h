@@ -0,0 +1,345 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <speechapi_cxx.h>
+#include "g711_decoder.h"
+
+// Read-only memory mapping of a whole file, hinted for sequential access, so that the kernel reads ahead in
+// large blocks and no intermediate stdio buffer is copied through.
+class MappedAudioFile final
+{
+public:
+    MappedAudioFile() = default;
+    MappedAudioFile(const MappedAudioFile&) = delete;
+    MappedAudioFile& operator=(const MappedAudioFile&) = delete;
+
+    ~MappedAudioFile()
+    {
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+    }
+
+    // Returns false if the file cannot be opened or mapped, or is empty.
+    bool Open(const std::string& fileName)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        m_data = static_cast<const uint8_t*>(data);
+        m_size = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// What the probe found out about a file: the stream format to use, and which bytes of the file are the stream.
+struct ProbedAudio
+{
+    // Name of the detected format, e.g. "MP3"; empty if the format is unknown.
+    std::string Name;
+
+    // Null if the format is unknown or not supported, e.g. Ogg Vorbis.
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::Audio::AudioStreamFormat> Format;
+
+    // The audio stream within the file, e.g. without the header of a wave file.
+    size_t Offset = 0;
+    size_t Size = 0;
+
+    // Set for the compressed formats, which the SDK decodes with GStreamer.
+    bool IsCompressed = false;
+    Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat Container = Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat::MP3;
+
+    // Set for A-law and mu-law audio, which can be decoded in process with G711::Decoder instead of by the SDK.
+    // Raw files are assumed to be 8 kHz mono telephony audio.
+    bool IsG711 = false;
+    G711::Law G711Law = G711::Law::ALaw;
+    uint32_t SamplesPerSec = 8000;
+    uint16_t Channels = 1;
+};
+
+// Detects the container format of audio files from their first bytes, instead of from their file names.
+//
+// Probes run in order, each checks the magic bytes of one format; add a probe to support another format.
+// Headerless formats (raw A-law and mu-law) have no magic bytes and are told by the file name extension, which
+// takes precedence over every probe but RIFF/WAVE: raw G.711 audio can start with bytes that look like magic
+// bytes, e.g. 0xff 0xfb of an MPEG audio frame header.
+class AudioContainerProbe final
+{
+public:
+    static ProbedAudio Probe(const uint8_t* data, size_t size, const std::string& fileName)
+    {
+        using namespace Microsoft::CognitiveServices::Speech::Audio;
+
+        typedef bool (*ProbeFunction)(const uint8_t*, size_t, ProbedAudio&);
+        static const ProbeFunction probes[] = { ProbeOgg, ProbeFlac, ProbeMp3 };
+
+        ProbedAudio probed;
+        probed.Size = size;
+        if (ProbeWave(data, size, probed))
+        {
+            return probed;
+        }
+        if (probed.Name.empty())
+        {
+            if (EndsWith(fileName, ".alaw"))
+            {
+                return Compressed(probed, "A-law", AudioStreamContainerFormat::ALAW);
+            }
+            if (EndsWith(fileName, ".mulaw") || EndsWith(fileName, ".ulaw"))
+            {
+                return Compressed(probed, "mu-law", AudioStreamContainerFormat::MULAW);
+            }
+        }
+
+        for (auto probe : probes)
+        {
+            if (probe(data, size, probed))
+            {
+                return probed;
+            }
+        }
+        if (!probed.Name.empty())
+        {
+            // A known container with unsupported content, e.g. Ogg Vorbis.
+            probed.Format = nullptr;
+        }
+        return probed;
+    }
+
+private:
+    static ProbedAudio& Compressed(ProbedAudio& probed, const char* name, Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat format)
+    {
+        using Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat;
+
+        probed.Name = name;
+        probed.Format = Microsoft::CognitiveServices::Speech::Audio::AudioStreamFormat::GetCompressedFormat(format);
+        probed.IsCompressed = true;
+        probed.Container = format;
+        probed.IsG711 = format == AudioStreamContainerFormat::ALAW || format == AudioStreamContainerFormat::MULAW;
+        probed.G711Law = format == AudioStreamContainerFormat::ALAW ? G711::Law::ALaw : G711::Law::MuLaw;
+        return probed;
+    }
+
+    static bool StartsWith(const uint8_t* data, size_t size, const char* magic, size_t offset = 0)
+    {
+        auto length = strlen(magic);
+        return size >= offset + length && memcmp(data + offset, magic, length) == 0;
+    }
+
+    static bool EndsWith(const std::string& text, const std::string& suffix)
+    {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    static uint32_t ReadLittleEndian(const uint8_t* data, int size)
+    {
+        uint32_t value = 0;
+        for (int i = size - 1; i >= 0; i--)
+        {
+            value = (value << 8) | data[i];
+        }
+        return value;
+    }
+
+    // RIFF/WAVE: PCM is streamed as PCM, A-law and mu-law as such; only the data chunk is streamed.
+    static bool ProbeWave(const uint8_t* data, size_t size, ProbedAudio& probed)
+    {
+        using namespace Microsoft::CognitiveServices::Speech::Audio;
+
+        if (!StartsWith(data, size, "RIFF") || !StartsWith(data, size, "WAVE", 8))
+        {
+            return false;
+        }
+        probed.Name = "RIFF/WAVE";
+
+        uint32_t formatTag = 0, channels = 0, samplesPerSec = 0, bitsPerSample = 0;
+        for (size_t chunk = 12; chunk + 8 <= size; )
+        {
+            auto chunkSize = static_cast<size_t>(ReadLittleEndian(data + chunk + 4, 4));
+            auto body = chunk + 8;
+            if (StartsWith(data, size, "fmt ", chunk) && chunkSize >= 16 && body + 16 <= size)
+            {
+                formatTag = ReadLittleEndian(data + body, 2);
+                channels = ReadLittleEndian(data + body + 2, 2);
+                samplesPerSec = ReadLittleEndian(data + body + 4, 4);
+                bitsPerSample = ReadLittleEndian(data + body + 14, 2);
+            }
+            else if (StartsWith(data, size, "data", chunk))
+            {
+                probed.Offset = body;
+                probed.Size = (std::min)(chunkSize, size - body);
+                probed.SamplesPerSec = samplesPerSec;
+                probed.Channels = static_cast<uint16_t>(channels);
+
+                switch (formatTag)
+                {
+                case 1:
+                    probed.Name = "RIFF/WAVE PCM";
+                    probed.Format = AudioStreamFormat::GetWaveFormatPCM(samplesPerSec, static_cast<uint8_t>(bitsPerSample), static_cast<uint8_t>(channels));
+                    return true;
+                case 6:
+                    Compressed(probed, "RIFF/WAVE A-law", AudioStreamContainerFormat::ALAW);
+                    return true;
+                case 7:
+                    Compressed(probed, "RIFF/WAVE mu-law", AudioStreamContainerFormat::MULAW);
+                    return true;
+                default:
+                    return false;
+                }
+            }
+            // Chunks are padded to an even size.
+            chunk = body + chunkSize + (chunkSize & 1);
+        }
+        return false;
+    }
+
+    // Ogg: only Opus is supported; the first page holds the identification header of the codec.
+    static bool ProbeOgg(const uint8_t* data, size_t size, ProbedAudio& probed)
+    {
+        if (!StartsWith(data, size, "OggS"))
+        {
+            return false;
+        }
+        probed.Name = "Ogg";
+        if (size < 27)
+        {
+            return false;
+        }
+        // The first packet follows the segment table of the first page.
+        auto packet = 27 + static_cast<size_t>(data[26]);
+        if (!StartsWith(data, size, "OpusHead", packet))
+        {
+            return false;
+        }
+        Compressed(probed, "Ogg Opus", Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat::OGG_OPUS);
+        return true;
+    }
+
+    static bool ProbeFlac(const uint8_t* data, size_t size, ProbedAudio& probed)
+    {
+        if (!StartsWith(data, size, "fLaC"))
+        {
+            return false;
+        }
+        Compressed(probed, "FLAC", Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat::FLAC);
+        return true;
+    }
+
+    // MP3: an ID3v2 tag, or an MPEG audio frame header right at the start. Without a tag, the first bytes of other audio
+    // can match a frame header by chance, so the header of the second frame must follow the first frame.
+    static bool ProbeMp3(const uint8_t* data, size_t size, ProbedAudio& probed)
+    {
+        size_t frame = 0;
+        if (StartsWith(data, size, "ID3") && size >= 10)
+        {
+            // The tag size is stored in 4 bytes of 7 bits each, without the 10 byte header and the optional footer.
+            frame = 10 + ((data[6] & 0x7f) << 21 | (data[7] & 0x7f) << 14 | (data[8] & 0x7f) << 7 | (data[9] & 0x7f));
+            if (data[5] & 0x10)
+            {
+                frame += 10;
+            }
+            if (frame >= size)
+            {
+                // A tag without audio after it; still an mp3 file.
+                Compressed(probed, "MP3", Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat::MP3);
+                return true;
+            }
+        }
+        if (!IsMpegAudioFrameHeader(data + frame, size - frame))
+        {
+            return false;
+        }
+        if (frame == 0)
+        {
+            auto length = MpegAudioFrameLength(data);
+            if (length == 0 || length > size || (length < size && !IsMpegAudioFrameHeader(data + length, size - length)))
+            {
+                return false;
+            }
+        }
+        Compressed(probed, "MP3", Microsoft::CognitiveServices::Speech::Audio::AudioStreamContainerFormat::MP3);
+        return true;
+    }
+
+    // 11 sync bits, a valid version, layer (not the reserved 00, which ADTS AAC uses), bitrate and sample rate.
+    static bool IsMpegAudioFrameHeader(const uint8_t* header, size_t size)
+    {
+        return size >= 4 &&
+            header[0] == 0xff && (header[1] & 0xe0) == 0xe0 &&
+            (header[1] & 0x18) != 0x08 &&
+            (header[1] & 0x06) != 0x00 &&
+            (header[2] & 0xf0) != 0xf0 &&
+            (header[2] & 0x0c) != 0x0c;
+    }
+
+    // Length in bytes of the frame of a valid frame header, including the header; 0 for free format frames, whose
+    // length is not in the header.
+    static size_t MpegAudioFrameLength(const uint8_t* header)
+    {
+        // Bitrates in kbit/s by bitrate index, for MPEG-1 layers I, II and III, and MPEG-2 and 2.5 layers I and II/III.
+        static const uint16_t bitrates[5][15] =
+        {
+            { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+            { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+            { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+        };
+        static const uint32_t sampleRates[3] = { 44100, 48000, 32000 };
+
+        auto version = (header[1] >> 3) & 0x03; // 3: MPEG-1, 2: MPEG-2, 0: MPEG-2.5
+        auto layer = 4 - ((header[1] >> 1) & 0x03);
+        auto bitrate = 1000u * bitrates[version == 3 ? layer - 1 : (layer == 1 ? 3 : 4)][header[2] >> 4];
+        auto sampleRate = sampleRates[(header[2] >> 2) & 0x03] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+        auto padding = (header[2] >> 1) & 0x01;
+        if (bitrate == 0)
+        {
+            return 0;
+        }
+
+        if (layer == 1)
+        {
+            return (12 * bitrate / sampleRate + padding) * 4;
+        }
+        // Layer III frames of MPEG-2 and 2.5 hold half the samples.
+        auto samplesPerFrame = layer == 3 && version != 3 ? 576u : 1152u;
+        return samplesPerFrame / 8 * bitrate / sampleRate + padding;
+    }
+};
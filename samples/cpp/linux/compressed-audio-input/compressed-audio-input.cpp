@@ -3,100 +3,192 @@
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
 
+#include <future>
 #include <iostream> // cin, cout
+#include <memory>
+#include <vector>
 #include <speechapi_cxx.h>
+#include "audio_container_probe.h"
+#include "g711_decoder.h"
+#ifdef HAVE_GSTREAMER
+#include "gstreamer_pipeline_pool.h"
+#endif
 
 using namespace Microsoft::CognitiveServices::Speech;
 using namespace Microsoft::CognitiveServices::Speech::Audio;
 
-static void* OpenCompressedFile(const std::string& compressedFileName)
+// State of a pull stream that reads the audio from a memory-mapped file.
+struct MappedAudioStream
 {
-    FILE *filep = NULL;
-    filep = fopen(compressedFileName.c_str(), "rb");
-    return filep;
-}
+    MappedAudioFile File;
+    size_t Position = 0;
+    size_t End = 0;
+
+    // Set if the stream decodes A-law or mu-law audio to 16 bit PCM as it is read.
+    std::unique_ptr<G711::Decoder> Decoder;
+};
 
-static void closeStream(void* fp)
+static void closeStream(void* stream)
 {
-    if (fp != NULL)
-    {
-        fclose((FILE*)fp);
-    }
+    delete static_cast<MappedAudioStream*>(stream);
 }
 
+// Copies the next bytes straight from the mapping; the kernel reads the file ahead in large blocks.
 static int ReadCompressedBinaryData(void *stream, uint8_t *ptr, uint32_t bufSize)
 {
-    FILE* compressedStreamfptr = (FILE*)stream;
-    if (compressedStreamfptr != NULL && !feof(compressedStreamfptr))
-    {
-        return fread(ptr, 1, bufSize, compressedStreamfptr);
-    }
-    else
-    {
-        return 0;
-    }
+    auto mappedStream = static_cast<MappedAudioStream*>(stream);
+    auto size = (std::min)(static_cast<size_t>(bufSize), mappedStream->End - mappedStream->Position);
+    memcpy(ptr, mappedStream->File.Data() + mappedStream->Position, size);
+    mappedStream->Position += size;
+    return static_cast<int>(size);
 }
 
-void recognizeSpeech(const std::string& compressedFileName)
+// Decodes the next samples from the mapping straight into the buffer of the SDK, one byte per sample.
+static int ReadG711Data(void *stream, uint8_t *ptr, uint32_t bufSize)
 {
-    std::shared_ptr<SpeechRecognizer> recognizer;
-    std::shared_ptr<PullAudioInputStream> pullAudioStream;
+    auto mappedStream = static_cast<MappedAudioStream*>(stream);
+    auto count = (std::min)(static_cast<size_t>(bufSize / sizeof(int16_t)), mappedStream->End - mappedStream->Position);
+    mappedStream->Decoder->Decode(mappedStream->File.Data() + mappedStream->Position, count, reinterpret_cast<int16_t*>(ptr));
+    mappedStream->Position += count;
+    return static_cast<int>(count * sizeof(int16_t));
+}
+
+// Decodes A-law or mu-law audio in process to 16 bit PCM, so that the SDK does not need to start a GStreamer
+// pipeline for the stream. The audio is decoded as the recognizer reads it, so that recognition neither waits
+// for the whole file to be decoded nor holds the decoded file in memory.
+static std::shared_ptr<AudioInputStream> DecodeG711(const ProbedAudio& probed, std::unique_ptr<MappedAudioStream> mappedStream)
+{
+    mappedStream->Position = probed.Offset;
+    mappedStream->End = probed.Offset + probed.Size;
+    mappedStream->Decoder.reset(new G711::Decoder(probed.G711Law));
+
+    // The stream owns the mapping from now on and releases it in closeStream.
+    return AudioInputStream::CreatePullStream(
+        AudioStreamFormat::GetWaveFormatPCM(probed.SamplesPerSec, 16, static_cast<uint8_t>(probed.Channels)),
+        mappedStream.release(),
+        ReadG711Data,
+        closeStream
+    );
+}
 
-    void *compressedFilePtr = OpenCompressedFile(compressedFileName);
+#ifdef HAVE_GSTREAMER
+// Shared by all files, so that a file reuses the decode pipeline of a previous file of the same format.
+static GStreamerPipelinePool& DecodePipelines()
+{
+    static GStreamerPipelinePool pool;
+    return pool;
+}
 
-    if (compressedFilePtr == NULL)
+static CompressedContainer ToCompressedContainer(AudioStreamContainerFormat format)
+{
+    switch (format)
     {
-        std::cout << "Error: Input file doesn't exist" << std::endl;
-        return;
+    case AudioStreamContainerFormat::OGG_OPUS:
+        return CompressedContainer::OggOpus;
+    case AudioStreamContainerFormat::FLAC:
+        return CompressedContainer::Flac;
+    case AudioStreamContainerFormat::ALAW:
+        return CompressedContainer::ALaw;
+    case AudioStreamContainerFormat::MULAW:
+        return CompressedContainer::MuLaw;
+    default:
+        return CompressedContainer::Mp3;
     }
+}
 
-    // Creates an instance of a speech config with specified subscription key and service region.
-    // Replace with your own subscription key and service region (e.g., "westus").
-    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+// Decodes compressed audio with a pooled GStreamer pipeline and pushes it as 16 kHz 16 bit mono PCM, so that
+// the SDK does not build a decode graph per stream. The audio is decoded on a separate thread while the
+// recognizer reads the stream, so that recognition starts with the first decoded audio instead of after the
+// whole file; data must stay valid until decoding is done.
+static std::shared_ptr<PushAudioInputStream> DecodeWithPipeline(const ProbedAudio& probed, const uint8_t* data, std::future<void>& decoding)
+{
+    auto pushStream = AudioInputStream::CreatePushStream(AudioStreamFormat::GetWaveFormatPCM(16000, 16, 1));
+    auto container = ToCompressedContainer(probed.Container);
+    auto audio = data + probed.Offset;
+    auto audioSize = probed.Size;
+    decoding = std::async(std::launch::async, [pushStream, container, audio, audioSize]()
+    {
+        try
+        {
+            auto pipeline = DecodePipelines().Acquire(container);
+            pipeline->Decode(audio, audioSize, [&pushStream](const uint8_t* pcm, size_t size)
+            {
+                // The stream copies the data.
+                pushStream->Write(const_cast<uint8_t*>(pcm), static_cast<uint32_t>(size));
+            });
+        }
+        catch (...)
+        {
+            // Ends the stream anyway, so that the recognizer does not wait for audio that never comes.
+            pushStream->Close();
+            throw;
+        }
+        pushStream->Close();
+    });
+    return pushStream;
+}
+#endif
 
-    AudioStreamContainerFormat inputFormat;
+void recognizeSpeech(const std::shared_ptr<SpeechConfig>& config, const std::string& compressedFileName, bool decodeInProcess)
+{
+    std::shared_ptr<SpeechRecognizer> recognizer;
+    std::shared_ptr<AudioInputStream> audioStream;
 
-    if (compressedFileName.find(".mp3") == (compressedFileName.size() - 4))
-    {
-        inputFormat = AudioStreamContainerFormat::MP3;
-    }
-    else if (compressedFileName.find(".opus") == (compressedFileName.size() - 5))
+    std::unique_ptr<MappedAudioStream> mappedStream(new MappedAudioStream());
+    if (!mappedStream->File.Open(compressedFileName))
     {
-        inputFormat = AudioStreamContainerFormat::OGG_OPUS;
+        std::cout << "Error: Input file doesn't exist or is empty" << std::endl;
+        return;
     }
-    else if (compressedFileName.find(".alaw") == (compressedFileName.size() - 5))
+    // Declared after the mapping, so that decoding is done before the mapping is released.
+    std::future<void> decoding;
+
+    // Detects the format from the content of the file, so that files of any supported format can be mixed
+    // without configuring each of them. Only raw A-law and mu-law files, which have no header, need the
+    // .alaw or .mulaw extension.
+    auto probed = AudioContainerProbe::Probe(mappedStream->File.Data(), mappedStream->File.Size(), compressedFileName);
+    if (!probed.Format)
     {
-        inputFormat = AudioStreamContainerFormat::ALAW;
+        std::cout << "Error: " << (probed.Name.empty() ? "Unknown" : probed.Name) << " input files are not supported. "
+                  << "Supported are MP3, Ogg Opus, FLAC, A-law, mu-law and PCM wave files." << std::endl;
+        return;
     }
-    else if (compressedFileName.find(".mulaw") == (compressedFileName.size() - 6))
+    std::cout << "Detected format: " << probed.Name << std::endl;
+
+    if (probed.IsG711 && decodeInProcess)
     {
-        inputFormat = AudioStreamContainerFormat::MULAW;
+        std::cout << "Decoding " << probed.Name << " in process" << (G711::Decoder::HasSimd() ? " with SSE2" : "") << std::endl;
+        audioStream = DecodeG711(probed, std::move(mappedStream));
     }
-    else if (compressedFileName.find(".flac") == (compressedFileName.size() - 5))
+#ifdef HAVE_GSTREAMER
+    else if (probed.IsCompressed && decodeInProcess)
     {
-        inputFormat = AudioStreamContainerFormat::FLAC;
+        std::cout << "Decoding " << probed.Name << " with a pooled GStreamer pipeline" << std::endl;
+        audioStream = DecodeWithPipeline(probed, mappedStream->File.Data(), decoding);
     }
+#endif
     else
     {
-        std::cout << "Only Opus and MP3 input files are currently supported" << std::endl;
-        return;
-    }
+        mappedStream->Position = probed.Offset;
+        mappedStream->End = probed.Offset + probed.Size;
 
-    pullAudioStream = AudioInputStream::CreatePullStream(
-        AudioStreamFormat::GetCompressedFormat(inputFormat),
-        compressedFilePtr,
-        ReadCompressedBinaryData,
-        closeStream
-    );
-    recognizer = SpeechRecognizer::FromConfig(config, AudioConfig::FromStreamInput(pullAudioStream));
+        // The stream owns the mapping from now on and releases it in closeStream.
+        audioStream = AudioInputStream::CreatePullStream(
+            probed.Format,
+            mappedStream.release(),
+            ReadCompressedBinaryData,
+            closeStream
+        );
+    }
+    recognizer = SpeechRecognizer::FromConfig(config, AudioConfig::FromStreamInput(audioStream));
 
     std::cout << "Recognizing ..." << std::endl;
 
     // Starts speech recognition, and returns after a single utterance is recognized. The end of a
     // single utterance is determined by listening for silence at the end or until a maximum of 15
-    // seconds of audio is processed.  The task returns the recognition text as result. 
+    // seconds of audio is processed.  The task returns the recognition text as result.
     // Note: Since RecognizeOnceAsync() returns only a single utterance, it is suitable only for single
-    // shot recognition like command or query. 
+    // shot recognition like command or query.
     // For long-running multi-utterance recognition, use StartContinuousRecognitionAsync() instead.
     auto result = recognizer->RecognizeOnceAsync().get();
 
@@ -117,15 +209,50 @@ void recognizeSpeech(const std::string& compressedFileName)
             std::cout << "CANCELED: Did you update the subscription info?" << std::endl;
         }
     }
+
+    if (decoding.valid())
+    {
+        try
+        {
+            decoding.get();
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Error: Decoding failed: " << e.what() << std::endl;
+        }
+    }
 }
 
 int main(int argc, char **argv) {
-    if (argc != 2)
+    std::vector<std::string> fileNames;
+    bool decodeInProcess = true;
+    for (int i = 1; i < argc; i++)
+    {
+        // --sdk-decoding leaves the decoding of compressed audio to the SDK, e.g. for comparison.
+        if (std::string(argv[i]) == "--sdk-decoding")
+        {
+            decodeInProcess = false;
+        }
+        else
+        {
+            fileNames.push_back(argv[i]);
+        }
+    }
+    if (fileNames.empty())
     {
-        std::cout << "Usage: ./compressed-audio-input <filename>" << std::endl;
+        std::cout << "Usage: ./compressed-audio-input [--sdk-decoding] <filename> [<filename> ...]" << std::endl;
         return 0;
     }
     setlocale(LC_ALL, "");
-    recognizeSpeech(argv[1]);
+
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+
+    for (const auto& fileName : fileNames)
+    {
+        std::cout << "File: " << fileName << std::endl;
+        recognizeSpeech(config, fileName, decodeInProcess);
+    }
     return 0;
 }
@@ -0,0 +1,232 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+// Measures the CPU time and memory per concurrent call of decoding G.711 telephony audio: in process with the
+// table and SSE2 paths of G711::Decoder, and (if built with GStreamer) with a GStreamer pipeline per call, like
+// the SDK decodes compressed input streams.
+//
+// Every call receives 20 ms frames of 8 kHz audio, as from an RTP stream; the calls are spread over one worker
+// thread per core. This benchmark does not need the Speech SDK or a subscription.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "g711_decoder.h"
+
+#ifdef HAVE_GSTREAMER
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+#endif
+
+static const size_t SamplesPerSec = 8000;
+static const size_t FrameSamples = SamplesPerSec / 50;
+
+// A call decodes one frame of FrameSamples bytes at a time.
+class Call
+{
+public:
+    virtual ~Call() = default;
+    virtual void DecodeFrame(const uint8_t* frame) = 0;
+};
+
+class InProcessCall final : public Call
+{
+public:
+    InProcessCall(G711::Law law, bool useSimd)
+        : m_decoder(law), m_useSimd(useSimd), m_pcm(FrameSamples)
+    {
+    }
+
+    void DecodeFrame(const uint8_t* frame) override
+    {
+        if (m_useSimd)
+        {
+            m_decoder.Decode(frame, FrameSamples, m_pcm.data());
+        }
+        else
+        {
+            m_decoder.DecodeWithTable(frame, FrameSamples, m_pcm.data());
+        }
+    }
+
+private:
+    G711::Decoder m_decoder;
+    bool m_useSimd;
+    std::vector<int16_t> m_pcm;
+};
+
+#ifdef HAVE_GSTREAMER
+// appsrc ! alawdec/mulawdec ! appsink; every frame is pushed and its decoded buffer pulled again.
+class GStreamerCall final : public Call
+{
+public:
+    explicit GStreamerCall(G711::Law law)
+    {
+        std::string description = law == G711::Law::ALaw
+            ? "appsrc name=source caps=audio/x-alaw,rate=8000,channels=1 ! alawdec ! appsink name=sink sync=false"
+            : "appsrc name=source caps=audio/x-mulaw,rate=8000,channels=1 ! mulawdec ! appsink name=sink sync=false";
+        GError* error = nullptr;
+        m_pipeline = gst_parse_launch(description.c_str(), &error);
+        if (m_pipeline == nullptr)
+        {
+            std::string message = error != nullptr ? error->message : "unknown error";
+            g_clear_error(&error);
+            throw std::runtime_error("Failed to create the GStreamer pipeline: " + message);
+        }
+        m_source = gst_bin_get_by_name(GST_BIN(m_pipeline), "source");
+        m_sink = gst_bin_get_by_name(GST_BIN(m_pipeline), "sink");
+        gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
+    }
+
+    ~GStreamerCall() override
+    {
+        gst_app_src_end_of_stream(GST_APP_SRC(m_source));
+        gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        gst_object_unref(m_sink);
+        gst_object_unref(m_source);
+        gst_object_unref(m_pipeline);
+    }
+
+    void DecodeFrame(const uint8_t* frame) override
+    {
+        auto buffer = gst_buffer_new_allocate(nullptr, FrameSamples, nullptr);
+        gst_buffer_fill(buffer, 0, frame, FrameSamples);
+        // Takes the ownership of the buffer.
+        gst_app_src_push_buffer(GST_APP_SRC(m_source), buffer);
+        auto sample = gst_app_sink_pull_sample(GST_APP_SINK(m_sink));
+        if (sample != nullptr)
+        {
+            gst_sample_unref(sample);
+        }
+    }
+
+private:
+    GstElement* m_pipeline;
+    GstElement* m_source;
+    GstElement* m_sink;
+};
+#endif
+
+static double ProcessCpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// The resident set size of the process, from /proc/self/statm.
+static double ResidentKilobytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+static void Run(const std::string& name, size_t callCount, size_t seconds, const std::vector<uint8_t>& audio,
+    const std::function<std::unique_ptr<Call>()>& createCall)
+{
+    auto residentBefore = ResidentKilobytes();
+    std::vector<std::unique_ptr<Call>> calls;
+    for (size_t i = 0; i < callCount; i++)
+    {
+        calls.push_back(createCall());
+    }
+    auto residentPerCall = (ResidentKilobytes() - residentBefore) / callCount;
+
+    auto frames = seconds * SamplesPerSec / FrameSamples;
+    auto workerCount = (std::max)(1u, std::thread::hardware_concurrency());
+    auto cpuStart = ProcessCpuSeconds();
+    auto wallStart = std::chrono::steady_clock::now();
+
+    // Each worker decodes the next frame of all its calls in turn, and starts every call at a different position
+    // of the audio.
+    std::vector<std::thread> workers;
+    for (unsigned worker = 0; worker < workerCount; worker++)
+    {
+        workers.emplace_back([&, worker]()
+        {
+            for (size_t frame = 0; frame < frames; frame++)
+            {
+                for (size_t call = worker; call < callCount; call += workerCount)
+                {
+                    auto position = ((call + frame) * FrameSamples) % (audio.size() - FrameSamples + 1);
+                    calls[call]->DecodeFrame(audio.data() + position);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    auto cpuSeconds = ProcessCpuSeconds() - cpuStart;
+    auto wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    calls.clear();
+
+    // The CPU time one call needs for one second of audio; 1000 ms would use a whole core.
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(4)
+              << std::setw(16) << cpuSeconds * 1000 / (callCount * seconds)
+              << std::setw(12) << std::setprecision(1) << (std::max)(residentPerCall, 0.0)
+              << std::setw(16) << std::setprecision(0) << callCount * seconds / wallSeconds << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string(argv[1]) != "alaw" && std::string(argv[1]) != "mulaw")
+    {
+        std::cout << "Usage: ./g711-benchmark [alaw|mulaw] [<calls> [<seconds of audio per call>]]" << std::endl;
+        return 0;
+    }
+    auto law = argc > 1 && std::string(argv[1]) == "mulaw" ? G711::Law::MuLaw : G711::Law::ALaw;
+    size_t callCount = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+    size_t seconds = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 60;
+    if (callCount == 0 || seconds == 0)
+    {
+        std::cout << "The number of calls and the seconds must be greater than 0." << std::endl;
+        return 1;
+    }
+
+#ifdef HAVE_GSTREAMER
+    gst_init(&argc, &argv);
+#endif
+
+    // Ten seconds of random G.711 bytes, which take the same time to decode as speech.
+    std::vector<uint8_t> audio(10 * SamplesPerSec);
+    std::mt19937 random(42);
+    std::generate(audio.begin(), audio.end(), [&random]() { return static_cast<uint8_t>(random()); });
+
+    std::cout << callCount << " concurrent " << (law == G711::Law::ALaw ? "A-law" : "mu-law") << " calls, "
+              << seconds << " s of audio each, " << std::thread::hardware_concurrency() << " cores" << std::endl;
+    std::cout << std::left << std::setw(12) << "Decoder" << std::right << std::setw(16) << "CPU ms/call/s"
+              << std::setw(12) << "KB/call" << std::setw(16) << "Audio s/s" << std::endl;
+
+    Run("table", callCount, seconds, audio, [law]() { return std::unique_ptr<Call>(new InProcessCall(law, false)); });
+    if (G711::Decoder::HasSimd())
+    {
+        Run("sse2", callCount, seconds, audio, [law]() { return std::unique_ptr<Call>(new InProcessCall(law, true)); });
+    }
+#ifdef HAVE_GSTREAMER
+    Run("gstreamer", callCount, seconds, audio, [law]() { return std::unique_ptr<Call>(new GStreamerCall(law)); });
+#else
+    std::cout << "gstreamer   (not measured, build with the GStreamer development packages installed)" << std::endl;
+#endif
+    return 0;
+}
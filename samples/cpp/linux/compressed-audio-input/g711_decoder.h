@@ -0,0 +1,191 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define G711_DECODER_SSE2 1
+#endif
+
+// In-process G.711 (A-law and mu-law) to 16 bit linear PCM decoder, for telephony audio that would otherwise go
+// through a GStreamer pipeline of the Speech SDK per stream. Decoding needs no state, so one decoder serves any
+// number of concurrent calls.
+//
+// The SSE2 path decodes 16 samples per iteration with the arithmetic of the G.711 reference decoder; the table
+// path (one lookup per sample) is used for the remainder and where SSE2 is not available.
+namespace G711
+{
+    enum class Law
+    {
+        ALaw,
+        MuLaw
+    };
+
+    // The G.711 reference expansions of a single sample.
+    inline int16_t ExpandALaw(uint8_t value)
+    {
+        value ^= 0x55;
+        int magnitude = (value & 0x0f) << 4;
+        int segment = (value & 0x70) >> 4;
+        switch (segment)
+        {
+        case 0:
+            magnitude += 8;
+            break;
+        case 1:
+            magnitude += 0x108;
+            break;
+        default:
+            magnitude = (magnitude + 0x108) << (segment - 1);
+            break;
+        }
+        return static_cast<int16_t>((value & 0x80) ? magnitude : -magnitude);
+    }
+
+    inline int16_t ExpandMuLaw(uint8_t value)
+    {
+        value = ~value;
+        int magnitude = (((value & 0x0f) << 3) + 0x84) << ((value & 0x70) >> 4);
+        return static_cast<int16_t>((value & 0x80) ? (0x84 - magnitude) : (magnitude - 0x84));
+    }
+
+    class Decoder final
+    {
+    public:
+        explicit Decoder(Law law)
+            : m_law(law), m_table(law == Law::ALaw ? Tables().ALaw : Tables().MuLaw)
+        {
+        }
+
+        static bool HasSimd()
+        {
+#ifdef G711_DECODER_SSE2
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Decodes count samples; output must have room for count samples.
+        void Decode(const uint8_t* input, size_t count, int16_t* output) const
+        {
+            size_t done = 0;
+#ifdef G711_DECODER_SSE2
+            done = m_law == Law::ALaw ? DecodeALawSse2(input, count, output) : DecodeMuLawSse2(input, count, output);
+#endif
+            DecodeWithTable(input + done, count - done, output + done);
+        }
+
+        void DecodeWithTable(const uint8_t* input, size_t count, int16_t* output) const
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                output[i] = m_table[input[i]];
+            }
+        }
+
+    private:
+        struct ExpansionTables
+        {
+            int16_t ALaw[256];
+            int16_t MuLaw[256];
+
+            ExpansionTables()
+            {
+                for (int i = 0; i < 256; i++)
+                {
+                    ALaw[i] = ExpandALaw(static_cast<uint8_t>(i));
+                    MuLaw[i] = ExpandMuLaw(static_cast<uint8_t>(i));
+                }
+            }
+        };
+
+        static const ExpansionTables& Tables()
+        {
+            static const ExpansionTables tables;
+            return tables;
+        }
+
+#ifdef G711_DECODER_SSE2
+        // 1 << exponent for exponents 0..7 in 16 bit lanes. SSE2 has no per-lane shift, so the power is built from
+        // the three bits of the exponent and multiplied.
+        static __m128i PowerOfTwo(__m128i exponent)
+        {
+            const __m128i one = _mm_set1_epi16(1);
+            auto factor = [&](int bit, int valueMinusOne)
+            {
+                auto set = _mm_cmpeq_epi16(_mm_and_si128(exponent, _mm_set1_epi16(static_cast<short>(bit))), _mm_set1_epi16(static_cast<short>(bit)));
+                return _mm_add_epi16(one, _mm_and_si128(set, _mm_set1_epi16(static_cast<short>(valueMinusOne))));
+            };
+            return _mm_mullo_epi16(_mm_mullo_epi16(factor(1, 1), factor(2, 3)), factor(4, 15));
+        }
+
+        // Negates the lanes of value where mask is all ones.
+        static __m128i NegateWhere(__m128i value, __m128i mask)
+        {
+            return _mm_sub_epi16(_mm_xor_si128(value, mask), mask);
+        }
+
+        static __m128i ExpandALaw8(__m128i value)
+        {
+            value = _mm_xor_si128(value, _mm_set1_epi16(0x55));
+            auto mantissa = _mm_and_si128(value, _mm_set1_epi16(0x0f));
+            auto segment = _mm_and_si128(_mm_srli_epi16(value, 4), _mm_set1_epi16(0x07));
+
+            // (mantissa << 4) + 8, plus 0x100 for segments above 0, shifted by segment - 1 for those.
+            auto base = _mm_add_epi16(_mm_slli_epi16(mantissa, 4), _mm_set1_epi16(8));
+            base = _mm_add_epi16(base, _mm_and_si128(_mm_cmpgt_epi16(segment, _mm_setzero_si128()), _mm_set1_epi16(0x100)));
+            auto magnitude = _mm_mullo_epi16(base, PowerOfTwo(_mm_subs_epu16(segment, _mm_set1_epi16(1))));
+
+            auto negative = _mm_cmpeq_epi16(_mm_and_si128(value, _mm_set1_epi16(0x80)), _mm_setzero_si128());
+            return NegateWhere(magnitude, negative);
+        }
+
+        static __m128i ExpandMuLaw8(__m128i value)
+        {
+            value = _mm_xor_si128(value, _mm_set1_epi16(0xff));
+            auto mantissa = _mm_and_si128(value, _mm_set1_epi16(0x0f));
+            auto segment = _mm_and_si128(_mm_srli_epi16(value, 4), _mm_set1_epi16(0x07));
+
+            auto base = _mm_add_epi16(_mm_slli_epi16(mantissa, 3), _mm_set1_epi16(0x84));
+            auto magnitude = _mm_sub_epi16(_mm_mullo_epi16(base, PowerOfTwo(segment)), _mm_set1_epi16(0x84));
+
+            auto negative = _mm_cmpeq_epi16(_mm_and_si128(value, _mm_set1_epi16(0x80)), _mm_set1_epi16(0x80));
+            return NegateWhere(magnitude, negative);
+        }
+
+        // Decodes blocks of 16 samples; returns the number of samples decoded.
+        template<__m128i (*Expand)(__m128i)>
+        static size_t DecodeSse2(const uint8_t* input, size_t count, int16_t* output)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), Expand(_mm_unpacklo_epi8(bytes, zero)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 8), Expand(_mm_unpackhi_epi8(bytes, zero)));
+            }
+            return i;
+        }
+
+        static size_t DecodeALawSse2(const uint8_t* input, size_t count, int16_t* output)
+        {
+            return DecodeSse2<ExpandALaw8>(input, count, output);
+        }
+
+        static size_t DecodeMuLawSse2(const uint8_t* input, size_t count, int16_t* output)
+        {
+            return DecodeSse2<ExpandMuLaw8>(input, count, output);
+        }
+#endif
+
+        Law m_law;
+        const int16_t* m_table;
+    };
+}
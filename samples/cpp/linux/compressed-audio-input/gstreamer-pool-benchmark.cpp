@@ -0,0 +1,216 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+// Measures the per-stream setup time and resident memory of decoding compressed streams with a GStreamer
+// decode pipeline built for every stream, as the SDK does, and with pipelines recycled by a GStreamerPipelinePool.
+//
+// A number of streams run through a fixed number of concurrent slots, one thread per slot; every stream decodes
+// the whole audio file. Each mode runs in a fresh child process, so that neither measures memory that the other
+// mode has already grown the heap by. This benchmark does not need the Speech SDK or a subscription.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "gstreamer_pipeline_pool.h"
+
+static double ProcessCpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// The resident set size of the process, from /proc/self/statm.
+static double ResidentKilobytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// Runs streamCount streams through slotCount concurrent slots. startStream sets up the decoding of one stream
+// and returns a function that decodes it and tears it down. The memory per stream is measured from residentBefore.
+static void Run(const std::string& name, size_t streamCount, size_t slotCount, double residentBefore,
+    const std::function<std::function<void()>()>& startStream)
+{
+    auto cpuStart = ProcessCpuSeconds();
+    auto wallStart = std::chrono::steady_clock::now();
+
+    std::mutex mutex;
+    std::vector<double> setupMilliseconds;
+    double peakResident = residentBefore;
+    std::atomic<size_t> next(0);
+
+    std::vector<std::thread> slots;
+    for (size_t slot = 0; slot < slotCount; slot++)
+    {
+        slots.emplace_back([&]()
+        {
+            while (next++ < streamCount)
+            {
+                auto setupStart = std::chrono::steady_clock::now();
+                auto decode = startStream();
+                auto setup = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setupStart).count();
+                auto resident = ResidentKilobytes();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    setupMilliseconds.push_back(setup);
+                    peakResident = (std::max)(peakResident, resident);
+                }
+                decode();
+            }
+        });
+    }
+    for (auto& slot : slots)
+    {
+        slot.join();
+    }
+
+    auto cpuSeconds = ProcessCpuSeconds() - cpuStart;
+    auto wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    std::sort(setupMilliseconds.begin(), setupMilliseconds.end());
+    double setupSum = 0;
+    for (auto setup : setupMilliseconds)
+    {
+        setupSum += setup;
+    }
+    auto setupP95 = setupMilliseconds[(setupMilliseconds.size() * 95 + 99) / 100 - 1];
+
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(14) << setupSum / setupMilliseconds.size()
+              << std::setw(14) << setupP95
+              << std::setw(14) << std::setprecision(1) << (peakResident - residentBefore) / slotCount
+              << std::setw(12) << std::setprecision(2) << cpuSeconds
+              << std::setw(12) << wallSeconds << std::endl;
+}
+
+// Runs a mode in a child process that starts without any GStreamer state, and waits for it. GStreamer must not be
+// initialized in this process, since its threads do not survive fork().
+static bool RunInChildProcess(const std::function<void()>& mode)
+{
+    std::cout.flush();
+    auto pid = fork();
+    if (pid < 0)
+    {
+        std::cout << "Error: failed to start a child process" << std::endl;
+        return false;
+    }
+    if (pid == 0)
+    {
+        mode();
+        std::cout.flush();
+        _exit(0);
+    }
+    int status = 0;
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool ParseContainer(const std::string& name, CompressedContainer& container)
+{
+    static const std::pair<const char*, CompressedContainer> names[] = {
+        { "mp3", CompressedContainer::Mp3 }, { "opus", CompressedContainer::OggOpus }, { "flac", CompressedContainer::Flac },
+        { "alaw", CompressedContainer::ALaw }, { "mulaw", CompressedContainer::MuLaw } };
+    for (const auto& entry : names)
+    {
+        if (name == entry.first)
+        {
+            container = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    size_t streamCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500;
+    size_t slotCount = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50;
+    auto container = CompressedContainer::ALaw;
+    if (streamCount == 0 || slotCount == 0 || argc == 4 || (argc > 4 && !ParseContainer(argv[3], container)))
+    {
+        std::cout << "Usage: ./gstreamer-pool-benchmark [<streams> [<concurrent streams> [mp3|opus|flac|alaw|mulaw <audio file>]]]" << std::endl;
+        return 0;
+    }
+
+    // One second of random A-law bytes, unless an audio file is given.
+    std::vector<uint8_t> audio(8000);
+    if (argc > 4)
+    {
+        std::ifstream file(argv[4], std::ios::binary);
+        audio.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (audio.empty())
+        {
+            std::cout << "Error: " << argv[4] << " doesn't exist or is empty" << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::mt19937 random(42);
+        std::generate(audio.begin(), audio.end(), [&random]() { return static_cast<uint8_t>(random()); });
+    }
+    auto decodeInto = [&audio](DecodePipeline& pipeline)
+    {
+        pipeline.Decode(audio.data(), audio.size(), [](const uint8_t*, size_t) {});
+    };
+
+    std::cout << streamCount << " streams, " << slotCount << " concurrent, " << audio.size() << " bytes each" << std::endl;
+    std::cout << std::left << std::setw(12) << "Pipelines" << std::right << std::setw(14) << "Setup ms" << std::setw(14) << "Setup p95 ms"
+              << std::setw(14) << "KB/stream" << std::setw(12) << "CPU s" << std::setw(12) << "Wall s" << std::endl;
+
+    auto perStream = RunInChildProcess([&]()
+    {
+        gst_init(nullptr, nullptr);
+        // Loads the plugins, which happens once per process either way.
+        DecodePipeline(container).Start();
+
+        Run("per-stream", streamCount, slotCount, ResidentKilobytes(), [&]()
+        {
+            std::shared_ptr<DecodePipeline> pipeline(new DecodePipeline(container));
+            pipeline->Start();
+            return [pipeline, &decodeInto]() { decodeInto(*pipeline); };
+        });
+    });
+
+    auto pooled = RunInChildProcess([&]()
+    {
+        GStreamerPipelinePool pool(slotCount);
+        DecodePipeline(container).Start();
+
+        // The prewarmed pipelines count toward the memory of the pooled streams.
+        auto residentBefore = ResidentKilobytes();
+        auto prewarmStart = std::chrono::steady_clock::now();
+        pool.Prewarm(container, slotCount);
+        auto prewarm = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - prewarmStart).count();
+
+        Run("pooled", streamCount, slotCount, residentBefore, [&]()
+        {
+            auto pipeline = std::make_shared<PooledPipeline>(pool.Acquire(container));
+            return [pipeline, &decodeInto]() { decodeInto(**pipeline); };
+        });
+
+        std::cout << "Prewarming " << slotCount << " pipelines at startup took " << std::setprecision(1) << prewarm << " ms; "
+                  << pool.Created() << " pipelines were built, " << pool.Reused() << " streams reused one." << std::endl;
+    });
+
+    return perStream && pooled ? 0 : 1;
+}
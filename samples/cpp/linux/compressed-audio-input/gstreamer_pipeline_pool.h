@@ -0,0 +1,387 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+
+// The compressed formats that a DecodePipeline decodes, i.e. the containers of the compressed input streams of
+// the Speech SDK.
+enum class CompressedContainer
+{
+    Mp3,
+    OggOpus,
+    Flac,
+    ALaw,
+    MuLaw
+};
+
+// A GStreamer decode graph for one container format, appsrc ! parser ! decoder ! audioconvert ! audioresample !
+// appsink, which outputs 16 kHz 16 bit mono PCM for a PushAudioInputStream.
+//
+// Building the graph loads and instantiates all its elements; Reset() only returns them to READY, so that the
+// graph can decode the next stream of the same format without being built again. Uses the elements of the
+// plugins that spx_gst_init() registers for the SDK (on iOS, call it before building a graph).
+class DecodePipeline final
+{
+public:
+    explicit DecodePipeline(CompressedContainer container)
+        : m_container(container)
+    {
+        GError* error = nullptr;
+        m_pipeline = gst_parse_launch(Description(container), &error);
+        if (m_pipeline == nullptr)
+        {
+            std::string message = error != nullptr ? error->message : "unknown error";
+            g_clear_error(&error);
+            throw std::runtime_error("Failed to build the GStreamer decode pipeline: " + message);
+        }
+        // A pipeline with an error is only returned for recoverable errors.
+        g_clear_error(&error);
+
+        m_source = gst_bin_get_by_name(GST_BIN(m_pipeline), "source");
+        m_sink = gst_bin_get_by_name(GST_BIN(m_pipeline), "sink");
+        m_bus = gst_element_get_bus(m_pipeline);
+
+        // The Ogg demuxer adds its pad only once a stream starts, and removes it again on Reset(); links it for every
+        // stream, as the graph is reused.
+        auto demuxer = gst_bin_get_by_name(GST_BIN(m_pipeline), "demuxer");
+        if (demuxer != nullptr)
+        {
+            m_parser = gst_bin_get_by_name(GST_BIN(m_pipeline), "parser");
+            g_signal_connect(demuxer, "pad-added", G_CALLBACK(OnPadAdded), m_parser);
+            gst_object_unref(demuxer);
+        }
+
+        // READY allocates the resources of the elements, so that a stream only has to start the streaming threads.
+        if (gst_element_set_state(m_pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+        {
+            Destroy();
+            throw std::runtime_error("Failed to prepare the GStreamer decode pipeline.");
+        }
+    }
+
+    DecodePipeline(const DecodePipeline&) = delete;
+    DecodePipeline& operator=(const DecodePipeline&) = delete;
+
+    ~DecodePipeline()
+    {
+        Destroy();
+    }
+
+    CompressedContainer Container() const
+    {
+        return m_container;
+    }
+
+    // Starts a new stream.
+    void Start()
+    {
+        if (gst_element_set_state(m_pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+        {
+            ThrowIfFailed();
+            throw std::runtime_error("Failed to start the GStreamer decode pipeline.");
+        }
+    }
+
+    // Decodes a whole stream, handing the decoded PCM to onPcm as soon as it is available.
+    void Decode(const uint8_t* data, size_t size, const std::function<void(const uint8_t*, size_t)>& onPcm)
+    {
+        const size_t chunkSize = 64 * 1024;
+        std::vector<uint8_t> pcm;
+        for (size_t offset = 0; offset < size; offset += chunkSize)
+        {
+            Push(data + offset, (std::min)(chunkSize, size - offset));
+            while (Pull(pcm, std::chrono::milliseconds(0)))
+            {
+                onPcm(pcm.data(), pcm.size());
+            }
+        }
+
+        gst_app_src_end_of_stream(GST_APP_SRC(m_source));
+        while (!gst_app_sink_is_eos(GST_APP_SINK(m_sink)))
+        {
+            if (Pull(pcm, std::chrono::milliseconds(100)))
+            {
+                onPcm(pcm.data(), pcm.size());
+            }
+        }
+    }
+
+    // Returns the graph to READY, which drops all data and resets the state of the elements, but keeps them and
+    // their links. Returns false if the graph cannot be reused.
+    bool Reset()
+    {
+        auto result = gst_element_set_state(m_pipeline, GST_STATE_READY);
+
+        // Drops the messages of the finished stream, e.g. its end of stream or error.
+        while (auto message = gst_bus_pop(m_bus))
+        {
+            gst_message_unref(message);
+        }
+        return result != GST_STATE_CHANGE_FAILURE;
+    }
+
+private:
+    static const char* Description(CompressedContainer container)
+    {
+        // The caps of the appsink (16 kHz 16 bit mono) are quoted, as they contain commas.
+#define DECODE_PIPELINE_OUTPUT " ! audioconvert ! audioresample ! appsink name=sink sync=false caps=\"audio/x-raw,format=S16LE,rate=16000,channels=1\""
+        switch (container)
+        {
+        case CompressedContainer::Mp3:
+            return "appsrc name=source caps=audio/mpeg,mpegversion=1 ! mpegaudioparse ! mpg123audiodec" DECODE_PIPELINE_OUTPUT;
+        case CompressedContainer::OggOpus:
+            return "appsrc name=source caps=application/ogg ! oggdemux name=demuxer opusparse name=parser ! opusdec" DECODE_PIPELINE_OUTPUT;
+        case CompressedContainer::Flac:
+            return "appsrc name=source caps=audio/x-flac ! flacparse ! flacdec" DECODE_PIPELINE_OUTPUT;
+        case CompressedContainer::ALaw:
+            return "appsrc name=source caps=audio/x-alaw,rate=8000,channels=1 ! alawdec" DECODE_PIPELINE_OUTPUT;
+        case CompressedContainer::MuLaw:
+            return "appsrc name=source caps=audio/x-mulaw,rate=8000,channels=1 ! mulawdec" DECODE_PIPELINE_OUTPUT;
+        }
+#undef DECODE_PIPELINE_OUTPUT
+        throw std::invalid_argument("Unknown compressed container format.");
+    }
+
+    static void OnPadAdded(GstElement*, GstPad* pad, gpointer parser)
+    {
+        auto sinkPad = gst_element_get_static_pad(static_cast<GstElement*>(parser), "sink");
+        if (!gst_pad_is_linked(sinkPad))
+        {
+            gst_pad_link(pad, sinkPad);
+        }
+        gst_object_unref(sinkPad);
+    }
+
+    void Push(const uint8_t* data, size_t size)
+    {
+        auto buffer = gst_buffer_new_allocate(nullptr, size, nullptr);
+        gst_buffer_fill(buffer, 0, data, size);
+        // Takes the ownership of the buffer.
+        if (gst_app_src_push_buffer(GST_APP_SRC(m_source), buffer) != GST_FLOW_OK)
+        {
+            ThrowIfFailed();
+            throw std::runtime_error("The GStreamer decode pipeline does not accept data.");
+        }
+    }
+
+    // Replaces pcm with the next decoded buffer. Returns false if none was decoded within the timeout, or the
+    // stream ended.
+    bool Pull(std::vector<uint8_t>& pcm, std::chrono::milliseconds timeout)
+    {
+        auto sample = gst_app_sink_try_pull_sample(GST_APP_SINK(m_sink), static_cast<GstClockTime>(timeout.count()) * GST_MSECOND);
+        if (sample == nullptr)
+        {
+            ThrowIfFailed();
+            return false;
+        }
+
+        GstMapInfo map;
+        auto buffer = gst_sample_get_buffer(sample);
+        if (buffer != nullptr && gst_buffer_map(buffer, &map, GST_MAP_READ))
+        {
+            pcm.assign(map.data, map.data + map.size);
+            gst_buffer_unmap(buffer, &map);
+        }
+        else
+        {
+            pcm.clear();
+        }
+        gst_sample_unref(sample);
+        return true;
+    }
+
+    // Throws the error that stopped the pipeline, if any; e.g. for input that is not of the container format.
+    void ThrowIfFailed()
+    {
+        auto message = gst_bus_pop_filtered(m_bus, GST_MESSAGE_ERROR);
+        if (message == nullptr)
+        {
+            return;
+        }
+        GError* error = nullptr;
+        gchar* debug = nullptr;
+        gst_message_parse_error(message, &error, &debug);
+        std::string text = error != nullptr ? error->message : "unknown error";
+        g_clear_error(&error);
+        g_free(debug);
+        gst_message_unref(message);
+        throw std::runtime_error("GStreamer decode pipeline error: " + text);
+    }
+
+    void Destroy()
+    {
+        if (m_pipeline != nullptr)
+        {
+            gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        }
+        // GStreamer objects are C structs, not C++ classes derived from GstObject; gst_object_unref() takes a gpointer.
+        for (gpointer object : { static_cast<gpointer>(m_source), static_cast<gpointer>(m_sink), static_cast<gpointer>(m_parser), static_cast<gpointer>(m_bus), static_cast<gpointer>(m_pipeline) })
+        {
+            if (object != nullptr)
+            {
+                gst_object_unref(object);
+            }
+        }
+        m_source = m_sink = m_parser = m_pipeline = nullptr;
+        m_bus = nullptr;
+    }
+
+    CompressedContainer m_container;
+    GstElement* m_pipeline = nullptr;
+    GstElement* m_source = nullptr;
+    GstElement* m_sink = nullptr;
+    GstElement* m_parser = nullptr;
+    GstBus* m_bus = nullptr;
+};
+
+class GStreamerPipelinePool;
+
+// A pipeline leased from a GStreamerPipelinePool, started for one stream. Returns the pipeline to the pool when
+// destroyed.
+class PooledPipeline final
+{
+public:
+    PooledPipeline(PooledPipeline&& other) noexcept
+        : m_pool(other.m_pool), m_pipeline(std::move(other.m_pipeline))
+    {
+        other.m_pool = nullptr;
+    }
+
+    PooledPipeline(const PooledPipeline&) = delete;
+    PooledPipeline& operator=(const PooledPipeline&) = delete;
+    PooledPipeline& operator=(PooledPipeline&&) = delete;
+
+    inline ~PooledPipeline();
+
+    DecodePipeline* operator->() const { return m_pipeline.get(); }
+    DecodePipeline& operator*() const { return *m_pipeline; }
+
+private:
+    friend class GStreamerPipelinePool;
+
+    PooledPipeline(GStreamerPipelinePool* pool, std::unique_ptr<DecodePipeline>&& pipeline)
+        : m_pool(pool), m_pipeline(std::move(pipeline))
+    {
+    }
+
+    GStreamerPipelinePool* m_pool;
+    std::unique_ptr<DecodePipeline> m_pipeline;
+};
+
+// Thread-safe pool of decode pipelines keyed by container format, so that hundreds of concurrent compressed
+// streams recycle their decode graphs instead of building one per stream. Pipelines that fail to reset after a
+// stream are destroyed instead of being returned.
+class GStreamerPipelinePool final
+{
+public:
+    // maxIdlePerContainer limits the number of idle pipelines kept per container format.
+    explicit GStreamerPipelinePool(size_t maxIdlePerContainer = 64)
+        : m_maxIdlePerContainer(maxIdlePerContainer)
+    {
+        // Does nothing if GStreamer is initialized already.
+        gst_init(nullptr, nullptr);
+    }
+
+    GStreamerPipelinePool(const GStreamerPipelinePool&) = delete;
+    GStreamerPipelinePool& operator=(const GStreamerPipelinePool&) = delete;
+
+    // Builds pipelines ahead of the first streams, e.g. at startup for the expected number of concurrent streams.
+    void Prewarm(CompressedContainer container, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            std::unique_ptr<DecodePipeline> pipeline(new DecodePipeline(container));
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_created++;
+            auto& idle = m_idle[container];
+            if (idle.size() >= m_maxIdlePerContainer)
+            {
+                return;
+            }
+            idle.push_back(std::move(pipeline));
+        }
+    }
+
+    // Leases an idle pipeline of the container format, or builds one, and starts it for a new stream.
+    PooledPipeline Acquire(CompressedContainer container)
+    {
+        std::unique_ptr<DecodePipeline> pipeline;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& idle = m_idle[container];
+            if (!idle.empty())
+            {
+                pipeline = std::move(idle.back());
+                idle.pop_back();
+                m_reused++;
+            }
+        }
+        if (!pipeline)
+        {
+            pipeline.reset(new DecodePipeline(container));
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_created++;
+        }
+        pipeline->Start();
+        return PooledPipeline(this, std::move(pipeline));
+    }
+
+    // The number of pipelines that were built, and the number of leases that reused one.
+    uint64_t Created() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_created;
+    }
+
+    uint64_t Reused() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_reused;
+    }
+
+private:
+    friend class PooledPipeline;
+
+    void Release(std::unique_ptr<DecodePipeline>&& pipeline)
+    {
+        if (!pipeline->Reset())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& idle = m_idle[pipeline->Container()];
+        if (idle.size() < m_maxIdlePerContainer)
+        {
+            idle.push_back(std::move(pipeline));
+        }
+    }
+
+    size_t m_maxIdlePerContainer;
+    mutable std::mutex m_mutex;
+    std::map<CompressedContainer, std::vector<std::unique_ptr<DecodePipeline>>> m_idle;
+    uint64_t m_created = 0;
+    uint64_t m_reused = 0;
+};
+
+inline PooledPipeline::~PooledPipeline()
+{
+    if (m_pool != nullptr && m_pipeline)
+    {
+        m_pool->Release(std::move(m_pipeline));
+    }
+}
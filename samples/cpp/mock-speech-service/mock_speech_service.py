@@ -0,0 +1,431 @@
+#!/usr/bin/env python
+# coding: utf-8
+
+# Copyright (c) Microsoft. All rights reserved.
+# Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+"""
+A local stand-in for the websocket endpoints of the Speech service, for throughput and latency benchmarks of the
+samples without a subscription or a network connection.
+
+The Speech SDK connects to it with SpeechConfig::FromHost("ws://localhost:8080") or SpeechConfig::FromEndpoint().
+Recognition connections get canned phrases for the audio they send, synthesis connections get silent PCM audio and
+word boundaries for the text they send, each after configurable latencies. Only the Python standard library is used.
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import logging
+import re
+import signal
+import struct
+import sys
+import time
+import uuid
+
+WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+TICKS_PER_SECOND = 10000000
+
+OPCODE_CONTINUATION = 0x0
+OPCODE_TEXT = 0x1
+OPCODE_BINARY = 0x2
+OPCODE_CLOSE = 0x8
+OPCODE_PING = 0x9
+OPCODE_PONG = 0xA
+
+DEFAULT_PHRASES = [
+    "What's the weather like?",
+    "Turn on the lights in the living room.",
+    "Remind me to call my mother at six.",
+    "How long does it take to drive to Seattle?",
+]
+
+
+class WebSocket:
+    """The server side of a websocket connection (RFC 6455) on an asyncio stream."""
+
+    def __init__(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+        self.send_lock = asyncio.Lock()
+
+    @staticmethod
+    async def accept(reader, writer):
+        """Reads the HTTP upgrade request and completes the handshake. Returns the websocket and the request path."""
+        request = await reader.readuntil(b"\r\n\r\n")
+        lines = request.decode("latin-1").split("\r\n")
+        method, path = lines[0].split(" ")[:2]
+        headers = {}
+        for line in lines[1:]:
+            if ":" in line:
+                name, value = line.split(":", 1)
+                headers[name.strip().lower()] = value.strip()
+
+        key = headers.get("sec-websocket-key")
+        if method != "GET" or headers.get("upgrade", "").lower() != "websocket" or not key:
+            writer.write(b"HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n")
+            await writer.drain()
+            raise ConnectionError("not a websocket upgrade request")
+
+        accept = base64.b64encode(hashlib.sha1((key + WEBSOCKET_GUID).encode()).digest()).decode()
+        writer.write(("HTTP/1.1 101 Switching Protocols\r\n"
+                      "Upgrade: websocket\r\n"
+                      "Connection: Upgrade\r\n"
+                      "Sec-WebSocket-Accept: {}\r\n\r\n").format(accept).encode())
+        await writer.drain()
+        return WebSocket(reader, writer), path
+
+    async def receive(self):
+        """Returns the next message as (opcode, payload), with fragments joined; (OPCODE_CLOSE, b"") at the end."""
+        message_opcode = None
+        fragments = []
+        while True:
+            try:
+                first, second = await self.reader.readexactly(2)
+                length = second & 0x7F
+                if length == 126:
+                    length, = struct.unpack("!H", await self.reader.readexactly(2))
+                elif length == 127:
+                    length, = struct.unpack("!Q", await self.reader.readexactly(8))
+                mask = await self.reader.readexactly(4) if second & 0x80 else None
+                payload = await self.reader.readexactly(length)
+            except (asyncio.IncompleteReadError, ConnectionError):
+                return OPCODE_CLOSE, b""
+
+            if mask:
+                payload = _unmask(payload, mask)
+
+            opcode = first & 0x0F
+            if opcode == OPCODE_PING:
+                await self.send(OPCODE_PONG, payload)
+                continue
+            if opcode == OPCODE_PONG:
+                continue
+            if opcode == OPCODE_CLOSE:
+                await self.send(OPCODE_CLOSE, payload[:2])
+                return OPCODE_CLOSE, b""
+
+            if opcode != OPCODE_CONTINUATION:
+                message_opcode = opcode
+            fragments.append(payload)
+            if first & 0x80:
+                return message_opcode, b"".join(fragments)
+
+    async def send(self, opcode, payload):
+        header = bytes([0x80 | opcode])
+        if len(payload) < 126:
+            header += bytes([len(payload)])
+        elif len(payload) < 65536:
+            header += bytes([126]) + struct.pack("!H", len(payload))
+        else:
+            header += bytes([127]) + struct.pack("!Q", len(payload))
+        async with self.send_lock:
+            self.writer.write(header + payload)
+            await self.writer.drain()
+
+    def close(self):
+        self.writer.close()
+
+
+def _unmask(payload, mask):
+    """Unmasks a payload with integer arithmetic instead of a byte loop."""
+    repeated = (mask * (len(payload) // 4 + 1))[:len(payload)]
+    return (int.from_bytes(payload, "big") ^ int.from_bytes(repeated, "big")).to_bytes(len(payload), "big")
+
+
+def parse_message(opcode, payload):
+    """Splits a Speech service protocol message into its headers and body.
+
+    Text messages are headers and body separated by an empty line; binary messages start with the size of the
+    headers as a 16 bit big-endian integer.
+    """
+    if opcode == OPCODE_TEXT:
+        text = payload.decode("utf-8")
+        header_text, _, body = text.partition("\r\n\r\n")
+    else:
+        size, = struct.unpack("!H", payload[:2])
+        header_text = payload[2:2 + size].decode("utf-8")
+        body = payload[2 + size:]
+    headers = {}
+    for line in header_text.split("\r\n"):
+        if ":" in line:
+            name, value = line.split(":", 1)
+            headers[name.strip().lower()] = value.strip()
+    return headers, body
+
+
+class Connection:
+    """Sends the messages of the service in order, each at its due time, while the client keeps sending."""
+
+    def __init__(self, websocket):
+        self.websocket = websocket
+        self.request_id = uuid.uuid4().hex
+        self.queue = asyncio.Queue()
+        self.last_due = 0.0
+        self.sender = asyncio.ensure_future(self._send_queued())
+
+    def send_json(self, path, body, delay=0.0):
+        text = ("X-RequestId:{}\r\nContent-Type:application/json; charset=utf-8\r\nPath:{}\r\n\r\n{}"
+                .format(self.request_id, path, json.dumps(body)))
+        self._enqueue(OPCODE_TEXT, text.encode("utf-8"), delay)
+
+    def send_audio(self, audio, delay=0.0, spacing=0.0):
+        headers = "X-RequestId:{}\r\nContent-Type:audio/x-wav\r\nPath:audio\r\n".format(self.request_id).encode()
+        self._enqueue(OPCODE_BINARY, struct.pack("!H", len(headers)) + headers + audio, delay, spacing)
+
+    def _enqueue(self, opcode, payload, delay, spacing=0.0):
+        # A message is sent delay seconds from now, but never earlier than spacing seconds after the one queued
+        # before it.
+        self.last_due = max(self.last_due + spacing, time.monotonic() + delay)
+        self.queue.put_nowait((self.last_due, opcode, payload))
+
+    async def _send_queued(self):
+        closed = False
+        while True:
+            due, opcode, payload = await self.queue.get()
+            if opcode is None:
+                return
+            if closed:
+                continue
+            await asyncio.sleep(max(0.0, due - time.monotonic()))
+            try:
+                await self.websocket.send(opcode, payload)
+            except ConnectionError:
+                closed = True
+
+    async def finish(self):
+        """Sends the queued messages and stops the sender."""
+        self._enqueue(None, None, 0.0)
+        await self.sender
+
+
+class RecognitionSession:
+    """Answers the audio of a recognition connection with canned phrases.
+
+    Every utterance_seconds of audio are one utterance with the next phrase. While the audio of an utterance
+    arrives, a hypothesis with a growing part of the phrase is sent for every hypothesis_seconds of audio, after
+    hypothesis_latency; the phrase is sent after phrase_latency once the utterance ends. The audio is not analyzed.
+    A single-shot recognition ends its turn after the first phrase, a continuous one at the end of the audio.
+    """
+
+    def __init__(self, connection, options, single_shot):
+        self.connection = connection
+        self.options = options
+        self.single_shot = single_shot
+        self.ended = False
+        self.bytes_per_second = 32000
+        self.received = 0
+        self.utterance_start = 0
+        self.hypotheses = 0
+        self.phrase_index = 0
+        self.started = False
+
+    def on_audio(self, audio):
+        if self.ended:
+            return
+        if not self.started:
+            self.started = True
+            self.connection.send_json("turn.start", {"context": {"serviceTag": "mock"}})
+            self.connection.send_json("speech.startDetected", {"Offset": 0})
+        if not audio:
+            self._end_of_audio()
+            return
+        if audio[:4] == b"RIFF":
+            audio = self._skip_wave_header(audio)
+
+        self.received += len(audio)
+        utterance_bytes = int(self.options.utterance_seconds * self.bytes_per_second)
+        hypothesis_bytes = max(1, int(self.options.hypothesis_seconds * self.bytes_per_second))
+        while self.received - self.utterance_start >= utterance_bytes:
+            self._send_phrase(self.utterance_start + utterance_bytes)
+            if self.single_shot:
+                self._end_turn(self.utterance_start)
+                return
+        while (self.received - self.utterance_start) // hypothesis_bytes > self.hypotheses:
+            self.hypotheses += 1
+            end = self.utterance_start + self.hypotheses * hypothesis_bytes
+            self.connection.send_json("speech.hypothesis", {
+                "Text": self._words(self.hypotheses * hypothesis_bytes / utterance_bytes),
+                "Offset": self._ticks(self.utterance_start),
+                "Duration": self._ticks(end - self.utterance_start),
+            }, self.options.hypothesis_latency)
+
+    def _skip_wave_header(self, audio):
+        """Takes the byte rate from the wave header of the first audio message and returns the audio after it."""
+        position = 12
+        while position + 8 <= len(audio):
+            chunk, size = audio[position:position + 4], struct.unpack("<I", audio[position + 4:position + 8])[0]
+            if chunk == b"fmt " and size >= 16:
+                self.bytes_per_second = struct.unpack("<I", audio[position + 16:position + 20])[0] or 32000
+            if chunk == b"data":
+                return audio[position + 8:]
+            position += 8 + size
+        return b""
+
+    def _end_of_audio(self):
+        # The rest of the audio is the last utterance, unless it is too short for speech.
+        if self.received - self.utterance_start >= 0.3 * self.bytes_per_second:
+            self._send_phrase(self.received)
+        self._end_turn(self.received)
+
+    def _end_turn(self, end):
+        self.ended = True
+        self.connection.send_json("speech.endDetected", {"Offset": self._ticks(end)}, self.options.phrase_latency)
+        self.connection.send_json("turn.end", {})
+
+    def _send_phrase(self, end):
+        text = self.options.phrases[self.phrase_index % len(self.options.phrases)]
+        self.connection.send_json("speech.phrase", {
+            "RecognitionStatus": "Success",
+            "DisplayText": text,
+            "Offset": self._ticks(self.utterance_start),
+            "Duration": self._ticks(end - self.utterance_start),
+        }, self.options.phrase_latency)
+        self.phrase_index += 1
+        self.utterance_start = end
+        self.hypotheses = 0
+
+    def _words(self, fraction):
+        words = self.options.phrases[self.phrase_index % len(self.options.phrases)].rstrip(".?!").lower().split()
+        return " ".join(words[:max(1, min(len(words), int(round(fraction * len(words)))))])
+
+    def _ticks(self, size):
+        return size * TICKS_PER_SECOND // self.bytes_per_second
+
+
+class SynthesisSession:
+    """Answers the SSML of a synthesis connection with silent 16 bit PCM audio and word boundaries.
+
+    The audio lasts seconds_per_word for every word of the text. The first chunk is sent after first_byte_latency,
+    the following ones as fast as realtime_factor times real time allows.
+    """
+
+    def __init__(self, connection, options):
+        self.connection = connection
+        self.options = options
+        self.samples_per_second = 16000
+
+    def on_context(self, body):
+        # The output format is e.g. "raw-24khz-16bit-mono-pcm"; compressed formats are answered with PCM too.
+        try:
+            output_format = json.loads(body)["synthesis"]["audio"]["outputFormat"]
+            match = re.search(r"(\d+)khz", output_format)
+            if match:
+                self.samples_per_second = int(match.group(1)) * 1000
+        except (ValueError, KeyError, TypeError):
+            pass
+
+    def on_ssml(self, ssml):
+        text = re.sub(r"<[^>]*>", " ", ssml)
+        words = re.findall(r"\S+", text)
+        self.connection.send_json("turn.start", {"context": {"serviceTag": "mock"}})
+
+        word_ticks = int(self.options.seconds_per_word * TICKS_PER_SECOND)
+        for index, word in enumerate(words):
+            self.connection.send_json("audio.metadata", {"Metadata": [{
+                "Type": "WordBoundary",
+                "Data": {
+                    "Offset": index * word_ticks,
+                    "Duration": word_ticks,
+                    "text": {"Text": word, "Length": len(word), "BoundaryType": "WordBoundary"},
+                },
+            }]})
+
+        chunk_seconds = 0.1
+        chunk = bytes(int(self.samples_per_second * chunk_seconds) * 2)
+        chunks = int(len(words) * self.options.seconds_per_word / chunk_seconds + 0.5)
+        for index in range(chunks):
+            if index == 0:
+                self.connection.send_audio(chunk, self.options.first_byte_latency)
+            else:
+                self.connection.send_audio(chunk, spacing=chunk_seconds / self.options.realtime_factor)
+        self.connection.send_json("turn.end", {})
+
+
+async def handle_connection(reader, writer, options, statistics):
+    try:
+        websocket, path = await WebSocket.accept(reader, writer)
+    except (ConnectionError, asyncio.IncompleteReadError, asyncio.LimitOverrunError, ValueError):
+        writer.close()
+        return
+
+    connection = Connection(websocket)
+    is_synthesis = "/cognitiveservices/websocket/v1" in path
+    single_shot = "/interactive/" in path
+    session = SynthesisSession(connection, options) if is_synthesis else None
+    turn_request_id = None
+    statistics["connections"] += 1
+    logging.info("connection %d: %s", statistics["connections"], path)
+
+    while True:
+        opcode, payload = await websocket.receive()
+        if opcode == OPCODE_CLOSE:
+            break
+        headers, body = parse_message(opcode, payload)
+        connection.request_id = headers.get("x-requestid", connection.request_id)
+        message_path = headers.get("path", "").lower()
+        if message_path == "audio" and not is_synthesis:
+            # Every turn has its own request id, e.g. every RecognizeOnceAsync() call on a recognizer.
+            if connection.request_id != turn_request_id:
+                turn_request_id = connection.request_id
+                session = RecognitionSession(connection, options, single_shot)
+            statistics["audio_bytes"] += len(body)
+            session.on_audio(body)
+        elif message_path == "synthesis.context" and is_synthesis:
+            session.on_context(body)
+        elif message_path == "ssml" and is_synthesis:
+            statistics["syntheses"] += 1
+            session.on_ssml(body)
+
+    await connection.finish()
+    websocket.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="localhost", help="interface to listen on")
+    parser.add_argument("--port", type=int, default=8080, help="port to listen on")
+    parser.add_argument("--phrases", help="file with the phrases to recognize, one per line")
+    parser.add_argument("--utterance-seconds", type=float, default=3.0, help="seconds of audio per recognized phrase")
+    parser.add_argument("--hypothesis-seconds", type=float, default=0.5, help="seconds of audio per hypothesis")
+    parser.add_argument("--hypothesis-latency-ms", type=float, default=50, help="delay of hypotheses")
+    parser.add_argument("--phrase-latency-ms", type=float, default=200, help="delay of phrases after their audio")
+    parser.add_argument("--first-byte-latency-ms", type=float, default=100, help="delay of the first synthesized audio")
+    parser.add_argument("--seconds-per-word", type=float, default=0.3, help="synthesized audio per word")
+    parser.add_argument("--realtime-factor", type=float, default=10, help="speed of sending synthesized audio")
+    parser.add_argument("--verbose", action="store_true", help="log every connection")
+    options = parser.parse_args()
+
+    phrases = DEFAULT_PHRASES
+    if options.phrases:
+        with open(options.phrases, encoding="utf-8") as file:
+            phrases = [line.strip() for line in file if line.strip()]
+        if not phrases:
+            parser.error("{} contains no phrases".format(options.phrases))
+    options.phrases = phrases
+    options.hypothesis_latency = options.hypothesis_latency_ms / 1000
+    options.phrase_latency = options.phrase_latency_ms / 1000
+    options.first_byte_latency = options.first_byte_latency_ms / 1000
+    logging.basicConfig(level=logging.INFO if options.verbose else logging.WARNING, format="%(asctime)s %(message)s")
+
+    statistics = {"connections": 0, "audio_bytes": 0, "syntheses": 0}
+    loop = asyncio.get_event_loop()
+    server = loop.run_until_complete(asyncio.start_server(
+        lambda reader, writer: handle_connection(reader, writer, options, statistics), options.host, options.port))
+    print("Mock speech service listening on ws://{}:{}".format(options.host, options.port), flush=True)
+
+    # Stops on SIGTERM as well, e.g. from a CI script that started the service in the background.
+    if hasattr(signal, "SIGTERM") and sys.platform != "win32":
+        loop.add_signal_handler(signal.SIGTERM, loop.stop)
+    try:
+        loop.run_forever()
+    except KeyboardInterrupt:
+        pass
+    server.close()
+    print("{connections} connections, {audio_bytes} bytes of audio recognized, {syntheses} syntheses".format(**statistics))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,259 @@
+#!/usr/bin/env python
+# coding: utf-8
+
+# Copyright (c) Microsoft. All rights reserved.
+# Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+"""
+A local stand-in for the v2.0 batch transcription REST API, for testing the batch transcription client of
+quickstart/cpp/windows/from-blob without a subscription or a network connection.
+
+Submitted transcriptions are NotStarted, then Running, then Succeeded after configurable times, and their result
+files contain canned segments. A share of the submissions and status checks can be answered with 429 and a
+Retry-After header, to exercise the client's throttling handling. Only the Python standard library is used.
+"""
+
+import argparse
+import json
+import random
+import signal
+import sys
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, HTTPServer
+from socketserver import ThreadingMixIn
+
+TICKS_PER_SECOND = 10000000
+TRANSCRIPTIONS_PATH = "/api/speechtotext/v2.0/Transcriptions"
+RESULTS_PATH = "/results/"
+
+DEFAULT_PHRASES = [
+    "What's the weather like?",
+    "Turn on the lights in the living room.",
+    "Remind me to call my mother at six.",
+    "How long does it take to drive to Seattle?",
+]
+
+
+class ThreadingHTTPServer(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+
+
+class TranscriptionService:
+    """The transcriptions submitted so far, and the answers to the requests about them."""
+
+    def __init__(self, options):
+        self.options = options
+        self.lock = threading.Lock()
+        self.transcriptions = {}
+        self.statistics = {"submitted": 0, "status_checks": 0, "results": 0, "throttled": 0}
+
+    def count(self, name):
+        with self.lock:
+            self.statistics[name] += 1
+
+    def throttle(self):
+        """Whether to answer the current request with 429."""
+        if random.random() < self.options.throttle_rate:
+            self.count("throttled")
+            return True
+        return False
+
+    def submit(self, definition):
+        transcription_id = str(uuid.uuid4())
+        with self.lock:
+            self.transcriptions[transcription_id] = {
+                "definition": definition,
+                "submitted": time.monotonic(),
+                "created": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+                "fails": random.random() < self.options.fail_rate,
+            }
+            self.statistics["submitted"] += 1
+        return transcription_id
+
+    def status(self, transcription_id, base_url):
+        with self.lock:
+            transcription = self.transcriptions.get(transcription_id)
+        if transcription is None:
+            return None
+        elapsed = time.monotonic() - transcription["submitted"]
+        if elapsed < self.options.queue_seconds:
+            status = "NotStarted"
+        elif elapsed < self.options.queue_seconds + self.options.run_seconds:
+            status = "Running"
+        else:
+            status = "Failed" if transcription["fails"] else "Succeeded"
+
+        definition = transcription["definition"]
+        results_urls = {}
+        if status == "Succeeded":
+            results_urls["channel_0"] = "{}{}{}.json".format(base_url, RESULTS_PATH, transcription_id)
+        return {
+            "id": transcription_id,
+            "name": definition.get("name", ""),
+            "description": definition.get("description", ""),
+            "locale": definition.get("locale", ""),
+            "recordingsUrl": definition.get("recordingsurl", ""),
+            "createdDateTime": transcription["created"],
+            "lastActionDateTime": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+            "resultsUrls": results_urls,
+            "status": status,
+            "statusMessage": "The mock service failed the transcription." if status == "Failed" else "",
+        }
+
+    def result(self, transcription_id):
+        with self.lock:
+            transcription = self.transcriptions.get(transcription_id)
+        if transcription is None:
+            return None
+        recordings_url = transcription["definition"].get("recordingsurl", "")
+        segments = []
+        offset = 0
+        for i in range(self.options.segments):
+            phrase = self.options.phrases[i % len(self.options.phrases)]
+            duration = int(self.options.segment_seconds * TICKS_PER_SECOND)
+            segments.append({
+                "RecognitionStatus": "Success",
+                "ChannelNumber": "0",
+                "Offset": offset,
+                "Duration": duration,
+                "OffsetInSeconds": offset / TICKS_PER_SECOND,
+                "DurationInSeconds": duration / TICKS_PER_SECOND,
+                "NBest": [{
+                    "Confidence": 0.9,
+                    "Lexical": phrase.lower().rstrip(".?"),
+                    "ITN": phrase.lower().rstrip(".?"),
+                    "MaskedITN": phrase.lower().rstrip(".?"),
+                    "Display": phrase,
+                }],
+            })
+            offset += duration
+        text = " ".join(segment["NBest"][0]["Display"] for segment in segments)
+        return {
+            "AudioFileResults": [{
+                "AudioFileName": recordings_url.rsplit("/", 1)[-1],
+                "AudioFileUrl": recordings_url,
+                "SegmentResults": segments,
+                "CombinedResults": [{"ChannelNumber": "0", "Lexical": text, "ITN": text, "MaskedITN": text, "Display": text}],
+            }]
+        }
+
+
+def make_handler(service):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, format, *args):
+            if service.options.verbose:
+                sys.stderr.write("%s %s\n" % (self.log_date_time_string(), format % args))
+
+        def base_url(self):
+            return "http://{}".format(self.headers.get("Host", "{}:{}".format(*self.server.server_address[:2])))
+
+        def send(self, code, body=None, headers=None):
+            data = json.dumps(body).encode("utf-8") if body is not None else b""
+            self.send_response(code)
+            for name, value in (headers or {}).items():
+                self.send_header(name, value)
+            if body is not None:
+                self.send_header("Content-Type", "application/json; charset=utf-8")
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def send_throttled(self):
+            self.send(429, {"code": "TooManyRequests"}, {"Retry-After": str(service.options.retry_after_seconds)})
+
+        def authorized(self):
+            if not self.headers.get("Ocp-Apim-Subscription-Key"):
+                self.send(401, {"code": "Unauthorized"})
+                return False
+            return True
+
+        def do_POST(self):
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+            if self.path.rstrip("/") != TRANSCRIPTIONS_PATH:
+                self.send(404)
+                return
+            if not self.authorized():
+                return
+            if service.throttle():
+                self.send_throttled()
+                return
+            try:
+                definition = json.loads(body.decode("utf-8"))
+            except ValueError:
+                self.send(400, {"code": "InvalidPayload"})
+                return
+            transcription_id = service.submit(definition)
+            location = "{}{}/{}".format(self.base_url(), TRANSCRIPTIONS_PATH, transcription_id)
+            self.send(202, headers={"Location": location})
+
+        def do_GET(self):
+            if self.path.startswith(RESULTS_PATH) and self.path.endswith(".json"):
+                result = service.result(self.path[len(RESULTS_PATH):-len(".json")])
+                if result is None:
+                    self.send(404)
+                    return
+                service.count("results")
+                self.send(200, result)
+                return
+            if not self.path.startswith(TRANSCRIPTIONS_PATH + "/"):
+                self.send(404)
+                return
+            if not self.authorized():
+                return
+            if service.throttle():
+                self.send_throttled()
+                return
+            status = service.status(self.path[len(TRANSCRIPTIONS_PATH) + 1:], self.base_url())
+            if status is None:
+                self.send(404)
+                return
+            service.count("status_checks")
+            self.send(200, status)
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="localhost", help="interface to listen on")
+    parser.add_argument("--port", type=int, default=8081, help="port to listen on")
+    parser.add_argument("--phrases", help="file with the phrases of the results, one per line")
+    parser.add_argument("--queue-seconds", type=float, default=5, help="seconds a transcription is NotStarted")
+    parser.add_argument("--run-seconds", type=float, default=5, help="seconds a transcription is Running")
+    parser.add_argument("--segments", type=int, default=10, help="segments per result file")
+    parser.add_argument("--segment-seconds", type=float, default=3.0, help="seconds of audio per segment")
+    parser.add_argument("--throttle-rate", type=float, default=0, help="share of requests answered with 429")
+    parser.add_argument("--retry-after-seconds", type=int, default=1, help="Retry-After of throttled requests")
+    parser.add_argument("--fail-rate", type=float, default=0, help="share of transcriptions that fail")
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+    options = parser.parse_args()
+
+    phrases = DEFAULT_PHRASES
+    if options.phrases:
+        with open(options.phrases, encoding="utf-8") as file:
+            phrases = [line.strip() for line in file if line.strip()]
+        if not phrases:
+            parser.error("{} contains no phrases".format(options.phrases))
+    options.phrases = phrases
+
+    service = TranscriptionService(options)
+    server = ThreadingHTTPServer((options.host, options.port), make_handler(service))
+    print("Mock transcription service listening on http://{}:{}{}/".format(options.host, options.port, TRANSCRIPTIONS_PATH), flush=True)
+
+    # Stops on SIGTERM as well, e.g. from a CI script that started the service in the background.
+    if hasattr(signal, "SIGTERM") and sys.platform != "win32":
+        signal.signal(signal.SIGTERM, lambda signum, frame: threading.Thread(target=server.shutdown).start())
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    server.server_close()
+    print("{submitted} transcriptions submitted, {status_checks} status checks, {results} results served, "
+          "{throttled} requests throttled".format(**service.statistics))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,145 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Returns the number of bytes that hold 'duration' of audio, rounded down to whole sample frames
+// (BlockAlign bytes, i.e. one sample of every channel), but at least one frame.
+inline uint32_t ChunkSizeForDuration(uint32_t samplesPerSec, uint16_t blockAlign, std::chrono::milliseconds duration)
+{
+    uint64_t frames = static_cast<uint64_t>(samplesPerSec) * duration.count() / 1000;
+    return static_cast<uint32_t>((std::max)(frames, static_cast<uint64_t>(1)) * blockAlign);
+}
+
+class AudioBufferPool;
+
+// A buffer leased from an AudioBufferPool. Returns the buffer to the pool when destroyed.
+class PooledBuffer final
+{
+public:
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : m_pool(other.m_pool), m_buffer(std::move(other.m_buffer)), m_size(other.m_size)
+    {
+        other.m_pool = nullptr;
+    }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(PooledBuffer&&) = delete;
+
+    inline ~PooledBuffer();
+
+    uint8_t* Data() { return m_buffer.data(); }
+    size_t Size() const { return m_size; }
+
+private:
+    friend class AudioBufferPool;
+
+    PooledBuffer(AudioBufferPool* pool, std::vector<uint8_t>&& buffer, size_t size)
+        : m_pool(pool), m_buffer(std::move(buffer)), m_size(size)
+    {
+    }
+
+    AudioBufferPool* m_pool;
+    std::vector<uint8_t> m_buffer;
+    size_t m_size;
+};
+
+// Thread-safe pool of audio buffers shared by all streams of the process, so that starting and stopping many
+// concurrent streams reuses buffers instead of allocating them per stream. Buffers are kept in power-of-two
+// size classes; a lease gets a buffer of at least the requested size.
+class AudioBufferPool final
+{
+public:
+    // The pool used by all samples.
+    static AudioBufferPool& Shared()
+    {
+        static AudioBufferPool pool;
+        return pool;
+    }
+
+    // maxFreePerSize limits the number of idle buffers kept per size class.
+    explicit AudioBufferPool(size_t maxFreePerSize = 64)
+        : m_maxFreePerSize(maxFreePerSize)
+    {
+    }
+
+    AudioBufferPool(const AudioBufferPool&) = delete;
+    AudioBufferPool& operator=(const AudioBufferPool&) = delete;
+
+    PooledBuffer Acquire(size_t size)
+    {
+        auto sizeClass = SizeClass(size);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& free = m_free[sizeClass];
+            if (!free.empty())
+            {
+                auto buffer = std::move(free.back());
+                free.pop_back();
+                m_reused++;
+                return PooledBuffer(this, std::move(buffer), size);
+            }
+            m_allocated++;
+        }
+        return PooledBuffer(this, std::vector<uint8_t>(sizeClass), size);
+    }
+
+    // The number of leases that needed a new buffer, and that reused one.
+    uint64_t Allocated() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_allocated;
+    }
+
+    uint64_t Reused() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_reused;
+    }
+
+private:
+    friend class PooledBuffer;
+
+    static size_t SizeClass(size_t size)
+    {
+        size_t sizeClass = 256;
+        while (sizeClass < size)
+        {
+            sizeClass <<= 1;
+        }
+        return sizeClass;
+    }
+
+    void Release(std::vector<uint8_t>&& buffer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& free = m_free[buffer.size()];
+        if (free.size() < m_maxFreePerSize)
+        {
+            free.push_back(std::move(buffer));
+        }
+    }
+
+    size_t m_maxFreePerSize;
+    mutable std::mutex m_mutex;
+    std::map<size_t, std::vector<std::vector<uint8_t>>> m_free;
+    uint64_t m_allocated = 0;
+    uint64_t m_reused = 0;
+};
+
+inline PooledBuffer::~PooledBuffer()
+{
+    if (m_pool != nullptr)
+    {
+        m_pool->Release(std::move(m_buffer));
+    }
+}
@@ -0,0 +1,56 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <atomic>
+#include <speechapi_cxx.h>
+#include "wav_file_reader.h"
+
+// AudioInputFromFileCallback implements PullAudioInputStreamCallback interface, and uses a wav file as source
+class AudioInputFromFileCallback final : public Microsoft::CognitiveServices::Speech::Audio::PullAudioInputStreamCallback
+{
+public:
+    // Constructor that creates an input stream from a file.
+    AudioInputFromFileCallback(const std::string& audioFileName)
+        : m_reader(audioFileName)
+    {
+    }
+
+    // Implements AudioInputStream::Read() which is called to get data from the audio stream.
+    // It copies data available in the stream to 'dataBuffer', but no more than 'size' bytes.
+    // If the data available is less than 'size' bytes, it is allowed to just return the amount of data that is currently available.
+    // If there is no data, this function must wait until data is available.
+    // It returns the number of bytes that have been copied in 'dataBuffer'.
+    // It returns 0 to indicate that the stream reaches end or is closed.
+    int Read(uint8_t* dataBuffer, uint32_t size) override
+    {
+        int read = m_reader.Read(dataBuffer, size);
+        m_bytesRead += read;
+        return read;
+    }
+
+    // Implements AudioInputStream::Close() which is called when the stream needs to be closed.
+    void Close() override
+    {
+        m_reader.Close();
+    }
+
+    // Returns the audio format of the file, e.g. to create a matching AudioStreamFormat.
+    const WavFileReader::WAVEFORMAT& GetFormat() const
+    {
+        return m_reader.GetFormat();
+    }
+
+    // Returns the duration of the audio that has been handed to the recognizer so far, in seconds.
+    double GetAudioSecondsRead() const
+    {
+        auto bytesPerSecond = m_reader.GetFormat().AvgBytesPerSec;
+        return bytesPerSecond == 0 ? 0 : static_cast<double>(m_bytesRead) / bytesPerSecond;
+    }
+
+private:
+    WavFileReader m_reader;
+    std::atomic<uint64_t> m_bytesRead{ 0 };
+};
@@ -0,0 +1,98 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+// Paces audio writes to the byte rate of the audio, like a live source such as a microphone would deliver it.
+// Every deadline is computed from the total number of bytes since the first write and a fixed start time on
+// the monotonic clock, rather than by sleeping a fixed time per write, so that oversleeping and the time spent
+// writing do not add up over the stream.
+//
+// The pacer can also run N times faster than real time, e.g. for load tests, or not pace at all.
+class AudioPacer final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Paces at the speed of a live source.
+    static AudioPacer RealTime(uint32_t bytesPerSecond)
+    {
+        return AudioPacer(bytesPerSecond, 1.0);
+    }
+
+    // Paces 'speed' times faster than a live source.
+    static AudioPacer Accelerated(uint32_t bytesPerSecond, double speed)
+    {
+        if (speed <= 0)
+        {
+            throw std::invalid_argument("The pacing speed must be greater than 0.");
+        }
+        return AudioPacer(bytesPerSecond, speed);
+    }
+
+    // Does not wait at all; writes go as fast as the consumer accepts them.
+    static AudioPacer Unpaced()
+    {
+        return AudioPacer(0, 0);
+    }
+
+    // Waits until the next 'size' bytes are due, i.e. until a live source would have delivered them.
+    // Call it before writing the bytes.
+    void Pace(size_t size)
+    {
+        auto now = Clock::now();
+        if (m_bytes == 0)
+        {
+            m_start = now;
+        }
+        m_bytes += size;
+
+        if (m_bytesPerSecond == 0)
+        {
+            return;
+        }
+
+        auto due = m_start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(m_bytes) / (m_bytesPerSecond * m_speed)));
+        if (now < due)
+        {
+            std::this_thread::sleep_until(due);
+        }
+        else
+        {
+            // The writer could not keep up, e.g. because a write blocked; the following bytes catch up.
+            m_maxLag = (std::max)(m_maxLag, std::chrono::duration_cast<std::chrono::milliseconds>(now - due));
+        }
+    }
+
+    bool IsPaced() const
+    {
+        return m_bytesPerSecond != 0;
+    }
+
+    // The latest the writer has been behind its schedule.
+    std::chrono::milliseconds MaxLag() const
+    {
+        return m_maxLag;
+    }
+
+private:
+    AudioPacer(uint32_t bytesPerSecond, double speed)
+        : m_bytesPerSecond(bytesPerSecond), m_speed(speed)
+    {
+    }
+
+    uint32_t m_bytesPerSecond;
+    double m_speed;
+
+    Clock::time_point m_start;
+    uint64_t m_bytes = 0;
+    std::chrono::milliseconds m_maxLag{ 0 };
+};
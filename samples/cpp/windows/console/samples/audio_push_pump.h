@@ -0,0 +1,201 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "audio_buffer_pool.h"
+#include "spsc_ring_buffer.h"
+
+// Moves audio from a source to a sink through a SpscRingBuffer, with the source running on its own thread.
+// A slow source (e.g. a disk or capture stall) then no longer holds up the sink (e.g. PushAudioInputStream::Write,
+// which may block on the network), and vice versa, as long as the ring can absorb the difference.
+class AudioPushPump final
+{
+public:
+    struct Statistics
+    {
+        uint64_t BytesPumped = 0;
+        size_t Capacity = 0;
+        size_t HighWaterMark = 0;
+        uint64_t Overruns = 0;
+        uint64_t Underruns = 0;
+
+        std::string ToString() const
+        {
+            return "high-water mark " + std::to_string(HighWaterMark) + " of " + std::to_string(Capacity) + " bytes, " +
+                std::to_string(Underruns) + " underruns, " + std::to_string(Overruns) + " overruns";
+        }
+    };
+
+    // chunkSize is the largest block that is read from the source or handed to the sink at once; see
+    // ChunkSizeForDuration(). capacity is the size of the ring in bytes, rounded up to a power of two.
+    // The ring and the chunk buffer are leased from the pool for the duration of Run().
+    explicit AudioPushPump(uint32_t chunkSize, size_t capacity = 0, AudioBufferPool& pool = AudioBufferPool::Shared())
+        : m_chunkSize(chunkSize), m_capacity(RingCapacity(capacity > 0 ? capacity : 8 * static_cast<size_t>(chunkSize))), m_pool(pool)
+    {
+        if (chunkSize == 0)
+        {
+            throw std::invalid_argument("The chunk size must be greater than 0.");
+        }
+    }
+
+    // Reads the source on a producer thread, and hands the data to the sink on the calling thread, until
+    // the source returns 0. Exceptions of the source are rethrown on the calling thread; if the sink throws, the
+    // producer is stopped and the exception is rethrown.
+    //   source: uint32_t (uint8_t* buffer, uint32_t size) returns the number of bytes read, 0 at the end.
+    //   sink:   void (const uint8_t* data, uint32_t size)
+    template<class Source, class Sink>
+    Statistics Run(Source source, Sink sink)
+    {
+        auto chunk = m_pool.Acquire(m_chunkSize);
+        return Pump([&](const std::function<bool(const uint8_t*, uint32_t)>& write)
+        {
+            uint32_t read;
+            while ((read = source(chunk.Data(), m_chunkSize)) != 0 && write(chunk.Data(), read))
+            {
+            }
+        }, sink);
+    }
+
+    // Like Run(), for a source that hands out views of its data instead of copying it into a buffer, e.g.
+    // WavFileReader::ReadView() of a memory mapped file. The views are copied into the ring directly.
+    //   source: View (uint32_t size) returns a view (members Data and Size) of up to size bytes, Size 0 at the end.
+    template<class ViewSource, class Sink>
+    Statistics RunFromViews(ViewSource source, Sink sink)
+    {
+        return Pump([&](const std::function<bool(const uint8_t*, uint32_t)>& write)
+        {
+            for (;;)
+            {
+                auto view = source(m_chunkSize);
+                if (view.Size == 0 || !write(view.Data, view.Size))
+                {
+                    return;
+                }
+            }
+        }, sink);
+    }
+
+private:
+    // Runs produce on a producer thread with a function that writes into the ring, which returns false once the
+    // consumer gave up; the calling thread hands the data in the ring to the sink.
+    template<class Produce, class Sink>
+    Statistics Pump(Produce produce, Sink sink)
+    {
+        auto ringStorage = m_pool.Acquire(m_capacity);
+        SpscRingBuffer ring(ringStorage.Data(), m_capacity);
+        std::atomic<bool> canceled{ false };
+        std::exception_ptr producerError;
+
+        std::thread producer([&]()
+        {
+            try
+            {
+                produce([&](const uint8_t* data, uint32_t size)
+                {
+                    // Waits for the consumer while the ring is full.
+                    size_t written = 0;
+                    for (int attempt = 0; !canceled.load(std::memory_order_relaxed); )
+                    {
+                        auto count = ring.Write(data + written, size - written);
+                        if ((written += count) == size)
+                        {
+                            return true;
+                        }
+                        if (count > 0)
+                        {
+                            attempt = 0;
+                        }
+                        Backoff(attempt++);
+                    }
+                    return false;
+                });
+            }
+            catch (...)
+            {
+                producerError = std::current_exception();
+            }
+            ring.Close();
+        });
+
+        Statistics statistics;
+        try
+        {
+            for (int attempt = 0; !ring.IsDrained(); )
+            {
+                const uint8_t* block;
+                auto available = ring.Peek(block);
+                if (available == 0)
+                {
+                    // Waits for the producer while the ring is empty.
+                    Backoff(attempt++);
+                    continue;
+                }
+                attempt = 0;
+
+                auto size = static_cast<uint32_t>((std::min)(available, static_cast<size_t>(m_chunkSize)));
+                sink(block, size);
+                ring.Consume(size);
+                statistics.BytesPumped += size;
+            }
+        }
+        catch (...)
+        {
+            // Stops the producer, which may be waiting for room in the ring, before the ring goes away.
+            canceled = true;
+            producer.join();
+            throw;
+        }
+        producer.join();
+
+        statistics.Capacity = ring.Capacity();
+        statistics.HighWaterMark = ring.HighWaterMark();
+        statistics.Overruns = ring.Overruns();
+        statistics.Underruns = ring.Underruns();
+
+        if (producerError)
+        {
+            std::rethrow_exception(producerError);
+        }
+        return statistics;
+    }
+
+    // Spins briefly, then yields, then sleeps, so that short waits stay cheap and long waits do not burn a core.
+    static void Backoff(int attempt)
+    {
+        if (attempt < 16)
+        {
+            return;
+        }
+        if (attempt < 64)
+        {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    static size_t RingCapacity(size_t capacity)
+    {
+        size_t rounded = 1;
+        while (rounded < capacity)
+        {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    uint32_t m_chunkSize;
+    size_t m_capacity;
+    AudioBufferPool& m_pool;
+};
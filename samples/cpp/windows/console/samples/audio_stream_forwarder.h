@@ -0,0 +1,164 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <ostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Forwards audio from a blocking reader, such as PullAudioOutputStream::Read() or AudioDataStream::ReadData(), to a
+// sink on a dedicated thread, chunk by chunk as the synthesizer produces it. The sink gets the first audio while the
+// synthesis is still running, instead of after SpeakTextAsync() returns or the synthesizer is destroyed.
+//
+// The forwarder measures when the first and the last chunk of each request reached the sink; BeginRequest() marks
+// the start of a request.
+class AudioStreamForwarder final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Returns the number of bytes read, blocking until audio is available; 0 at the end of the stream.
+    using Reader = std::function<uint32_t(uint8_t* buffer, uint32_t size)>;
+    using Sink = std::function<void(const uint8_t* data, uint32_t size)>;
+
+    struct RequestStatistics
+    {
+        uint64_t Bytes = 0;
+        uint64_t Chunks = 0;
+        // Since BeginRequest(); zero while no chunk has been forwarded.
+        std::chrono::milliseconds FirstChunk{ 0 };
+        std::chrono::milliseconds LastChunk{ 0 };
+    };
+
+    // Returns a sink that writes to a stream, e.g. a std::ofstream of a file or named pipe, and flushes every chunk,
+    // so that a reader on the other end (e.g. a player reading the pipe) gets the audio without delay.
+    static Sink StreamSink(std::ostream& stream)
+    {
+        return [&stream](const uint8_t* data, uint32_t size)
+        {
+            if (!stream.write(reinterpret_cast<const char*>(data), size).flush())
+            {
+                throw std::runtime_error("Failed to write the audio to the sink.");
+            }
+        };
+    }
+
+    // Returns a sink that writes to a FILE*, e.g. stdout, a pipe from popen() or a socket from fdopen(), and
+    // flushes every chunk.
+    static Sink FileSink(FILE* file)
+    {
+        return [file](const uint8_t* data, uint32_t size)
+        {
+            if (fwrite(data, 1, size, file) != size || fflush(file) != 0)
+            {
+                throw std::runtime_error("Failed to write the audio to the sink.");
+            }
+        };
+    }
+
+    explicit AudioStreamForwarder(uint32_t chunkSize = 3200)
+        : m_chunkSize(chunkSize)
+    {
+        if (chunkSize == 0)
+        {
+            throw std::invalid_argument("The chunk size must be greater than 0.");
+        }
+        BeginRequest();
+    }
+
+    AudioStreamForwarder(const AudioStreamForwarder&) = delete;
+    AudioStreamForwarder& operator=(const AudioStreamForwarder&) = delete;
+
+    ~AudioStreamForwarder()
+    {
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    // Starts reading on the forwarding thread, until the reader returns 0.
+    void Start(Reader reader, Sink sink)
+    {
+        if (m_thread.joinable())
+        {
+            throw std::logic_error("The forwarder is already started.");
+        }
+        m_thread = std::thread([this, reader, sink]()
+        {
+            try
+            {
+                std::vector<uint8_t> buffer(m_chunkSize);
+                uint32_t read;
+                while ((read = reader(buffer.data(), m_chunkSize)) != 0)
+                {
+                    sink(buffer.data(), read);
+                    OnForwarded(read);
+                }
+            }
+            catch (...)
+            {
+                m_error = std::current_exception();
+            }
+        });
+    }
+
+    // Waits until the reader reached the end of the stream. Rethrows exceptions of the reader or the sink.
+    void Join()
+    {
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    // Starts measuring a new request, e.g. right before SpeakTextAsync().
+    void BeginRequest()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requestStart = Clock::now();
+        m_request = RequestStatistics();
+    }
+
+    RequestStatistics CurrentRequest() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_request;
+    }
+
+private:
+    void OnForwarded(uint32_t size)
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_requestStart);
+        if (m_request.Chunks == 0)
+        {
+            m_request.FirstChunk = elapsed;
+        }
+        m_request.LastChunk = elapsed;
+        m_request.Chunks++;
+        m_request.Bytes += size;
+    }
+
+    uint32_t m_chunkSize;
+    std::thread m_thread;
+    std::exception_ptr m_error;
+
+    mutable std::mutex m_mutex;
+    Clock::time_point m_requestStart;
+    RequestStatistics m_request;
+};
@@ -0,0 +1,341 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx.h>
+
+// One prompt of the manifest.
+struct SynthesisPrompt
+{
+    // Name of the wav file to write.
+    std::string OutputFile;
+
+    // Voice name, e.g. "en-US-JennyNeural"; empty for the voice of the SpeechConfig.
+    std::string Voice;
+
+    // Plain text, or SSML if it starts with "<speak".
+    std::string Text;
+};
+
+// Outcome of the rendering of one prompt of the manifest.
+struct PromptRenderResult
+{
+    // Position of the prompt in the manifest.
+    size_t Index = 0;
+    std::string OutputFile;
+
+    uint64_t AudioBytes = 0;
+
+    // From sending the request until the wav file was written.
+    double WallSeconds = 0;
+
+    // Set if the prompt could not be rendered.
+    std::string Error;
+};
+
+// Renders many prompts to wav files on a pool of synthesizers, one worker thread per synthesizer.
+//
+// The synthesizers are created and warmed up once, then reused for all prompts, so that every prompt after the
+// first one of a worker runs on an open connection. Each worker pipelines its prompts: while the audio of one
+// prompt is written to its file with SaveToWavFileAsync(), the next prompt is already being synthesized. At most
+// two prompts per worker hold audio in memory, so the memory in flight is bounded by the worker count, however
+// long the manifest.
+//
+// Prompts with a voice are sent as SSML, so that one synthesizer serves all voices. Results are reported in
+// manifest order, each as soon as it and all prompts before it are done.
+class BatchSynthesisRenderer final
+{
+public:
+    using ResultCallback = std::function<void(const PromptRenderResult&)>;
+
+    // Statistics of a Run() call.
+    struct Summary
+    {
+        size_t Prompts = 0;
+        size_t Failed = 0;
+        uint64_t AudioBytes = 0;
+        double WallSeconds = 0;
+
+        double PromptsPerSecond() const
+        {
+            return WallSeconds > 0 ? Prompts / WallSeconds : 0;
+        }
+    };
+
+    // Creates workerCount synthesizers that write no audio output; the audio is taken from the results.
+    // A non-empty warmUpText is synthesized once by every synthesizer, in parallel, to open the connections
+    // before the first prompt.
+    BatchSynthesisRenderer(std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechConfig> config, size_t workerCount, const std::string& warmUpText = "Ready.")
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        if (workerCount == 0)
+        {
+            throw std::invalid_argument("The worker count must be greater than 0.");
+        }
+
+        std::vector<std::future<std::shared_ptr<SpeechSynthesisResult>>> warmUps;
+        for (size_t i = 0; i < workerCount; i++)
+        {
+            m_synthesizers.push_back(SpeechSynthesizer::FromConfig(config, nullptr));
+            if (!warmUpText.empty())
+            {
+                warmUps.push_back(m_synthesizers.back()->SpeakTextAsync(warmUpText));
+            }
+        }
+        for (auto& warmUp : warmUps)
+        {
+            auto result = warmUp.get();
+            if (result->Reason == ResultReason::Canceled)
+            {
+                throw std::runtime_error("Failed to warm up a synthesizer: " + CancellationError(result));
+            }
+        }
+    }
+
+    size_t WorkerCount() const
+    {
+        return m_synthesizers.size();
+    }
+
+    // Reads a manifest with one prompt per line: the output file name, the voice name (may be empty) and the text
+    // or SSML, separated by tabs. Empty lines and lines starting with '#' are ignored.
+    static std::vector<SynthesisPrompt> ReadManifest(const std::string& manifestFileName)
+    {
+        std::ifstream manifest(manifestFileName);
+        if (!manifest.good())
+        {
+            throw std::invalid_argument("Failed to open the manifest file " + manifestFileName);
+        }
+
+        std::vector<SynthesisPrompt> prompts;
+        std::string line;
+        for (size_t lineNumber = 1; std::getline(manifest, line); lineNumber++)
+        {
+            // Tolerates manifests with Windows line endings on Linux.
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+
+            auto voiceStart = line.find('\t');
+            auto textStart = voiceStart == std::string::npos ? std::string::npos : line.find('\t', voiceStart + 1);
+            if (textStart == std::string::npos)
+            {
+                throw std::invalid_argument("Expected <file>\\t<voice>\\t<text> in line " + std::to_string(lineNumber) + " of " + manifestFileName);
+            }
+
+            SynthesisPrompt prompt;
+            prompt.OutputFile = line.substr(0, voiceStart);
+            prompt.Voice = line.substr(voiceStart + 1, textStart - voiceStart - 1);
+            prompt.Text = line.substr(textStart + 1);
+            prompts.push_back(std::move(prompt));
+        }
+        return prompts;
+    }
+
+    // Returns the SSML that the prompt is synthesized from, or an empty string if it is plain text for the
+    // voice of the SpeechConfig.
+    static std::string ToSsml(const SynthesisPrompt& prompt)
+    {
+        if (prompt.Text.compare(0, 6, "<speak") == 0)
+        {
+            return prompt.Text;
+        }
+        if (prompt.Voice.empty())
+        {
+            return std::string();
+        }
+
+        // The language is the locale prefix of the voice name, e.g. "en-US" of "en-US-JennyNeural".
+        auto localeEnd = prompt.Voice.find('-', prompt.Voice.find('-') + 1);
+        auto language = localeEnd == std::string::npos ? std::string("en-US") : prompt.Voice.substr(0, localeEnd);
+
+        return "<speak version='1.0' xmlns='http://www.w3.org/2001/10/synthesis' xml:lang='" + EscapeXml(language) + "'>"
+            "<voice name='" + EscapeXml(prompt.Voice) + "'>" + EscapeXml(prompt.Text) + "</voice></speak>";
+    }
+
+    // Renders all prompts and blocks until they are done. onResult is called once per prompt, in manifest order,
+    // on one of the worker threads; calls never overlap. If onResult throws, the workers stop taking prompts, no
+    // further results are reported, and Run() rethrows the exception once the prompts in flight are done.
+    Summary Run(const std::vector<SynthesisPrompt>& prompts, const ResultCallback& onResult)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<PromptRenderResult> results(prompts.size());
+        std::vector<bool> done(prompts.size(), false);
+        size_t nextToReport = 0;
+        std::mutex reportMutex;
+        std::exception_ptr callbackError;
+        std::atomic<size_t> nextPrompt{ 0 };
+
+        auto report = [&](PromptRenderResult&& result)
+        {
+            // Reports all results that are complete up to the first gap in manifest order.
+            std::lock_guard<std::mutex> lock(reportMutex);
+            auto index = result.Index;
+            results[index] = std::move(result);
+            done[index] = true;
+            for (; !callbackError && nextToReport < prompts.size() && done[nextToReport]; nextToReport++)
+            {
+                try
+                {
+                    onResult(results[nextToReport]);
+                }
+                catch (...)
+                {
+                    // Not thrown on the worker thread, which would terminate the process.
+                    callbackError = std::current_exception();
+                    nextPrompt = prompts.size();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < (std::min)(m_synthesizers.size(), prompts.size()); i++)
+        {
+            workers.emplace_back([&, i]() { RenderPrompts(*m_synthesizers[i], prompts, nextPrompt, report); });
+        }
+        for (auto& thread : workers)
+        {
+            thread.join();
+        }
+        if (callbackError)
+        {
+            std::rethrow_exception(callbackError);
+        }
+
+        Summary summary;
+        summary.Prompts = prompts.size();
+        summary.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const auto& result : results)
+        {
+            summary.AudioBytes += result.AudioBytes;
+            summary.Failed += result.Error.empty() ? 0 : 1;
+        }
+        return summary;
+    }
+
+private:
+    // A prompt whose audio is being written to its file.
+    struct PendingSave
+    {
+        PromptRenderResult Result;
+        std::chrono::steady_clock::time_point Start;
+        std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesisResult> SynthesisResult;
+        std::shared_ptr<Microsoft::CognitiveServices::Speech::AudioDataStream> Stream;
+        std::future<void> Saved;
+    };
+
+    template<class Report>
+    void RenderPrompts(Microsoft::CognitiveServices::Speech::SpeechSynthesizer& synthesizer, const std::vector<SynthesisPrompt>& prompts,
+        std::atomic<size_t>& nextPrompt, Report& report)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        std::unique_ptr<PendingSave> pending;
+        auto finish = [&]()
+        {
+            if (!pending)
+            {
+                return;
+            }
+            try
+            {
+                pending->Saved.get();
+            }
+            catch (const std::exception& e)
+            {
+                pending->Result.Error = e.what();
+            }
+            pending->Result.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pending->Start).count();
+            report(std::move(pending->Result));
+            pending.reset();
+        };
+
+        for (size_t index = nextPrompt++; index < prompts.size(); index = nextPrompt++)
+        {
+            const auto& prompt = prompts[index];
+            auto next = std::unique_ptr<PendingSave>(new PendingSave());
+            next->Result.Index = index;
+            next->Result.OutputFile = prompt.OutputFile;
+            next->Start = std::chrono::steady_clock::now();
+
+            try
+            {
+                // Sends the next prompt before waiting for the file of the previous one.
+                auto ssml = ToSsml(prompt);
+                auto synthesis = ssml.empty() ? synthesizer.SpeakTextAsync(prompt.Text) : synthesizer.SpeakSsmlAsync(ssml);
+                finish();
+
+                auto result = synthesis.get();
+                if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+                {
+                    next->Result.AudioBytes = result->GetAudioLength();
+                    next->SynthesisResult = result;
+                    next->Stream = AudioDataStream::FromResult(result);
+                    next->Saved = next->Stream->SaveToWavFileAsync(prompt.OutputFile);
+                    pending = std::move(next);
+                    continue;
+                }
+                next->Result.Error = CancellationError(result);
+            }
+            catch (const std::exception& e)
+            {
+                finish();
+                next->Result.Error = e.what();
+            }
+            next->Result.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - next->Start).count();
+            report(std::move(next->Result));
+        }
+        finish();
+    }
+
+    static std::string CancellationError(const std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesisResult>& result)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+        return "ErrorCode=" + std::to_string(static_cast<int>(cancellation->ErrorCode)) + " " + cancellation->ErrorDetails;
+    }
+
+    static std::string EscapeXml(const std::string& text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (auto c : text)
+        {
+            switch (c)
+            {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '\'': escaped += "&apos;"; break;
+            case '"': escaped += "&quot;"; break;
+            default: escaped += c; break;
+            }
+        }
+        return escaped;
+    }
+
+    std::vector<std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesizer>> m_synthesizers;
+};
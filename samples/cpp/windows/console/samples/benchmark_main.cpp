@@ -0,0 +1,548 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+// A non-interactive benchmark of the sample pipelines, e.g. for CI. Runs the selected scenarios for a number of
+// sessions with a number of concurrent sessions each, against the Speech service or another endpoint such as the
+// mock speech service in samples/cpp/mock-speech-service, and writes the results as JSON:
+//
+//   ./benchmark --scenarios file,push,pull,synthesis --iterations 50 --concurrency 8 --host ws://localhost:8080
+//
+// For every scenario it reports the sessions and audio processed per second, the percentiles of the session time
+// and of the time to the first result (the first recognized phrase, the first synthesized audio), the CPU time of
+// the process, and its peak resident memory so far.
+
+#include "stdafx.h"
+
+#include <speechapi_cxx.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_input_from_file_callback.h"
+#include "audio_push_pump.h"
+#include "latency_histogram.h"
+#include "process_cpu_time.h"
+#include "speech_service_config.h"
+#include "wav_file_reader.h"
+
+using namespace std;
+using namespace Microsoft::CognitiveServices::Speech;
+using namespace Microsoft::CognitiveServices::Speech::Audio;
+
+namespace
+{
+    struct Options
+    {
+        vector<string> Scenarios{ "file", "push", "pull", "synthesis" };
+        size_t Iterations = 10;
+        size_t Concurrency = 1;
+        string Host;
+        string Endpoint;
+        string Key = "YourSubscriptionKey";
+        string Region = "YourServiceRegion";
+        string Audio = "whatstheweatherlike.wav";
+        string EnrollmentAudio = "enrollment_audio_katie.wav";
+        string Text = "The quick brown fox jumps over the lazy dog. What's the weather like today?";
+        string Output;
+    };
+
+    // The outcome of one session.
+    struct Session
+    {
+        bool Succeeded = false;
+        double AudioSeconds = 0;
+        double Seconds = 0;
+        // 0 if there was no result.
+        double FirstResultSeconds = 0;
+        string Error;
+    };
+
+    using Clock = chrono::steady_clock;
+
+    double SecondsSince(Clock::time_point start)
+    {
+        return chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    string Escape(const string& text)
+    {
+        string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    // The duration of the audio of a wave file, in seconds.
+    double AudioSecondsOf(const string& fileName)
+    {
+        WavFileReader reader(fileName);
+        uint64_t size = 0;
+        WavDataView view;
+        while ((view = reader.ReadView(64 * 1024)).Size != 0)
+        {
+            size += view.Size;
+        }
+        auto bytesPerSecond = reader.GetFormat().AvgBytesPerSec;
+        return bytesPerSecond == 0 ? 0 : static_cast<double>(size) / bytesPerSecond;
+    }
+
+    shared_ptr<AudioStreamFormat> StreamFormatOf(const WavFileReader::WAVEFORMAT& format)
+    {
+        return AudioStreamFormat::GetWaveFormatPCM(format.SamplesPerSec, static_cast<uint8_t>(format.BitsPerSample), static_cast<uint8_t>(format.Channels));
+    }
+
+    // Runs continuous recognition on the audio input until the end of the audio, as the recognition samples do.
+    // startAudio is called once recognition has started, e.g. to push the audio.
+    Session Recognize(const shared_ptr<SpeechConfig>& config, const shared_ptr<AudioConfig>& audioInput,
+        const function<void()>& startAudio = nullptr)
+    {
+        Session session;
+        auto start = Clock::now();
+
+        mutex sessionMutex;
+        promise<void> recognitionEnd;
+        once_flag endOnce;
+        auto end = [&]() { call_once(endOnce, [&]() { recognitionEnd.set_value(); }); };
+
+        auto recognizer = SpeechRecognizer::FromConfig(config, audioInput);
+        recognizer->Recognized.Connect([&](const SpeechRecognitionEventArgs& e)
+        {
+            lock_guard<mutex> lock(sessionMutex);
+            if (e.Result->Reason == ResultReason::RecognizedSpeech && session.FirstResultSeconds == 0)
+            {
+                session.FirstResultSeconds = SecondsSince(start);
+            }
+        });
+        recognizer->Canceled.Connect([&](const SpeechRecognitionCanceledEventArgs& e)
+        {
+            if (e.Reason == CancellationReason::Error)
+            {
+                lock_guard<mutex> lock(sessionMutex);
+                session.Error = "ErrorCode=" + to_string(static_cast<int>(e.ErrorCode)) + " " + e.ErrorDetails;
+                end();
+            }
+        });
+        recognizer->SessionStopped.Connect([&](const SessionEventArgs&)
+        {
+            end();
+        });
+
+        recognizer->StartContinuousRecognitionAsync().get();
+        if (startAudio)
+        {
+            startAudio();
+        }
+        recognitionEnd.get_future().wait();
+        recognizer->StopContinuousRecognitionAsync().get();
+
+        // The handlers refer to this stack frame.
+        recognizer->Recognized.DisconnectAll();
+        recognizer->Canceled.DisconnectAll();
+        recognizer->SessionStopped.DisconnectAll();
+
+        session.Seconds = SecondsSince(start);
+        session.Succeeded = session.Error.empty();
+        return session;
+    }
+
+    Session RecognizeFile(const shared_ptr<SpeechConfig>& config, const Options& options, double audioSeconds)
+    {
+        auto session = Recognize(config, AudioConfig::FromWavFileInput(options.Audio));
+        session.AudioSeconds = audioSeconds;
+        return session;
+    }
+
+    Session RecognizePushStream(const shared_ptr<SpeechConfig>& config, const Options& options, double audioSeconds)
+    {
+        WavFileReader reader(options.Audio);
+        const auto& format = reader.GetFormat();
+        auto pushStream = AudioInputStream::CreatePushStream(StreamFormatOf(format));
+
+        auto session = Recognize(config, AudioConfig::FromStreamInput(pushStream), [&]()
+        {
+            // Pushes the audio in chunks of 100 ms through the same pump as the push stream sample.
+            AudioPushPump pump(ChunkSizeForDuration(format.SamplesPerSec, format.BlockAlign, chrono::milliseconds(100)));
+            pump.RunFromViews(
+                [&reader](uint32_t size) { return reader.ReadView(size); },
+                [&pushStream](const uint8_t* data, uint32_t size) { pushStream->Write(const_cast<uint8_t*>(data), size); });
+            pushStream->Close();
+        });
+        session.AudioSeconds = audioSeconds;
+        return session;
+    }
+
+    Session RecognizePullStream(const shared_ptr<SpeechConfig>& config, const Options& options, double)
+    {
+        auto callback = make_shared<AudioInputFromFileCallback>(options.Audio);
+        auto pullStream = AudioInputStream::CreatePullStream(StreamFormatOf(callback->GetFormat()), callback);
+        auto session = Recognize(config, AudioConfig::FromStreamInput(pullStream));
+        session.AudioSeconds = callback->GetAudioSecondsRead();
+        return session;
+    }
+
+    // Synthesizes the text to a pull audio output stream and reads the audio on a separate thread while it is
+    // synthesized.
+    Session SynthesizeToStream(const shared_ptr<SpeechConfig>& config, const Options& options, double)
+    {
+        Session session;
+        auto start = Clock::now();
+
+        // Read() only returns 0 once the synthesizer is destroyed, which closes the stream. The reader is declared
+        // before the synthesizer, so that the synthesizer is destroyed first even if an exception is thrown.
+        auto stream = AudioOutputStream::CreatePullStream();
+        double firstAudioSeconds = 0;
+        future<uint64_t> reading;
+        auto synthesizer = SpeechSynthesizer::FromConfig(config, AudioConfig::FromStreamOutput(stream));
+
+        reading = async(launch::async, [&stream, &firstAudioSeconds, start]()
+        {
+            vector<uint8_t> buffer(32000);
+            uint64_t size = 0;
+            uint32_t read;
+            while ((read = stream->Read(buffer.data(), static_cast<uint32_t>(buffer.size()))) > 0)
+            {
+                if (size == 0)
+                {
+                    firstAudioSeconds = SecondsSince(start);
+                }
+                size += read;
+            }
+            return size;
+        });
+
+        auto result = synthesizer->SpeakTextAsync(options.Text).get();
+        session.Seconds = SecondsSince(start);
+        synthesizer = nullptr;
+        auto size = reading.get();
+        session.FirstResultSeconds = firstAudioSeconds;
+        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        {
+            session.Succeeded = true;
+        }
+        else
+        {
+            auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+            session.Error = "ErrorCode=" + to_string(static_cast<int>(cancellation->ErrorCode)) + " " + cancellation->ErrorDetails;
+        }
+        // The benchmark requests 16 kHz 16 bit mono PCM.
+        session.AudioSeconds = size / 32000.0;
+        return session;
+    }
+
+    // Speaker identification needs an enrolled voice profile, which is created once per scenario.
+    class SpeakerIdentification final
+    {
+    public:
+        SpeakerIdentification(const shared_ptr<SpeechConfig>& config, const Options& options)
+            : m_client(VoiceProfileClient::FromConfig(config))
+        {
+            m_profile = m_client->CreateProfileAsync(VoiceProfileType::TextIndependentIdentification, "en-us").get();
+            for (;;)
+            {
+                auto result = m_client->EnrollProfileAsync(m_profile, AudioConfig::FromWavFileInput(options.EnrollmentAudio)).get();
+                if (result->Reason == ResultReason::EnrolledVoiceProfile)
+                {
+                    break;
+                }
+                if (result->Reason != ResultReason::EnrollingVoiceProfile)
+                {
+                    auto cancellation = VoiceProfileEnrollmentCancellationDetails::FromResult(result);
+                    m_client->DeleteProfileAsync(m_profile).get();
+                    throw runtime_error("Failed to enroll the voice profile: " + cancellation->ErrorDetails);
+                }
+            }
+            m_model = SpeakerIdentificationModel::FromProfiles({ m_profile });
+        }
+
+        ~SpeakerIdentification()
+        {
+            try
+            {
+                m_client->DeleteProfileAsync(m_profile).get();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        Session Identify(const shared_ptr<SpeechConfig>& config, const Options& options, double audioSeconds)
+        {
+            Session session;
+            auto start = Clock::now();
+            auto recognizer = SpeakerRecognizer::FromConfig(config, AudioConfig::FromWavFileInput(options.Audio));
+            auto result = recognizer->RecognizeOnceAsync(m_model).get();
+            session.Seconds = SecondsSince(start);
+            session.FirstResultSeconds = session.Seconds;
+            session.AudioSeconds = audioSeconds;
+            if (result->Reason == ResultReason::RecognizedSpeakers)
+            {
+                session.Succeeded = true;
+            }
+            else
+            {
+                auto cancellation = SpeakerRecognitionCancellationDetails::FromResult(result);
+                session.Error = "ErrorCode=" + to_string(static_cast<int>(cancellation->ErrorCode)) + " " + cancellation->ErrorDetails;
+            }
+            return session;
+        }
+
+    private:
+        shared_ptr<VoiceProfileClient> m_client;
+        shared_ptr<VoiceProfile> m_profile;
+        shared_ptr<SpeakerIdentificationModel> m_model;
+    };
+
+    // Runs iterations sessions on concurrency threads and writes the statistics of the scenario as a JSON object.
+    void RunScenario(const string& name, const Options& options, const function<Session()>& runSession, ostream& out)
+    {
+        LatencyHistogram sessionTimes;
+        LatencyHistogram firstResultTimes;
+        mutex errorsMutex;
+        map<string, size_t> errors;
+        atomic<size_t> succeeded{ 0 };
+        atomic<size_t> next{ 0 };
+        double audioSeconds = 0;
+
+        auto cpuStart = ProcessCpuSeconds();
+        auto start = Clock::now();
+
+        vector<thread> workers;
+        for (size_t i = 0; i < (std::min)(options.Concurrency, options.Iterations); i++)
+        {
+            workers.emplace_back([&]()
+            {
+                while (next++ < options.Iterations)
+                {
+                    Session session;
+                    try
+                    {
+                        session = runSession();
+                    }
+                    catch (const exception& e)
+                    {
+                        session.Error = e.what();
+                    }
+
+                    lock_guard<mutex> lock(errorsMutex);
+                    if (!session.Succeeded)
+                    {
+                        errors[session.Error]++;
+                        continue;
+                    }
+                    succeeded++;
+                    audioSeconds += session.AudioSeconds;
+                    sessionTimes.Add(chrono::duration<double>(session.Seconds));
+                    if (session.FirstResultSeconds > 0)
+                    {
+                        firstResultTimes.Add(chrono::duration<double>(session.FirstResultSeconds));
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        auto wallSeconds = SecondsSince(start);
+        auto cpuSeconds = ProcessCpuSeconds() - cpuStart;
+
+        auto percentiles = [](const LatencyHistogram& histogram)
+        {
+            auto values = histogram.Quantiles({ 0.5, 0.9, 0.95, 0.99, 1.0 });
+            auto count = histogram.Count();
+            ostringstream json;
+            json << "{\"count\":" << count << ",\"mean\":" << (count > 0 ? histogram.Sum() * 1000 / count : 0)
+                 << ",\"p50\":" << values[0] * 1000 << ",\"p90\":" << values[1] * 1000 << ",\"p95\":" << values[2] * 1000
+                 << ",\"p99\":" << values[3] * 1000 << ",\"max\":" << values[4] * 1000 << "}";
+            return json.str();
+        };
+
+        out << "    {\"scenario\":\"" << Escape(name) << "\",\"iterations\":" << options.Iterations
+            << ",\"concurrency\":" << options.Concurrency << ",\"succeeded\":" << succeeded.load()
+            << ",\"failed\":" << options.Iterations - succeeded.load()
+            << ",\"wall_seconds\":" << wallSeconds
+            << ",\"sessions_per_second\":" << succeeded.load() / wallSeconds
+            << ",\"audio_seconds\":" << audioSeconds
+            << ",\"audio_seconds_per_second\":" << audioSeconds / wallSeconds
+            << ",\n     \"session_ms\":" << percentiles(sessionTimes)
+            << ",\n     \"first_result_ms\":" << percentiles(firstResultTimes)
+            << ",\n     \"cpu_seconds\":" << cpuSeconds
+            << ",\"cpu_seconds_per_audio_second\":" << (audioSeconds > 0 ? cpuSeconds / audioSeconds : 0)
+            << ",\"peak_rss_kb\":" << ProcessPeakMemoryKilobytes()
+            << ",\n     \"errors\":[";
+        bool first = true;
+        for (const auto& error : errors)
+        {
+            out << (first ? "" : ",") << "{\"error\":\"" << Escape(error.first) << "\",\"count\":" << error.second << "}";
+            first = false;
+        }
+        out << "]}";
+    }
+
+    vector<string> Split(const string& list)
+    {
+        vector<string> items;
+        stringstream stream(list);
+        string item;
+        while (getline(stream, item, ','))
+        {
+            if (!item.empty())
+            {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    void PrintUsage()
+    {
+        cerr << "Usage: ./benchmark [options]\n"
+             << "  --scenarios <list>     comma separated: file, push, pull, synthesis, speaker-id (default: file,push,pull,synthesis)\n"
+             << "  --iterations <n>       sessions per scenario (default: 10)\n"
+             << "  --concurrency <n>      concurrent sessions (default: 1)\n"
+             << "  --host <url>           service host, e.g. ws://localhost:8080 (default: $SPEECH_SERVICE_HOST or the region)\n"
+             << "  --endpoint <url>       service endpoint, instead of the host\n"
+             << "  --key <key>            subscription key\n"
+             << "  --region <region>      service region, e.g. westus\n"
+             << "  --audio <file>         wave file to recognize (default: whatstheweatherlike.wav)\n"
+             << "  --enrollment-audio <file>  wave file to enroll the speaker-id profile with (default: enrollment_audio_katie.wav)\n"
+             << "  --text <text>          text to synthesize\n"
+             << "  --output <file>        file to write the JSON to (default: standard output)\n";
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string name = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+            string value = argv[++i];
+            if (name == "--scenarios") options.Scenarios = Split(value);
+            else if (name == "--iterations") options.Iterations = stoul(value);
+            else if (name == "--concurrency") options.Concurrency = stoul(value);
+            else if (name == "--host") options.Host = value;
+            else if (name == "--endpoint") options.Endpoint = value;
+            else if (name == "--key") options.Key = value;
+            else if (name == "--region") options.Region = value;
+            else if (name == "--audio") options.Audio = value;
+            else if (name == "--enrollment-audio") options.EnrollmentAudio = value;
+            else if (name == "--text") options.Text = value;
+            else if (name == "--output") options.Output = value;
+            else return false;
+        }
+        static const vector<string> scenarios{ "file", "push", "pull", "synthesis", "speaker-id" };
+        for (const auto& scenario : options.Scenarios)
+        {
+            if (find(scenarios.begin(), scenarios.end(), scenario) == scenarios.end())
+            {
+                return false;
+            }
+        }
+        return options.Iterations > 0 && options.Concurrency > 0 && !options.Scenarios.empty();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    try
+    {
+        if (!ParseOptions(argc, argv, options))
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+    catch (const exception&)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    auto config = !options.Endpoint.empty() ? SpeechConfig::FromEndpoint(options.Endpoint, options.Key)
+        : !options.Host.empty() ? SpeechConfig::FromHost(options.Host, options.Key)
+        : SpeechConfigFromSubscriptionOrHost(options.Key, options.Region);
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm);
+
+    ofstream file;
+    if (!options.Output.empty())
+    {
+        file.open(options.Output);
+        if (!file)
+        {
+            cerr << "Error: " << options.Output << " cannot be written." << endl;
+            return 1;
+        }
+    }
+    ostream& out = options.Output.empty() ? cout : file;
+
+    try
+    {
+        auto audioSeconds = AudioSecondsOf(options.Audio);
+
+        out << "{\"iterations\":" << options.Iterations << ",\"concurrency\":" << options.Concurrency
+            << ",\"audio\":\"" << Escape(options.Audio) << "\",\"audio_seconds\":" << audioSeconds
+            << ",\n  \"scenarios\":[\n";
+        for (size_t i = 0; i < options.Scenarios.size(); i++)
+        {
+            const auto& scenario = options.Scenarios[i];
+            cerr << "Running " << scenario << "..." << endl;
+            out << (i > 0 ? ",\n" : "");
+
+            function<Session(const shared_ptr<SpeechConfig>&, const Options&, double)> run;
+            unique_ptr<SpeakerIdentification> speakerIdentification;
+            if (scenario == "file") run = RecognizeFile;
+            else if (scenario == "push") run = RecognizePushStream;
+            else if (scenario == "pull") run = RecognizePullStream;
+            else if (scenario == "synthesis") run = SynthesizeToStream;
+            else
+            {
+                speakerIdentification.reset(new SpeakerIdentification(config, options));
+                auto identification = speakerIdentification.get();
+                run = [identification](const shared_ptr<SpeechConfig>& c, const Options& o, double seconds) { return identification->Identify(c, o, seconds); };
+            }
+
+            RunScenario(scenario, options, [&]() { return run(config, options, audioSeconds); }, out);
+        }
+        out << "\n  ]}" << endl;
+    }
+    catch (const exception& e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
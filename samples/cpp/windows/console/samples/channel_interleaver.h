@@ -0,0 +1,134 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHANNEL_INTERLEAVER_SSE2 1
+#endif
+
+// Converts 16 bit PCM between the interleaved layout of wave files and push streams (one frame of all channels
+// after the other) and the planar layout (one buffer per channel) that per-channel processing works on.
+//
+// 8 channels, the layout of microphone arrays, are converted with SSE2 as 8x8 transposes of 8 frames at a time;
+// other channel counts and the remainder use the scalar loops.
+class ChannelInterleaver final
+{
+public:
+    static bool HasSimd()
+    {
+#ifdef CHANNEL_INTERLEAVER_SSE2
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Splits frames of interleaved audio into planes[0] to planes[channels - 1], frames samples each.
+    static void Deinterleave(const int16_t* interleaved, size_t frames, uint16_t channels, int16_t* const* planes)
+    {
+        size_t done = 0;
+#ifdef CHANNEL_INTERLEAVER_SSE2
+        if (channels == 8)
+        {
+            done = Transpose8(frames, [&](size_t frame, int row) { return Load(interleaved + (frame + row) * 8); },
+                [&](size_t frame, int row, __m128i value) { Store(planes[row] + frame, value); });
+        }
+#endif
+        DeinterleaveScalar(interleaved + done * channels, frames - done, channels, planes, done);
+    }
+
+    // Merges planes[0] to planes[channels - 1], frames samples each, into interleaved audio.
+    static void Interleave(const int16_t* const* planes, size_t frames, uint16_t channels, int16_t* interleaved)
+    {
+        size_t done = 0;
+#ifdef CHANNEL_INTERLEAVER_SSE2
+        if (channels == 8)
+        {
+            done = Transpose8(frames, [&](size_t frame, int row) { return Load(planes[row] + frame); },
+                [&](size_t frame, int row, __m128i value) { Store(interleaved + (frame + row) * 8, value); });
+        }
+#endif
+        InterleaveScalar(planes, frames - done, channels, interleaved + done * channels, done);
+    }
+
+    // The scalar conversions, for any channel count. offset is the first frame of the planes to use.
+    static void DeinterleaveScalar(const int16_t* interleaved, size_t frames, uint16_t channels, int16_t* const* planes, size_t offset = 0)
+    {
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            for (uint16_t channel = 0; channel < channels; channel++)
+            {
+                planes[channel][offset + frame] = interleaved[frame * channels + channel];
+            }
+        }
+    }
+
+    static void InterleaveScalar(const int16_t* const* planes, size_t frames, uint16_t channels, int16_t* interleaved, size_t offset = 0)
+    {
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            for (uint16_t channel = 0; channel < channels; channel++)
+            {
+                interleaved[frame * channels + channel] = planes[channel][offset + frame];
+            }
+        }
+    }
+
+private:
+#ifdef CHANNEL_INTERLEAVER_SSE2
+    static __m128i Load(const int16_t* source)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+    }
+
+    static void Store(int16_t* target, __m128i value)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), value);
+    }
+
+    // Transposes blocks of 8x8 samples: load(frame, row) returns row 0..7 of the block at frame, and store(frame,
+    // row, value) receives row 0..7 of the transposed block. Returns the number of frames converted.
+    template<typename LoadRow, typename StoreRow>
+    static size_t Transpose8(size_t frames, LoadRow load, StoreRow store)
+    {
+        size_t frame = 0;
+        for (; frame + 8 <= frames; frame += 8)
+        {
+            // Rows a to h; after the three rounds of unpacking, row n holds the n-th sample of every input row.
+            auto ab0 = _mm_unpacklo_epi16(load(frame, 0), load(frame, 1));
+            auto ab1 = _mm_unpackhi_epi16(load(frame, 0), load(frame, 1));
+            auto cd0 = _mm_unpacklo_epi16(load(frame, 2), load(frame, 3));
+            auto cd1 = _mm_unpackhi_epi16(load(frame, 2), load(frame, 3));
+            auto ef0 = _mm_unpacklo_epi16(load(frame, 4), load(frame, 5));
+            auto ef1 = _mm_unpackhi_epi16(load(frame, 4), load(frame, 5));
+            auto gh0 = _mm_unpacklo_epi16(load(frame, 6), load(frame, 7));
+            auto gh1 = _mm_unpackhi_epi16(load(frame, 6), load(frame, 7));
+
+            auto abcd0 = _mm_unpacklo_epi32(ab0, cd0);
+            auto abcd1 = _mm_unpackhi_epi32(ab0, cd0);
+            auto abcd2 = _mm_unpacklo_epi32(ab1, cd1);
+            auto abcd3 = _mm_unpackhi_epi32(ab1, cd1);
+            auto efgh0 = _mm_unpacklo_epi32(ef0, gh0);
+            auto efgh1 = _mm_unpackhi_epi32(ef0, gh0);
+            auto efgh2 = _mm_unpacklo_epi32(ef1, gh1);
+            auto efgh3 = _mm_unpackhi_epi32(ef1, gh1);
+
+            store(frame, 0, _mm_unpacklo_epi64(abcd0, efgh0));
+            store(frame, 1, _mm_unpackhi_epi64(abcd0, efgh0));
+            store(frame, 2, _mm_unpacklo_epi64(abcd1, efgh1));
+            store(frame, 3, _mm_unpackhi_epi64(abcd1, efgh1));
+            store(frame, 4, _mm_unpacklo_epi64(abcd2, efgh2));
+            store(frame, 5, _mm_unpackhi_epi64(abcd2, efgh2));
+            store(frame, 6, _mm_unpacklo_epi64(abcd3, efgh3));
+            store(frame, 7, _mm_unpackhi_epi64(abcd3, efgh3));
+        }
+        return frame;
+    }
+#endif
+};
@@ -0,0 +1,177 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "audio_buffer_pool.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// Collects audio as a list of fixed-size blocks leased from an AudioBufferPool, instead of one contiguous vector.
+// Every byte is copied exactly once, into the tail block; appending never moves the data already received, which a
+// growing std::vector does on every reallocation. Once the pool is warm, e.g. from a previous synthesis, appending
+// does not allocate either.
+//
+// The data is read segment by segment (scatter-gather), or written to a stream or file descriptor without first
+// joining it into one buffer.
+class ChunkedAudioBuffer final
+{
+public:
+    explicit ChunkedAudioBuffer(size_t blockSize = 64 * 1024, AudioBufferPool& pool = AudioBufferPool::Shared())
+        : m_blockSize(blockSize), m_pool(pool)
+    {
+        if (blockSize == 0)
+        {
+            throw std::invalid_argument("The block size must be greater than 0.");
+        }
+    }
+
+    ChunkedAudioBuffer(const ChunkedAudioBuffer&) = delete;
+    ChunkedAudioBuffer& operator=(const ChunkedAudioBuffer&) = delete;
+
+    void Append(const uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            if (m_tailUsed == m_blockSize || m_blocks.empty())
+            {
+                m_blocks.push_back(m_pool.Acquire(m_blockSize));
+                m_tailUsed = 0;
+            }
+            auto count = (std::min)(size, m_blockSize - m_tailUsed);
+            memcpy(m_blocks.back().Data() + m_tailUsed, data, count);
+            m_tailUsed += count;
+            m_size += count;
+            data += count;
+            size -= count;
+        }
+    }
+
+    // Returns all blocks to the pool.
+    void Clear()
+    {
+        m_blocks.clear();
+        m_tailUsed = 0;
+        m_size = 0;
+    }
+
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    size_t SegmentCount() const
+    {
+        return m_blocks.size();
+    }
+
+    // Calls callback(const uint8_t* data, size_t size) for every segment, in order.
+    template<class Callback>
+    void ForEachSegment(Callback callback) const
+    {
+        for (size_t i = 0; i < m_blocks.size(); i++)
+        {
+            callback(const_cast<PooledBuffer&>(m_blocks[i]).Data(), SegmentSize(i));
+        }
+    }
+
+    void WriteTo(std::ostream& stream) const
+    {
+        ForEachSegment([&stream](const uint8_t* data, size_t size)
+        {
+            stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        });
+        if (!stream)
+        {
+            throw std::runtime_error("Failed to write the audio to the stream.");
+        }
+    }
+
+    // Writes all segments to a file or socket descriptor. On POSIX, the segments are handed to the kernel in
+    // batches with a single writev() call each.
+    void WriteTo(int fd) const
+    {
+#ifdef _WIN32
+        ForEachSegment([fd](const uint8_t* data, size_t size)
+        {
+            while (size > 0)
+            {
+                auto written = _write(fd, data, static_cast<unsigned int>(size));
+                if (written < 0)
+                {
+                    throw std::runtime_error("Failed to write the audio, errno " + std::to_string(errno) + ".");
+                }
+                data += written;
+                size -= written;
+            }
+        });
+#else
+        const size_t maxBatch = 64;
+        iovec batch[maxBatch];
+        size_t next = 0;
+        while (next < m_blocks.size())
+        {
+            size_t count = 0;
+            for (; count < maxBatch && next + count < m_blocks.size(); count++)
+            {
+                batch[count].iov_base = const_cast<PooledBuffer&>(m_blocks[next + count]).Data();
+                batch[count].iov_len = SegmentSize(next + count);
+            }
+            next += count;
+
+            // writev() may write less than requested; continues after the last byte written.
+            iovec* pending = batch;
+            while (count > 0)
+            {
+                auto written = writev(fd, pending, static_cast<int>(count));
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::runtime_error("Failed to write the audio, errno " + std::to_string(errno) + ".");
+                }
+                auto remaining = static_cast<size_t>(written);
+                while (count > 0 && remaining >= pending->iov_len)
+                {
+                    remaining -= pending->iov_len;
+                    pending++;
+                    count--;
+                }
+                if (count > 0)
+                {
+                    pending->iov_base = static_cast<uint8_t*>(pending->iov_base) + remaining;
+                    pending->iov_len -= remaining;
+                }
+            }
+        }
+#endif
+    }
+
+private:
+    size_t SegmentSize(size_t index) const
+    {
+        return index + 1 == m_blocks.size() ? m_tailUsed : m_blockSize;
+    }
+
+    size_t m_blockSize;
+    AudioBufferPool& m_pool;
+    std::vector<PooledBuffer> m_blocks;
+    size_t m_tailUsed = 0;
+    size_t m_size = 0;
+};
@@ -8,6 +8,11 @@
 #include <speechapi_cxx.h>
 #include <fstream>
 #include "wav_file_reader.h"
+#include "wav_channel_subset_reader.h"
+#include "audio_input_from_file_callback.h"
+#include "audio_push_pump.h"
+#include "audio_pacer.h"
+#include "result_dispatcher.h"
 #include <chrono>
 
 using namespace std;
@@ -16,41 +21,45 @@ using namespace Microsoft::CognitiveServices::Speech::Transcription;
 using namespace Microsoft::CognitiveServices::Speech::Audio;
 
 
-// Transcribing conversation using a pull audio stream
-// Note: This is only available on the devices that can be paired with the Cognitive Services Speech Device SDK.
-void ConversationWithPullAudioStream()
+// Appends the lines of a transcription result, as the event handlers of the samples print them.
+static void FormatTranscription(const char* recognizedLabel, const ResultRecord& record, string& out)
 {
-    // First, define your own pull audio input stream callback class that implements the
-    // PullAudioInputStreamCallback interface. The sample here illustrates how to define such
-    // a callback that reads audio data from a wav file.
-    // AudioInputFromFileCallback implements PullAudioInputStreamCallback interface, and uses a wav file as source
-    class AudioInputFromFileCallback final : public PullAudioInputStreamCallback
+    switch (record.Event)
     {
-    public:
-        // Constructor that creates an input stream from a file.
-        AudioInputFromFileCallback(const string& audioFileName)
-            : m_reader(audioFileName)
-        {
-        }
-        // Implements AudioInputStream::Read() which is called to get data from the audio stream.
-        // It copies data available in the stream to 'dataBuffer', but no more than 'size' bytes.
-        // If the data available is less than 'size' bytes, it is allowed to just return the amount of data that is currently available.
-        // If there is no data, this function must wait until data is available.
-        // It returns the number of bytes that have been copied in 'dataBuffer'.
-        // It returns 0 to indicate that the stream reaches end or is closed.
-        int Read(uint8_t* dataBuffer, uint32_t size) override
-        {
-            return m_reader.Read(dataBuffer, size);
-        }
-        // Implements AudioInputStream::Close() which is called when the stream needs to be closed.
-        void Close() override
+    case ResultRecord::Kind::Recognizing:
+        out += "TRANSCRIBING: Text=" + record.Text + '\n';
+        break;
+    case ResultRecord::Kind::Recognized:
+        out += string(recognizedLabel) + ": Text=" + record.Text + "\n  Offset=" + to_string(record.Offset) +
+            "\n  Duration=" + to_string(record.Duration) + "\n  UserId=" + record.SpeakerId + '\n';
+        break;
+    case ResultRecord::Kind::NoMatch:
+        out += "NOMATCH: Speech could not be recognized.\n";
+        break;
+    case ResultRecord::Kind::Canceled:
+        switch (static_cast<CancellationReason>(record.CancellationReason))
         {
-            m_reader.Close();
+        case CancellationReason::EndOfStream:
+            out += "CANCELED: Reached the end of the file.\n";
+            break;
+        case CancellationReason::Error:
+            out += "CANCELED: ErrorCode=" + to_string(record.ErrorCode) + "\nCANCELED: ErrorDetails=" + record.Text + '\n';
+            break;
+        default:
+            out += "unknown reason ?!\n";
+            break;
         }
+        break;
+    }
+}
 
-    private:
-        WavFileReader m_reader;
-    };
+// Transcribing conversation using a pull audio stream
+// Note: This is only available on the devices that can be paired with the Cognitive Services Speech Device SDK.
+void ConversationWithPullAudioStream()
+{
+    // First, define your own pull audio input stream callback class that implements the
+    // PullAudioInputStreamCallback interface. The sample here uses AudioInputFromFileCallback,
+    // defined in audio_input_from_file_callback.h, which reads audio data from a wav file.
 
     // Creates an instance of a speech config with your subscription key and region.
     // Replace with your own subscription key and service region (e.g., "eastasia").
@@ -78,6 +87,13 @@ void ConversationWithPullAudioStream()
     // Create a conversation from a speech config and conversation Id.
     auto conversation = Conversation::CreateConversationAsync(config, "ConversationTranscriberSamples").get();
 
+    // Prints the results on a separate thread, so that the event handlers only copy them and return.
+    // Declared before the recognizer, so that it outlives the event handlers.
+    ResultDispatcher dispatcher(ResultDispatcher::StreamSink(cout), [](const ResultRecord& record, string& out)
+    {
+        FormatTranscription("Transcribed", record, out);
+    });
+
     // Create a conversation transcriber given an audio config. If you don't specify any audio input, Speech SDK opens the default microphone.
     auto recognizer = ConversationTranscriber::FromConfig(audioInput);
 
@@ -115,42 +131,22 @@ void ConversationWithPullAudioStream()
     promise<void> recognitionEnd;
 
     // Subscribes to events.
-    recognizer->Transcribing.Connect([](const ConversationTranscriptionEventArgs& e)
+    recognizer->Transcribing.Connect([&dispatcher](const ConversationTranscriptionEventArgs& e)
     {
-        cout << "TRANSCRIBING: Text=" << e.Result->Text << std::endl;
+        dispatcher.Publish(ResultRecord::Kind::Recognizing, e.Result);
     });
 
-    recognizer->Transcribed.Connect([](const ConversationTranscriptionEventArgs& e)
+    recognizer->Transcribed.Connect([&dispatcher](const ConversationTranscriptionEventArgs& e)
     {
-        if (e.Result->Reason == ResultReason::RecognizedSpeech)
-        {
-            cout << "Transcribed: Text=" << e.Result->Text << std::endl
-                << "  Offset=" << e.Result->Offset() << std::endl
-                << "  Duration=" << e.Result->Duration() << std::endl
-                << "  UserId=" << e.Result->UserId << std::endl;
-        }
-        else if (e.Result->Reason == ResultReason::NoMatch)
-        {
-            cout << "NOMATCH: Speech could not be recognized." << std::endl;
-        }
+        dispatcher.Publish(ResultRecord::Kind::Recognized, e.Result);
     });
 
-    recognizer->Canceled.Connect([&recognitionEnd](const ConversationTranscriptionCanceledEventArgs& e)
+    recognizer->Canceled.Connect([&recognitionEnd, &dispatcher](const ConversationTranscriptionCanceledEventArgs& e)
     {
-        switch (e.Reason)
+        dispatcher.PublishCanceled(e.Reason, e.ErrorCode, e.ErrorDetails);
+        if (e.Reason == CancellationReason::Error)
         {
-        case CancellationReason::EndOfStream:
-            cout << "CANCELED: Reached the end of the file." << std::endl;
-            break;
-
-        case CancellationReason::Error:
-            cout << "CANCELED: ErrorCode=" << (int)e.ErrorCode << std::endl;
-            cout << "CANCELED: ErrorDetails=" << e.ErrorDetails << std::endl;
             recognitionEnd.set_value();
-            break;
-
-        default:
-            cout << "unknown reason ?!" << std::endl;
         }
     });
 
@@ -168,6 +164,10 @@ void ConversationWithPullAudioStream()
 
     // Stops transcribing. This is optional.
     recognizer->StopTranscribingAsync().wait();
+
+    // Prints the remaining results.
+    dispatcher.Stop();
+    cout << "Result dispatcher: " << dispatcher.GetStatistics().ToString() << std::endl;
 }
 
 // Transcribing conversation using a push audio stream
@@ -184,6 +184,13 @@ void ConversationWithPushAudioStream()
     auto pushStream = AudioInputStream::CreatePushStream(AudioStreamFormat::GetWaveFormatPCM(16000, 16, 8));
     auto audioInput = AudioConfig::FromStreamInput(pushStream);
     auto conversation = Conversation::CreateConversationAsync(config, "ConversationTranscriberSamples").get();
+
+    // Prints the results on a separate thread, so that the event handlers only copy them and return.
+    // Declared before the recognizer, so that it outlives the event handlers.
+    ResultDispatcher dispatcher(ResultDispatcher::StreamSink(cout), [](const ResultRecord& record, string& out)
+    {
+        FormatTranscription("RECOGNIZED", record, out);
+    });
     auto recognizer = ConversationTranscriber::FromConfig(audioInput);
     recognizer->JoinConversationAsync(conversation).get();
 
@@ -218,42 +225,22 @@ void ConversationWithPushAudioStream()
     promise<void> recognitionEnd;
 
     // Subscribes to events.
-    recognizer->Transcribing.Connect([](const ConversationTranscriptionEventArgs& e)
+    recognizer->Transcribing.Connect([&dispatcher](const ConversationTranscriptionEventArgs& e)
     {
-        cout << "TRANSCRIBING: Text=" << e.Result->Text << std::endl;
+        dispatcher.Publish(ResultRecord::Kind::Recognizing, e.Result);
     });
 
-    recognizer->Transcribed.Connect([](const ConversationTranscriptionEventArgs& e)
+    recognizer->Transcribed.Connect([&dispatcher](const ConversationTranscriptionEventArgs& e)
     {
-        if (e.Result->Reason == ResultReason::RecognizedSpeech)
-        {
-            cout << "RECOGNIZED: Text=" << e.Result->Text << std::endl
-                << "  Offset=" << e.Result->Offset() << std::endl
-                << "  Duration=" << e.Result->Duration() << std::endl
-                << "  UserId=" << e.Result->UserId << std::endl;
-        }
-        else if (e.Result->Reason == ResultReason::NoMatch)
-        {
-            cout << "NOMATCH: Speech could not be recognized." << std::endl;
-        }
+        dispatcher.Publish(ResultRecord::Kind::Recognized, e.Result);
     });
 
-    recognizer->Canceled.Connect([&recognitionEnd](const ConversationTranscriptionCanceledEventArgs& e)
+    recognizer->Canceled.Connect([&recognitionEnd, &dispatcher](const ConversationTranscriptionCanceledEventArgs& e)
     {
-        switch (e.Reason)
+        dispatcher.PublishCanceled(e.Reason, e.ErrorCode, e.ErrorDetails);
+        if (e.Reason == CancellationReason::Error)
         {
-        case CancellationReason::EndOfStream:
-            cout << "CANCELED: Reached the end of the file." << std::endl;
-            break;
-
-        case CancellationReason::Error:
-            cout << "CANCELED: ErrorCode=" << (int)e.ErrorCode << std::endl;
-            cout << "CANCELED: ErrorDetails=" << e.ErrorDetails << std::endl;
             recognitionEnd.set_value();
-            break;
-
-        default:
-            cout << "unknown reason ?!" << std::endl;
         }
     });
 
@@ -273,16 +260,32 @@ void ConversationWithPushAudioStream()
     try
     {
         WavFileReader reader("katiesteve.wav");
-        vector<uint8_t> buffer(1000);
 
-        // Read data and push them into the stream
-        int readSamples = 0;
-        while ((readSamples = reader.Read(buffer.data(), (uint32_t)buffer.size())) != 0)
-        {
-            // Push a buffer into the stream
-            pushStream->Write(buffer.data(), readSamples);
-            this_thread::sleep_for(10ms);
-        }
+        // Selects the channels to push: the transcriber expects the microphone channels 0 to 6 and the reference
+        // channel 7. Consumers that need fewer channels select only those, e.g. { 0 } for a single microphone.
+        WavChannelSubsetReader channels(reader, { 0, 1, 2, 3, 4, 5, 6, 7 });
+
+        // Pushes the audio at the byte rate of the file, like a live 8-channel microphone array would deliver it.
+        // Use AudioPacer::Accelerated(bytesPerSecond, N) to push N times faster than real time, e.g. for load tests,
+        // or AudioPacer::Unpaced() to push as fast as the stream accepts the data.
+        const auto& format = channels.GetFormat();
+        uint32_t bytesPerSecond = format.SamplesPerSec * format.BlockAlign;
+        auto pacer = AudioPacer::RealTime(bytesPerSecond);
+
+        // Read data on a separate thread and push them into the stream from this one, decoupled by a ring buffer.
+        // The audio is pushed in chunks of 100 ms, i.e. 25600 bytes of 8-channel 16 kHz audio.
+        AudioPushPump pump(ChunkSizeForDuration(format.SamplesPerSec, format.BlockAlign, 100ms));
+        auto statistics = pump.Run(
+            [&channels](uint8_t* buffer, uint32_t size) { return (uint32_t)channels.Read(buffer, size); },
+            [&pushStream, &pacer](const uint8_t* data, uint32_t size)
+            {
+                // Waits until the buffer is due, then pushes it into the stream. The stream copies the data, so it is not modified.
+                pacer.Pace(size);
+                pushStream->Write(const_cast<uint8_t*>(data), size);
+            });
+        cout << "Push pump: " << statistics.ToString() << endl;
+        cout << "Pushed " << (double)statistics.BytesPumped / bytesPerSecond << " seconds of audio, at most "
+             << pacer.MaxLag().count() << " ms behind real time." << endl;
     }
     catch (const exception& e)
     {
@@ -297,4 +300,8 @@ void ConversationWithPushAudioStream()
 
     // Leaves the conversation.
     recognizer->StopTranscribingAsync().wait();
+
+    // Prints the remaining results.
+    dispatcher.Stop();
+    cout << "Result dispatcher: " << dispatcher.GetStatistics().ToString() << std::endl;
 }
@@ -7,6 +7,7 @@
 
 // <toplevel>
 #include <speechapi_cxx.h>
+#include "recognizer_pool.h"
 
 using namespace std;
 using namespace Microsoft::CognitiveServices::Speech;
@@ -222,3 +223,65 @@ void IntentContinuousRecognitionWithFile()
     recognizer->StopContinuousRecognitionAsync().get();
     // </IntentContinuousRecognitionWithFile>
 }
+
+// Intent recognition of a series of short commands using microphone, with a recognizer whose connection is opened
+// before the first command.
+void IntentRecognitionWithMicrophoneFromWarmPool()
+{
+    // Creates an instance of a speech config with your own Language Understanding subscription key and service
+    // region (e.g., "westus").
+    auto config = SpeechConfig::FromSubscription("YourLanguageUnderstandingSubscriptionKey", "YourLanguageUnderstandingServiceRegion");
+    auto model = LanguageUnderstandingModel::FromAppId("YourLanguageUnderstandingAppId");
+
+    // The pool creates the recognizers using microphone as audio input, with the intents of your model, and opens
+    // their connections ahead of the commands. A recognizer that fails is replaced by a new one for the next command.
+    RecognizerPool<IntentRecognizer> pool([config, model]()
+    {
+        auto recognizer = IntentRecognizer::FromConfig(config);
+        recognizer->AddIntent(model, "YourLanguageUnderstandingIntentName1", "id1");
+        recognizer->AddIntent(model, "YourLanguageUnderstandingIntentName2", "id2");
+        recognizer->AddIntent(model, "YourLanguageUnderstandingIntentName3", "any-IntentId-here");
+        return recognizer;
+    }, 1);
+    pool.Prewarm(1);
+    pool.WaitUntilConnected(std::chrono::seconds(10));
+
+    for (;;)
+    {
+        cout << "Say a command, or nothing to stop...\n";
+
+        auto recognizer = pool.Acquire();
+        auto result = recognizer->RecognizeOnceAsync().get();
+
+        if (result->Reason == ResultReason::RecognizedIntent)
+        {
+            cout << "RECOGNIZED: Text=" << result->Text << std::endl;
+            cout << "  Intent Id: " << result->IntentId << std::endl;
+        }
+        else if (result->Reason == ResultReason::RecognizedSpeech)
+        {
+            cout << "RECOGNIZED: Text=" << result->Text << " (intent could not be recognized)" << std::endl;
+        }
+        else if (result->Reason == ResultReason::NoMatch)
+        {
+            cout << "NOMATCH: Speech could not be recognized." << std::endl;
+            break;
+        }
+        else if (result->Reason == ResultReason::Canceled)
+        {
+            auto cancellation = CancellationDetails::FromResult(result);
+            cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+            if (cancellation->Reason == CancellationReason::Error)
+            {
+                cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                cout << "CANCELED: ErrorDetails=" << cancellation->ErrorDetails << std::endl;
+                cout << "CANCELED: Did you update the subscription info?" << std::endl;
+                recognizer.MarkBroken();
+                break;
+            }
+        }
+    }
+
+    cout << "Pool: " << pool.GetStatistics().ToString() << "." << std::endl;
+}
@@ -0,0 +1,93 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Collects latency samples and reports their quantiles. Samples are kept as they are, so the quantiles are exact;
+// this is meant for the request counts of a sample or a load test, not for a long-running service.
+// Thread-safe, since the samples usually come from SDK event handlers.
+class LatencyHistogram final
+{
+public:
+    void Add(std::chrono::duration<double> latency)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_samples.push_back(latency.count());
+        m_sum += latency.count();
+    }
+
+    size_t Count() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_samples.size();
+    }
+
+    // The sum of all samples, in seconds.
+    double Sum() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sum;
+    }
+
+    // The q-quantile (0 <= q <= 1) of the samples in seconds, using the nearest-rank method; 0 without samples.
+    double Quantile(double q) const
+    {
+        return Quantiles({ q })[0];
+    }
+
+    // Sorts the samples once for several quantiles.
+    std::vector<double> Quantiles(const std::vector<double>& qs) const
+    {
+        std::vector<double> sorted;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            sorted = m_samples;
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        std::vector<double> values;
+        for (auto q : qs)
+        {
+            if (sorted.empty())
+            {
+                values.push_back(0);
+                continue;
+            }
+            auto rank = static_cast<size_t>(std::ceil((std::min)((std::max)(q, 0.0), 1.0) * sorted.size()));
+            values.push_back(sorted[rank > 0 ? rank - 1 : 0]);
+        }
+        return values;
+    }
+
+    // Writes the histogram as a Prometheus summary with the 0.5, 0.95 and 0.99 quantiles, in seconds.
+    // See https://prometheus.io/docs/instrumenting/exposition_formats/.
+    void WritePrometheus(std::ostream& out, const std::string& name, const std::string& help) const
+    {
+        static const std::vector<double> qs{ 0.5, 0.95, 0.99 };
+        auto values = Quantiles(qs);
+
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " summary\n";
+        for (size_t i = 0; i < qs.size(); i++)
+        {
+            out << name << "{quantile=\"" << qs[i] << "\"} " << values[i] << "\n";
+        }
+        out << name << "_sum " << Sum() << "\n";
+        out << name << "_count " << Count() << "\n";
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<double> m_samples;
+    double m_sum = 0;
+};
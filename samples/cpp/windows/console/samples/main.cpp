@@ -16,10 +16,13 @@ extern void SpeechContinuousRecognitionWithPullStream();
 extern void SpeechContinuousRecognitionWithPushStream();
 extern void KeywordTriggeredSpeechRecognitionWithMicrophone();
 extern void PronunciationAssessmentWithMicrophone();
+extern void SpeechRecognitionWithManifestInParallel();
+extern void SpeechRecognitionWithMicrophoneFromWarmPool();
 
 extern void IntentRecognitionWithMicrophone();
 extern void IntentRecognitionWithLanguage();
 extern void IntentContinuousRecognitionWithFile();
+extern void IntentRecognitionWithMicrophoneFromWarmPool();
 
 extern void TranslationWithMicrophone();
 extern void TranslationContinuousRecognition();
@@ -37,6 +40,7 @@ extern void SpeechSynthesisEvents();
 extern void SpeechSynthesisWordBoundaryEvent();
 extern void SpeechSynthesisWithSourceLanguageAutoDetection();
 extern void SpeechSynthesisUsingCustomVoice();
+extern void SpeechSynthesisBatchFromManifest();
 
 extern void ConversationWithPullAudioStream();
 extern void ConversationWithPushAudioStream();
@@ -46,6 +50,12 @@ extern void SpeakerVerificationWithPushStream();
 extern void SpeakerIdentificationWithPullStream();
 extern void SpeakerIdentificationWithMicrophone();
 
+extern void PushStreamChunkSizeBenchmark();
+extern void ChannelLayoutBenchmark();
+extern void ResultDispatchBenchmark();
+extern void WarmRecognizerPoolBenchmark();
+extern void PushStreamRecognitionLatencyTrace();
+
 void SpeechSamples()
 {
     string input;
@@ -60,6 +70,8 @@ void SpeechSamples()
         cout << "6.) Speech recognition using push stream input.\n";
         cout << "7.) Speech recognition using microphone with a keyword trigger.\n";
         cout << "8.) Pronunciation assessment using microphone input.\n";
+        cout << "9.) Speech recognition of multiple files in parallel.\n";
+        cout << "A.) Speech recognition of short commands with a warm recognizer pool.\n";
         cout << "\nChoice (0 for MAIN MENU): ";
         cout.flush();
 
@@ -92,6 +104,13 @@ void SpeechSamples()
         case '8':
             PronunciationAssessmentWithMicrophone();
             break;
+        case '9':
+            SpeechRecognitionWithManifestInParallel();
+            break;
+        case 'A':
+        case 'a':
+            SpeechRecognitionWithMicrophoneFromWarmPool();
+            break;
         case '0':
             break;
         }
@@ -107,6 +126,7 @@ void IntentSamples()
         cout << "1.) Intent recognition with microphone input.\n";
         cout << "2.) Intent recognition in the specified language.\n";
         cout << "3.) Intent continuous recognition with file input.\n";
+        cout << "4.) Intent recognition of short commands with a warm recognizer pool.\n";
         cout << "\nChoice (0 for MAIN MENU): ";
         cout.flush();
 
@@ -124,6 +144,9 @@ void IntentSamples()
         case '3':
             IntentContinuousRecognitionWithFile();
             break;
+        case '4':
+            IntentRecognitionWithMicrophoneFromWarmPool();
+            break;
         case '0':
             break;
         }
@@ -177,6 +200,7 @@ void SpeechSynthesisSamples()
         cout << "B.) Speech synthesis word boundary event.\n";
         cout << "C.) Speech synthesis with source language auto detection\n";
         cout << "D.) Speech synthesis using Custom Voice\n";
+        cout << "E.) Batch speech synthesis of a manifest to wave files.\n";
         cout << "\nChoice (0 for MAIN MENU): ";
         cout.flush();
 
@@ -227,6 +251,11 @@ void SpeechSynthesisSamples()
         case 'D':
         case 'd':
             SpeechSynthesisUsingCustomVoice();
+            break;
+        case 'E':
+        case 'e':
+            SpeechSynthesisBatchFromManifest();
+            break;
         case '0':
             break;
         }
@@ -301,6 +330,46 @@ void SpeakerRecognitionSamples()
     } while (input[0] != '0');
 }
 
+void PerformanceSamples()
+{
+    string input;
+    do
+    {
+        cout << "\nPERFORMANCE SAMPLES:\n";
+        cout << "1.) CPU cost of push stream chunk sizes.\n";
+        cout << "2.) Throughput of interleaved and planar multi-channel audio.\n";
+        cout << "3.) Event thread time per result with and without a result dispatcher.\n";
+        cout << "4.) Result latency of new recognizers and of a warm recognizer pool.\n";
+        cout << "5.) Result latency of a real-time push stream, with a Prometheus summary and a timeline.\n";
+        cout << "\nChoice (0 for MAIN MENU): ";
+        cout.flush();
+
+        input.clear();
+        getline(cin, input);
+
+        switch (input[0])
+        {
+        case '1':
+            PushStreamChunkSizeBenchmark();
+            break;
+        case '2':
+            ChannelLayoutBenchmark();
+            break;
+        case '3':
+            ResultDispatchBenchmark();
+            break;
+        case '4':
+            WarmRecognizerPoolBenchmark();
+            break;
+        case '5':
+            PushStreamRecognitionLatencyTrace();
+            break;
+        case '0':
+            break;
+        }
+    } while (input[0] != '0');
+}
+
 #ifdef _WIN32
 int wmain(int argc, wchar_t **argv)
 #else
@@ -317,6 +386,7 @@ int main(int argc, char **argv)
         cout << "4.) Speech synthesis samples.\n";
         cout << "5.) Conversation transcriber samples.\n";
         cout << "6.) Speaker Recognition samples.\n";
+        cout << "7.) Performance samples.\n";
         cout << "\nChoice (0 to Exit): ";
         cout.flush();
 
@@ -342,6 +412,10 @@ int main(int argc, char **argv)
             break;
         case '6':
             SpeakerRecognitionSamples();
+            break;
+        case '7':
+            PerformanceSamples();
+            break;
         case '0':
             break;
         }
@@ -0,0 +1,239 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx.h>
+#include "audio_input_from_file_callback.h"
+
+// Outcome of the recognition of one file of the manifest.
+struct FileRecognitionResult
+{
+    // Position of the file in the manifest.
+    size_t Index = 0;
+    std::string FileName;
+
+    // Recognized phrases, in the order of the audio.
+    std::vector<std::string> Phrases;
+
+    double AudioSeconds = 0;
+    double WallSeconds = 0;
+
+    // Set if the file could not be recognized.
+    std::string Error;
+};
+
+// Recognizes many wav files in parallel on a fixed number of worker threads, one file per worker at a time.
+// All workers share one SpeechConfig; every file gets its own pull stream and recognizer, since a recognizer
+// is bound to its audio input. Results are reported in manifest order, each as soon as it and all files
+// before it are done.
+class ParallelRecognitionRunner final
+{
+public:
+    using ResultCallback = std::function<void(const FileRecognitionResult&)>;
+
+    // Statistics of a Run() call.
+    struct Summary
+    {
+        size_t Files = 0;
+        size_t Failed = 0;
+        double AudioSeconds = 0;
+        double WallSeconds = 0;
+
+        // Audio seconds processed per wall-clock second.
+        double Throughput() const
+        {
+            return WallSeconds > 0 ? AudioSeconds / WallSeconds : 0;
+        }
+    };
+
+    // workerCount 0 uses one worker per hardware thread.
+    ParallelRecognitionRunner(std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechConfig> config, size_t workerCount = 0)
+        : m_config(config),
+          m_workerCount(workerCount > 0 ? workerCount : (std::max)(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    size_t WorkerCount() const
+    {
+        return m_workerCount;
+    }
+
+    // Reads a manifest with one wav file name per line. Empty lines and lines starting with '#' are ignored.
+    static std::vector<std::string> ReadManifest(const std::string& manifestFileName)
+    {
+        std::ifstream manifest(manifestFileName);
+        if (!manifest.good())
+        {
+            throw std::invalid_argument("Failed to open the manifest file " + manifestFileName);
+        }
+
+        std::vector<std::string> files;
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            // Tolerates manifests with Windows line endings on Linux.
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#')
+            {
+                files.push_back(line);
+            }
+        }
+        return files;
+    }
+
+    // Recognizes all files and blocks until they are done. onResult is called once per file, in manifest order,
+    // on one of the worker threads; calls never overlap. If onResult throws, the workers stop taking files, no
+    // further results are reported, and Run() rethrows the exception once the files in flight are done.
+    Summary Run(const std::vector<std::string>& files, const ResultCallback& onResult)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<FileRecognitionResult> results(files.size());
+        std::vector<bool> done(files.size(), false);
+        size_t nextToReport = 0;
+        std::mutex reportMutex;
+        std::exception_ptr callbackError;
+        std::atomic<size_t> nextFile{ 0 };
+
+        auto worker = [&]()
+        {
+            for (size_t index = nextFile++; index < files.size(); index = nextFile++)
+            {
+                auto result = RecognizeFile(index, files[index]);
+
+                // Reports all results that are complete up to the first gap in manifest order.
+                std::lock_guard<std::mutex> lock(reportMutex);
+                results[index] = std::move(result);
+                done[index] = true;
+                for (; !callbackError && nextToReport < files.size() && done[nextToReport]; nextToReport++)
+                {
+                    try
+                    {
+                        onResult(results[nextToReport]);
+                    }
+                    catch (...)
+                    {
+                        // Not thrown on the worker thread, which would terminate the process.
+                        callbackError = std::current_exception();
+                        nextFile = files.size();
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < (std::min)(m_workerCount, files.size()); i++)
+        {
+            workers.emplace_back(worker);
+        }
+        for (auto& thread : workers)
+        {
+            thread.join();
+        }
+        if (callbackError)
+        {
+            std::rethrow_exception(callbackError);
+        }
+
+        Summary summary;
+        summary.Files = files.size();
+        summary.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const auto& result : results)
+        {
+            summary.AudioSeconds += result.AudioSeconds;
+            summary.Failed += result.Error.empty() ? 0 : 1;
+        }
+        return summary;
+    }
+
+private:
+    FileRecognitionResult RecognizeFile(size_t index, const std::string& fileName)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+        using namespace Microsoft::CognitiveServices::Speech::Audio;
+
+        FileRecognitionResult result;
+        result.Index = index;
+        result.FileName = fileName;
+        auto start = std::chrono::steady_clock::now();
+
+        try
+        {
+            // Each worker drives its own pull stream callback, in the format of its file.
+            auto callback = std::make_shared<AudioInputFromFileCallback>(fileName);
+            const auto& format = callback->GetFormat();
+            auto streamFormat = AudioStreamFormat::GetWaveFormatPCM(format.SamplesPerSec, static_cast<uint8_t>(format.BitsPerSample), static_cast<uint8_t>(format.Channels));
+            auto audioInput = AudioConfig::FromStreamInput(AudioInputStream::CreatePullStream(streamFormat, callback));
+            auto recognizer = SpeechRecognizer::FromConfig(m_config, audioInput);
+
+            std::mutex resultMutex;
+            std::promise<void> recognitionEnd;
+            std::once_flag endOnce;
+            auto end = [&]() { std::call_once(endOnce, [&]() { recognitionEnd.set_value(); }); };
+
+            recognizer->Recognized.Connect([&](const SpeechRecognitionEventArgs& e)
+            {
+                if (e.Result->Reason == ResultReason::RecognizedSpeech)
+                {
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    result.Phrases.push_back(e.Result->Text);
+                }
+            });
+
+            recognizer->Canceled.Connect([&](const SpeechRecognitionCanceledEventArgs& e)
+            {
+                if (e.Reason == CancellationReason::Error)
+                {
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    result.Error = "ErrorCode=" + std::to_string(static_cast<int>(e.ErrorCode)) + " " + e.ErrorDetails;
+                    end();
+                }
+            });
+
+            recognizer->SessionStopped.Connect([&](const SessionEventArgs&)
+            {
+                end();
+            });
+
+            recognizer->StartContinuousRecognitionAsync().get();
+            recognitionEnd.get_future().wait();
+            recognizer->StopContinuousRecognitionAsync().get();
+
+            // No more events are raised once recognition has stopped; disconnects the handlers
+            // anyway, since they refer to this stack frame.
+            recognizer->Recognized.DisconnectAll();
+            recognizer->Canceled.DisconnectAll();
+            recognizer->SessionStopped.DisconnectAll();
+
+            result.AudioSeconds = callback->GetAudioSecondsRead();
+        }
+        catch (const std::exception& e)
+        {
+            result.Error = e.what();
+        }
+
+        result.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechConfig> m_config;
+    size_t m_workerCount;
+};
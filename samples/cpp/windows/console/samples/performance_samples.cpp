@@ -0,0 +1,452 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+
+#include <speechapi_cxx.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+#include "wav_file_reader.h"
+#include "channel_interleaver.h"
+#include "audio_buffer_pool.h"
+#include "audio_push_pump.h"
+#include "audio_pacer.h"
+#include "process_cpu_time.h"
+#include "result_dispatcher.h"
+#include "latency_histogram.h"
+#include "recognizer_pool.h"
+#include "recognition_latency_tracer.h"
+#include "speech_service_config.h"
+
+using namespace std;
+using namespace Microsoft::CognitiveServices::Speech;
+using namespace Microsoft::CognitiveServices::Speech::Audio;
+
+// Measures the CPU time that pushing audio into a push stream costs per second of audio, for different chunk sizes.
+// The audio is pushed through the same AudioPushPump that the push stream samples use, as fast as possible and
+// without a recognizer, so that only the client-side cost of the push path is measured: the reads, the ring buffer
+// and the PushAudioInputStream::Write() calls.
+void PushStreamChunkSizeBenchmark()
+{
+    // Loads the audio into memory once, so that disk I/O does not distort the measurement.
+    // Replace with your own audio file name.
+    WavFileReader reader("whatstheweatherlike.wav");
+    auto format = reader.GetFormat();
+    vector<uint8_t> audio;
+    WavDataView view;
+    while ((view = reader.ReadView(64 * 1024)).Size != 0)
+    {
+        audio.insert(audio.end(), view.Data, view.Data + view.Size);
+    }
+    if (audio.empty())
+    {
+        cout << "The audio file contains no audio data." << endl;
+        return;
+    }
+
+    // Seconds of audio pushed for each chunk size. The file is repeated as often as needed.
+    const double audioSeconds = 600;
+    uint32_t bytesPerSecond = format.SamplesPerSec * format.BlockAlign;
+    auto totalBytes = static_cast<uint64_t>(audioSeconds * bytesPerSecond);
+
+    cout << "Pushing " << audioSeconds << "s of " << format.SamplesPerSec << " Hz, " << format.Channels << " channel audio per chunk size." << endl;
+    cout << "chunk ms\tchunk bytes\twrites/audio s\tCPU ms/audio s\twall ms" << endl;
+
+    for (int chunkMilliseconds : { 5, 10, 20, 50, 100, 200, 500 })
+    {
+        auto chunkSize = ChunkSizeForDuration(format.SamplesPerSec, format.BlockAlign, chrono::milliseconds(chunkMilliseconds));
+        auto pushStream = AudioInputStream::CreatePushStream(AudioStreamFormat::GetWaveFormatPCM(format.SamplesPerSec, (uint8_t)format.BitsPerSample, (uint8_t)format.Channels));
+
+        uint64_t produced = 0;
+        uint64_t writes = 0;
+        AudioPushPump pump(chunkSize);
+
+        auto cpuStart = ProcessCpuSeconds();
+        auto wallStart = chrono::steady_clock::now();
+
+        pump.Run(
+            [&](uint8_t* buffer, uint32_t size)
+            {
+                // Serves the audio in a loop until the requested duration has been produced.
+                auto count = (uint32_t)min<uint64_t>({ (uint64_t)size, totalBytes - produced, audio.size() - produced % audio.size() });
+                memcpy(buffer, audio.data() + produced % audio.size(), count);
+                produced += count;
+                return count;
+            },
+            [&](const uint8_t* data, uint32_t size)
+            {
+                pushStream->Write(const_cast<uint8_t*>(data), size);
+                writes++;
+            });
+        pushStream->Close();
+
+        auto cpuSeconds = ProcessCpuSeconds() - cpuStart;
+        auto wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+
+        cout << chunkMilliseconds << "\t\t" << chunkSize << "\t\t" << writes / audioSeconds << "\t\t"
+             << cpuSeconds * 1000 / audioSeconds << "\t\t" << wallSeconds * 1000 << endl;
+    }
+
+    cout << "Buffer pool: " << AudioBufferPool::Shared().Allocated() << " buffers allocated, "
+         << AudioBufferPool::Shared().Reused() << " reused." << endl;
+}
+
+// Measures the throughput of converting 8-channel audio between the interleaved layout of wave files and push
+// streams and the planar layout (one buffer per channel), with the scalar loops and with SSE2, and of a per-channel
+// consumer that computes the energy of every channel on either layout. Synthetic audio is used, so that no
+// 8-channel file is needed.
+void ChannelLayoutBenchmark()
+{
+    const uint16_t channels = 8;
+    const uint32_t samplesPerSec = 16000;
+    const size_t audioSeconds = 60;
+    const int repetitions = 10;
+    const size_t frames = samplesPerSec * audioSeconds;
+
+    vector<int16_t> interleaved(frames * channels);
+    mt19937 random(42);
+    for (auto& sample : interleaved)
+    {
+        sample = static_cast<int16_t>(random());
+    }
+    vector<int16_t> reinterleaved(interleaved.size());
+    vector<vector<int16_t>> planes(channels, vector<int16_t>(frames));
+    vector<int16_t*> planePointers;
+    for (auto& plane : planes)
+    {
+        planePointers.push_back(plane.data());
+    }
+    vector<const int16_t*> constPlanePointers(planePointers.begin(), planePointers.end());
+
+    // The energy of every channel; the sums are checked, so that the work cannot be optimized away.
+    vector<uint64_t> energies(channels);
+    auto energyOfInterleaved = [&]()
+    {
+        fill(energies.begin(), energies.end(), 0);
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            for (uint16_t channel = 0; channel < channels; channel++)
+            {
+                auto sample = interleaved[frame * channels + channel];
+                energies[channel] += static_cast<uint64_t>(sample * sample);
+            }
+        }
+    };
+    auto energyOfPlanes = [&]()
+    {
+        for (uint16_t channel = 0; channel < channels; channel++)
+        {
+            uint64_t energy = 0;
+            for (auto sample : planes[channel])
+            {
+                energy += static_cast<uint64_t>(sample * sample);
+            }
+            energies[channel] = energy;
+        }
+    };
+
+    cout << "Converting " << audioSeconds << "s of " << samplesPerSec << " Hz, " << channels << " channel audio "
+         << repetitions << " times" << (ChannelInterleaver::HasSimd() ? "" : " (SSE2 is not available)") << "." << endl;
+    cout << "operation\t\t\tMB/s\t\tx real time" << endl;
+
+    auto measure = [&](const char* name, const function<void()>& run)
+    {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repetitions; i++)
+        {
+            run();
+        }
+        auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << name << "\t" << interleaved.size() * sizeof(int16_t) * repetitions / seconds / 1e6 << "\t\t"
+             << audioSeconds * repetitions / seconds << endl;
+    };
+
+    measure("de-interleave, scalar\t", [&]() { ChannelInterleaver::DeinterleaveScalar(interleaved.data(), frames, channels, planePointers.data()); });
+    measure("de-interleave, SIMD\t", [&]() { ChannelInterleaver::Deinterleave(interleaved.data(), frames, channels, planePointers.data()); });
+    measure("interleave, scalar\t", [&]() { ChannelInterleaver::InterleaveScalar(constPlanePointers.data(), frames, channels, reinterleaved.data()); });
+    measure("interleave, SIMD\t", [&]() { ChannelInterleaver::Interleave(constPlanePointers.data(), frames, channels, reinterleaved.data()); });
+    if (reinterleaved != interleaved)
+    {
+        cout << "Error: the audio changed in the round trip." << endl;
+        return;
+    }
+
+    measure("energy, interleaved\t", energyOfInterleaved);
+    auto interleavedEnergies = energies;
+    measure("energy, planar\t\t", energyOfPlanes);
+    measure("energy, planar + SIMD split", [&]()
+    {
+        ChannelInterleaver::Deinterleave(interleaved.data(), frames, channels, planePointers.data());
+        energyOfPlanes();
+    });
+    if (energies != interleavedEnergies)
+    {
+        cout << "Error: the energies of the layouts differ." << endl;
+    }
+}
+
+// Measures the time an event handler blocks the SDK's event thread per result, when it prints the result itself and
+// when it hands the result to a ResultDispatcher. Synthetic results are handled as fast as possible, like a burst of
+// results, and written to a file and to a slow sink that takes 1 ms per write, like a remote log or a busy console.
+void ResultDispatchBenchmark()
+{
+    const size_t resultCount = 5000;
+    const string text = "What's the weather like in Seattle this weekend, and should I take an umbrella with me?";
+
+    ofstream file("results.txt");
+    if (!file)
+    {
+        cout << "Error: results.txt cannot be written." << endl;
+        return;
+    }
+    auto slowWrite = [](const string&) { this_thread::sleep_for(chrono::milliseconds(1)); };
+
+    cout << "Handling " << resultCount << " results of " << text.size() << " characters." << endl;
+    cout << "handler				us/result	p99 us		max us		total ms" << endl;
+
+    auto measure = [&](const char* name, const function<void(size_t)>& handle, const function<void()>& finish)
+    {
+        vector<double> microseconds(resultCount);
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < resultCount; i++)
+        {
+            auto handleStart = chrono::steady_clock::now();
+            handle(i);
+            microseconds[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - handleStart).count();
+        }
+        finish();
+        auto total = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        double sum = 0;
+        for (auto value : microseconds)
+        {
+            sum += value;
+        }
+        sort(microseconds.begin(), microseconds.end());
+        cout << name << "\t" << sum / resultCount << "\t\t" << microseconds[resultCount * 99 / 100] << "\t\t"
+             << microseconds.back() << "\t\t" << total << endl;
+    };
+
+    // Formats the result into a reused string and writes it, as the handlers of the samples do with cout.
+    string line;
+    auto inlineHandler = [&](const ResultDispatcher::Sink& sink)
+    {
+        return [&, sink](size_t i)
+        {
+            line.clear();
+            line += "RECOGNIZED: Text=" + text + "\n  Offset=" + to_string(i * 10000000) + "\n  Duration=" + to_string(10000000) + "\n";
+            sink(line);
+        };
+    };
+    auto dispatch = [&](const char* name, ResultDispatcher::Sink sink)
+    {
+        ResultDispatcher dispatcher(sink, resultCount);
+        measure(name,
+            [&](size_t i)
+            {
+                dispatcher.TryPublish([&](ResultRecord& record)
+                {
+                    record.Event = ResultRecord::Kind::Recognized;
+                    record.Text = text;
+                    record.Offset = i * 10000000;
+                    record.Duration = 10000000;
+                });
+            },
+            [&]() { dispatcher.Stop(); });
+        auto statistics = dispatcher.GetStatistics();
+        if (statistics.Dropped > 0)
+        {
+            cout << "  " << statistics.Dropped << " results were dropped." << endl;
+        }
+    };
+
+    measure("inline, file\t\t", inlineHandler(ResultDispatcher::StreamSink(file)), []() {});
+    dispatch("dispatcher, file\t", ResultDispatcher::StreamSink(file));
+    measure("inline, slow sink\t", inlineHandler(slowWrite), []() {});
+    dispatch("dispatcher, slow sink\t", slowWrite);
+}
+
+// Measures the latency from a single-shot request to its result, when each request creates its recognizer and
+// connection (cold) and when it leases a recognizer with an open connection from a RecognizerPool (warm). The
+// audio of each request is pushed at once, followed by a second of silence that ends the utterance, so that the
+// difference is mostly the connection setup. The pool needs one push stream per recognizer, since recognizers are
+// bound to their audio input; the streams are kept open between the requests.
+void WarmRecognizerPoolBenchmark()
+{
+    const int requestCount = 10;
+
+    // Replace with your own audio file name.
+    WavFileReader reader("whatstheweatherlike.wav");
+    auto format = reader.GetFormat();
+    vector<uint8_t> audio;
+    WavDataView view;
+    while ((view = reader.ReadView(64 * 1024)).Size != 0)
+    {
+        audio.insert(audio.end(), view.Data, view.Data + view.Size);
+    }
+    if (audio.empty())
+    {
+        cout << "The audio file contains no audio data." << endl;
+        return;
+    }
+    audio.resize(audio.size() + format.SamplesPerSec * format.BlockAlign, 0);
+    auto streamFormat = AudioStreamFormat::GetWaveFormatPCM(format.SamplesPerSec, (uint8_t)format.BitsPerSample, (uint8_t)format.Channels);
+
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    map<SpeechRecognizer*, shared_ptr<PushAudioInputStream>> pushStreams;
+    auto createRecognizer = [&]()
+    {
+        auto pushStream = AudioInputStream::CreatePushStream(streamFormat);
+        auto recognizer = SpeechRecognizer::FromConfig(config, AudioConfig::FromStreamInput(pushStream));
+        pushStreams[recognizer.get()] = pushStream;
+        return recognizer;
+    };
+    auto push = [&](PushAudioInputStream& pushStream)
+    {
+        pushStream.Write(audio.data(), (uint32_t)audio.size());
+    };
+
+    LatencyHistogram cold;
+    LatencyHistogram warm;
+    int errors = 0;
+    auto check = [&](const shared_ptr<SpeechRecognitionResult>& result)
+    {
+        if (result->Reason == ResultReason::Canceled)
+        {
+            auto cancellation = CancellationDetails::FromResult(result);
+            cout << "CANCELED: ErrorDetails=" << cancellation->ErrorDetails << endl;
+            errors++;
+            return false;
+        }
+        return true;
+    };
+
+    cout << "Recognizing " << requestCount << " requests with new recognizers..." << endl;
+    for (int i = 0; i < requestCount; i++)
+    {
+        auto start = chrono::steady_clock::now();
+        auto recognizer = createRecognizer();
+        auto pushStream = pushStreams[recognizer.get()];
+        push(*pushStream);
+        pushStream->Close();
+        auto result = recognizer->RecognizeOnceAsync().get();
+        if (check(result))
+        {
+            cold.Add(chrono::steady_clock::now() - start);
+        }
+        pushStreams.clear();
+    }
+
+    cout << "Recognizing " << requestCount << " requests with recognizers from a warm pool..." << endl;
+    {
+        RecognizerPool<SpeechRecognizer> pool(createRecognizer, 1);
+        pool.Prewarm(1);
+        if (!pool.WaitUntilConnected(chrono::seconds(10)))
+        {
+            cout << "The connections of the pool did not open within 10 s." << endl;
+        }
+        for (int i = 0; i < requestCount; i++)
+        {
+            auto start = chrono::steady_clock::now();
+            auto recognizer = pool.Acquire();
+            push(*pushStreams[recognizer.Get().get()]);
+            auto result = recognizer->RecognizeOnceAsync().get();
+            if (check(result))
+            {
+                warm.Add(chrono::steady_clock::now() - start);
+            }
+            else
+            {
+                recognizer.MarkBroken();
+            }
+        }
+        cout << "Pool: " << pool.GetStatistics().ToString() << "." << endl;
+    }
+
+    cout << "recognizers\tp50 ms\t\tp95 ms\t\tmax ms" << endl;
+    for (auto histogram : { make_pair("new\t", &cold), make_pair("warm pool", &warm) })
+    {
+        auto values = histogram.second->Quantiles({ 0.5, 0.95, 1.0 });
+        cout << histogram.first << "\t" << values[0] * 1000 << "\t\t" << values[1] * 1000 << "\t\t" << values[2] * 1000 << endl;
+    }
+    if (errors > 0)
+    {
+        cout << errors << " requests were canceled." << endl;
+    }
+}
+
+// Measures the latency from pushing audio to its results, for continuous recognition from a push stream, with a
+// RecognitionLatencyTracer. The audio is pushed at the byte rate of the file like a live microphone would deliver it;
+// unpaced, the latencies would only measure how fast the file can be read. Prints the latencies in the Prometheus
+// text format and writes the session as a timeline to recognition_trace.json.
+void PushStreamRecognitionLatencyTrace()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    // Replace with your own audio file name.
+    WavFileReader reader("whatstheweatherlike.wav");
+    const auto& format = reader.GetFormat();
+    uint32_t bytesPerSecond = format.SamplesPerSec * format.BlockAlign;
+
+    // Relates the offsets of the results to the time their audio was pushed. Declared before the recognizer, so that
+    // it outlives the event handlers.
+    RecognitionLatencyTracer latency(bytesPerSecond);
+
+    auto pushStream = AudioInputStream::CreatePushStream();
+    auto recognizer = SpeechRecognizer::FromConfig(config, AudioConfig::FromStreamInput(pushStream));
+    latency.Attach(*recognizer);
+
+    // The session also stops after an error.
+    promise<void> recognitionEnd;
+    recognizer->Canceled.Connect([](const SpeechRecognitionCanceledEventArgs& e)
+    {
+        if (e.Reason == CancellationReason::Error)
+        {
+            cout << "CANCELED: ErrorDetails=" << e.ErrorDetails << endl;
+        }
+    });
+    recognizer->SessionStopped.Connect([&recognitionEnd](const SessionEventArgs&)
+    {
+        recognitionEnd.set_value();
+    });
+
+    recognizer->StartContinuousRecognitionAsync().wait();
+
+    // Pushes the audio in chunks of 100 ms; every chunk waits until it is due.
+    auto pacer = AudioPacer::RealTime(bytesPerSecond);
+    AudioPushPump pump(ChunkSizeForDuration(format.SamplesPerSec, format.BlockAlign, chrono::milliseconds(100)));
+    auto statistics = pump.RunFromViews(
+        [&reader](uint32_t size) { return reader.ReadView(size); },
+        [&pushStream, &latency, &pacer](const uint8_t* data, uint32_t size)
+        {
+            pacer.Pace(size);
+            pushStream->Write(const_cast<uint8_t*>(data), size);
+            latency.OnPushed(size);
+        });
+    cout << "Push pump: " << statistics.ToString() << endl;
+    pushStream->Close();
+
+    recognitionEnd.get_future().get();
+    recognizer->StopContinuousRecognitionAsync().get();
+
+    cout << "Latency: " << latency.Summary() << endl;
+    latency.WritePrometheus(cout);
+    ofstream trace("recognition_trace.json");
+    latency.WriteChromeTrace(trace);
+    cout << "Timeline written to recognition_trace.json; open it in chrome://tracing." << endl;
+}
@@ -0,0 +1,264 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <speechapi_cxx.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "latency_histogram.h"
+
+// Measures the latency of continuous recognition from an audio stream by relating the Offset and Duration of the
+// results (in ticks of 100 ns of audio) to the wall clock time at which that audio was pushed:
+//   first partial: from pushing the first audio of an utterance (its Offset) to its first Recognizing event.
+//   final:         from pushing the last audio of an utterance (Offset + Duration) to its Recognized event.
+// Each has a LatencyHistogram over all utterances, which can be exported in the Prometheus text format, and the
+// session can be exported as a timeline in the Chrome trace event format, to be opened in chrome://tracing or
+// https://ui.perfetto.dev. See https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU.
+//
+// Call OnPushed() after every write to the push stream. Audio that is pushed faster than real time queues up in the
+// SDK, and the latencies then include that queueing.
+class RecognitionLatencyTracer final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // bytesPerSecond of the pushed audio, e.g. SamplesPerSec * BlockAlign.
+    explicit RecognitionLatencyTracer(uint32_t bytesPerSecond)
+        : m_bytesPerSecond(bytesPerSecond), m_start(Clock::now())
+    {
+        if (bytesPerSecond == 0)
+        {
+            throw std::invalid_argument("The audio format must have a byte rate.");
+        }
+    }
+
+    RecognitionLatencyTracer(const RecognitionLatencyTracer&) = delete;
+    RecognitionLatencyTracer& operator=(const RecognitionLatencyTracer&) = delete;
+
+    // Subscribes to the events of the recognizer. The tracer must outlive the recognizer.
+    void Attach(Microsoft::CognitiveServices::Speech::SpeechRecognizer& recognizer)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        recognizer.Recognizing += [this](const SpeechRecognitionEventArgs& e)
+        {
+            OnRecognizing(e.Result->Offset(), e.Result->Duration());
+        };
+        recognizer.Recognized += [this](const SpeechRecognitionEventArgs& e)
+        {
+            if (e.Result->Reason == ResultReason::RecognizedSpeech)
+            {
+                OnRecognized(e.Result->Offset(), e.Result->Duration(), e.Result->Text);
+            }
+        };
+        recognizer.SessionStarted += [this](const SessionEventArgs&)
+        {
+            AddInstant("session started");
+        };
+        recognizer.SessionStopped += [this](const SessionEventArgs&)
+        {
+            AddInstant("session stopped");
+        };
+    }
+
+    // Records that size more bytes of audio have been pushed.
+    void OnPushed(uint32_t size)
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pushedBytes += size;
+        m_pushes.push_back({ m_pushedBytes * ticksPerSecond / m_bytesPerSecond, now });
+    }
+
+    void OnRecognizing(uint64_t offset, uint64_t duration)
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& utterance = m_utterances[offset];
+        utterance.Duration = (std::max)(utterance.Duration, duration);
+        if (utterance.FirstPartial == Clock::time_point())
+        {
+            utterance.FirstPartial = now;
+            m_firstPartial.Add(now - PushTime(offset));
+        }
+    }
+
+    void OnRecognized(uint64_t offset, uint64_t duration, const std::string& text)
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& utterance = m_utterances[offset];
+        if (utterance.Final != Clock::time_point())
+        {
+            return;
+        }
+        utterance.Duration = duration;
+        utterance.Final = now;
+        utterance.Text = text;
+        m_final.Add(now - PushTime(offset + duration));
+    }
+
+    // The number of utterances and the quantiles of their latencies, e.g.
+    // "12 utterances, first partial p50 310 ms p95 420 ms, final p50 650 ms p95 900 ms".
+    std::string Summary() const
+    {
+        auto milliseconds = [](const LatencyHistogram& histogram, const char* name)
+        {
+            auto values = histogram.Quantiles({ 0.5, 0.95 });
+            return std::string(", ") + name + " p50 " + std::to_string(static_cast<int>(values[0] * 1000)) +
+                " ms p95 " + std::to_string(static_cast<int>(values[1] * 1000)) + " ms";
+        };
+        return std::to_string(m_final.Count()) + " utterances" + milliseconds(m_firstPartial, "first partial") +
+            milliseconds(m_final, "final");
+    }
+
+    // Writes the histograms as Prometheus summaries.
+    void WritePrometheus(std::ostream& out) const
+    {
+        m_firstPartial.WritePrometheus(out, "speech_recognition_first_partial_seconds", "Time from pushing the start of an utterance to its first partial result.");
+        m_final.WritePrometheus(out, "speech_recognition_final_seconds", "Time from pushing the end of an utterance to its final result.");
+    }
+
+    // Writes the session as a Chrome trace: the audio pushed over time, and for every utterance the span of its
+    // audio, the wait for its final result and the moment of its first partial result.
+    void WriteChromeTrace(std::ostream& out) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::string separator = "\n";
+        auto event = [&](const std::string& fields)
+        {
+            out << separator << "{\"pid\":1," << fields << "}";
+            separator = ",\n";
+        };
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        event("\"tid\":1,\"ph\":\"M\",\"name\":\"thread_name\",\"args\":{\"name\":\"audio\"}");
+        event("\"tid\":2,\"ph\":\"M\",\"name\":\"thread_name\",\"args\":{\"name\":\"recognition\"}");
+
+        for (const auto& push : m_pushes)
+        {
+            event("\"tid\":1,\"ph\":\"C\",\"name\":\"audio pushed\",\"ts\":" + Timestamp(push.Time) +
+                ",\"args\":{\"seconds\":" + std::to_string(push.EndTicks / static_cast<double>(ticksPerSecond)) + "}");
+        }
+        for (const auto& instant : m_instants)
+        {
+            event("\"tid\":2,\"ph\":\"i\",\"s\":\"p\",\"name\":\"" + instant.first + "\",\"ts\":" + Timestamp(instant.second));
+        }
+
+        for (const auto& entry : m_utterances)
+        {
+            const auto& utterance = entry.second;
+            auto audioStart = PushTime(entry.first);
+            auto audioEnd = PushTime(entry.first + utterance.Duration);
+            auto args = ",\"args\":{\"offset\":" + std::to_string(entry.first) + ",\"duration\":" +
+                std::to_string(utterance.Duration) + ",\"text\":\"" + Escape(utterance.Text) + "\"}";
+
+            event("\"tid\":1,\"ph\":\"X\",\"name\":\"utterance audio\",\"ts\":" + Timestamp(audioStart) +
+                ",\"dur\":" + Elapsed(audioStart, audioEnd) + args);
+            if (utterance.FirstPartial != Clock::time_point())
+            {
+                event("\"tid\":2,\"ph\":\"i\",\"s\":\"t\",\"name\":\"first partial\",\"ts\":" + Timestamp(utterance.FirstPartial));
+            }
+            if (utterance.Final != Clock::time_point())
+            {
+                event("\"tid\":2,\"ph\":\"X\",\"name\":\"final result\",\"ts\":" + Timestamp(audioEnd) +
+                    ",\"dur\":" + Elapsed(audioEnd, utterance.Final) + args);
+            }
+        }
+        out << "\n]}\n";
+    }
+
+private:
+    static constexpr uint64_t ticksPerSecond = 10000000;
+
+    struct Push
+    {
+        // The audio pushed so far, in ticks.
+        uint64_t EndTicks;
+        Clock::time_point Time;
+    };
+
+    struct Utterance
+    {
+        uint64_t Duration = 0;
+        Clock::time_point FirstPartial;
+        Clock::time_point Final;
+        std::string Text;
+    };
+
+    // The time at which the audio at ticks was pushed, i.e. of the first push that reached it.
+    Clock::time_point PushTime(uint64_t ticks) const
+    {
+        if (m_pushes.empty())
+        {
+            return m_start;
+        }
+        auto push = std::lower_bound(m_pushes.begin(), m_pushes.end(), ticks,
+            [](const Push& p, uint64_t t) { return p.EndTicks < t; });
+        return push != m_pushes.end() ? push->Time : m_pushes.back().Time;
+    }
+
+    void AddInstant(const char* name)
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_instants.emplace_back(name, now);
+    }
+
+    // Microseconds since the tracer was created, the unit of trace event timestamps.
+    std::string Timestamp(Clock::time_point time) const
+    {
+        return Elapsed(m_start, time);
+    }
+
+    static std::string Elapsed(Clock::time_point from, Clock::time_point to)
+    {
+        return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>((std::max)(to, from) - from).count());
+    }
+
+    static std::string Escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    const uint64_t m_bytesPerSecond;
+    const Clock::time_point m_start;
+
+    mutable std::mutex m_mutex;
+    uint64_t m_pushedBytes = 0;
+    std::vector<Push> m_pushes;
+    std::map<uint64_t, Utterance> m_utterances;
+    std::vector<std::pair<std::string, Clock::time_point>> m_instants;
+
+    LatencyHistogram m_firstPartial;
+    LatencyHistogram m_final;
+};
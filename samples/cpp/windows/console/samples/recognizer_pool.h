@@ -0,0 +1,370 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx.h>
+
+template<typename TRecognizer>
+class RecognizerPool;
+
+// A recognizer of a RecognizerPool together with its connection, which the pool opens ahead of the requests.
+template<typename TRecognizer>
+class WarmRecognizer final
+{
+public:
+    // onDisconnected is called on the SDK's event thread when the service closes the connection.
+    WarmRecognizer(std::shared_ptr<TRecognizer> recognizer, std::function<void()> onDisconnected)
+        : m_recognizer(std::move(recognizer)),
+          m_connection(Microsoft::CognitiveServices::Speech::Connection::FromRecognizer(m_recognizer)),
+          m_onDisconnected(std::move(onDisconnected))
+    {
+        using Microsoft::CognitiveServices::Speech::ConnectionEventArgs;
+
+        m_connection->Connected += [this](const ConnectionEventArgs&)
+        {
+            m_connected = true;
+        };
+        m_connection->Disconnected += [this](const ConnectionEventArgs&)
+        {
+            m_connected = false;
+            m_onDisconnected();
+        };
+        Open();
+    }
+
+    WarmRecognizer(const WarmRecognizer&) = delete;
+    WarmRecognizer& operator=(const WarmRecognizer&) = delete;
+
+    ~WarmRecognizer()
+    {
+        m_connection->Connected.DisconnectAll();
+        m_connection->Disconnected.DisconnectAll();
+    }
+
+    const std::shared_ptr<TRecognizer>& Recognizer() const
+    {
+        return m_recognizer;
+    }
+
+    bool IsConnected() const
+    {
+        return m_connected;
+    }
+
+    // Starts connecting to the service, for single-shot recognition; does nothing if the connection is open.
+    void Open()
+    {
+        m_connection->Open(false);
+    }
+
+private:
+    std::atomic<bool> m_connected{ false };
+    std::shared_ptr<TRecognizer> m_recognizer;
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::Connection> m_connection;
+    std::function<void()> m_onDisconnected;
+};
+
+// A recognizer leased from a RecognizerPool; returns it to the pool when destroyed. Do not connect event handlers
+// to a leased recognizer, since they would stay connected for the next lease; use the results of
+// RecognizeOnceAsync() instead.
+template<typename TRecognizer>
+class PooledRecognizer final
+{
+public:
+    PooledRecognizer(PooledRecognizer&& other) noexcept
+        : m_pool(other.m_pool), m_recognizer(std::move(other.m_recognizer)), m_broken(other.m_broken)
+    {
+        other.m_pool = nullptr;
+    }
+
+    PooledRecognizer(const PooledRecognizer&) = delete;
+    PooledRecognizer& operator=(const PooledRecognizer&) = delete;
+    PooledRecognizer& operator=(PooledRecognizer&&) = delete;
+
+    ~PooledRecognizer()
+    {
+        if (m_pool != nullptr && m_recognizer)
+        {
+            m_pool->Release(std::move(m_recognizer), m_broken);
+        }
+    }
+
+    TRecognizer* operator->() const { return m_recognizer->Recognizer().get(); }
+    const std::shared_ptr<TRecognizer>& Get() const { return m_recognizer->Recognizer(); }
+
+    // Makes the pool discard the recognizer instead of leasing it again, e.g. after a recognition was canceled
+    // with an error.
+    void MarkBroken()
+    {
+        m_broken = true;
+    }
+
+private:
+    friend class RecognizerPool<TRecognizer>;
+
+    PooledRecognizer(RecognizerPool<TRecognizer>* pool, std::unique_ptr<WarmRecognizer<TRecognizer>>&& recognizer)
+        : m_pool(pool), m_recognizer(std::move(recognizer))
+    {
+    }
+
+    RecognizerPool<TRecognizer>* m_pool;
+    std::unique_ptr<WarmRecognizer<TRecognizer>> m_recognizer;
+    bool m_broken = false;
+};
+
+// Thread-safe pool of recognizers whose connections to the service are opened ahead of the requests, so that
+// short single-shot requests like commands do not pay for the TLS and websocket setup of a new recognizer.
+// Recognizers are bound to their audio input, so all recognizers of a pool share the input that the factory
+// gives them, e.g. the default microphone.
+//
+// Idle recognizers are kept warm: a maintenance thread reopens the connections that the service closed, and a
+// lease reopens the connection of its recognizer if it is still closed. Recognizers marked broken are discarded.
+// The pool must outlive its leases.
+template<typename TRecognizer>
+class RecognizerPool final
+{
+public:
+    using Factory = std::function<std::shared_ptr<TRecognizer>()>;
+
+    struct Statistics
+    {
+        // Recognizers created, leases that reused an idle one, connections reopened by the health checks, and
+        // recognizers discarded because they were broken or the pool was full.
+        uint64_t Created = 0;
+        uint64_t Reused = 0;
+        uint64_t Reopened = 0;
+        uint64_t Discarded = 0;
+
+        std::string ToString() const
+        {
+            return std::to_string(Created) + " recognizers created, " + std::to_string(Reused) + " leases reused one, " +
+                std::to_string(Reopened) + " connections reopened, " + std::to_string(Discarded) + " recognizers discarded";
+        }
+    };
+
+    // maxIdle limits the number of idle recognizers kept. The maintenance thread checks the idle connections at
+    // least every keepWarmInterval, and whenever the service closes one.
+    explicit RecognizerPool(Factory factory, size_t maxIdle = 4, std::chrono::milliseconds keepWarmInterval = std::chrono::seconds(30))
+        : m_factory(std::move(factory)), m_maxIdle(maxIdle), m_keepWarmInterval(keepWarmInterval)
+    {
+        if (!m_factory || maxIdle == 0)
+        {
+            throw std::invalid_argument("The pool needs a factory and room for at least one recognizer.");
+        }
+        m_maintenance = std::thread([this]() { KeepWarm(); });
+    }
+
+    RecognizerPool(const RecognizerPool&) = delete;
+    RecognizerPool& operator=(const RecognizerPool&) = delete;
+
+    ~RecognizerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeUp.notify_all();
+        m_maintenance.join();
+
+        // Destroys the recognizers outside of the lock, since their event handlers take it.
+        std::vector<std::unique_ptr<WarmRecognizer<TRecognizer>>> idle;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            idle.swap(m_idle);
+        }
+    }
+
+    // Creates recognizers and opens their connections ahead of the first requests, e.g. at startup for the expected
+    // number of concurrent requests.
+    void Prewarm(size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            auto recognizer = Create();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_idle.size() >= m_maxIdle)
+            {
+                return;
+            }
+            m_idle.push_back(std::move(recognizer));
+        }
+    }
+
+    // Waits until the connections of all idle recognizers are open; returns false on timeout.
+    bool WaitUntilConnected(std::chrono::milliseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            bool connected = true;
+            for (const auto& recognizer : m_idle)
+            {
+                connected = connected && recognizer->IsConnected();
+            }
+            if (connected)
+            {
+                return true;
+            }
+            if (m_wakeUp.wait_until(lock, (std::min)(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(10))) == std::cv_status::timeout &&
+                std::chrono::steady_clock::now() >= deadline)
+            {
+                return false;
+            }
+        }
+    }
+
+    // Leases the most recently used idle recognizer, or creates one. The connection of an idle recognizer that is
+    // not open is reopened before it is handed out.
+    PooledRecognizer<TRecognizer> Acquire()
+    {
+        std::unique_ptr<WarmRecognizer<TRecognizer>> recognizer;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_idle.empty())
+            {
+                recognizer = std::move(m_idle.back());
+                m_idle.pop_back();
+                m_statistics.Reused++;
+            }
+        }
+        if (!recognizer)
+        {
+            recognizer = Create();
+        }
+        else if (!recognizer->IsConnected())
+        {
+            recognizer->Open();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_statistics.Reopened++;
+        }
+        return PooledRecognizer<TRecognizer>(this, std::move(recognizer));
+    }
+
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_statistics;
+    }
+
+private:
+    friend class PooledRecognizer<TRecognizer>;
+
+    std::unique_ptr<WarmRecognizer<TRecognizer>> Create()
+    {
+        std::unique_ptr<WarmRecognizer<TRecognizer>> recognizer(new WarmRecognizer<TRecognizer>(m_factory(), [this]()
+        {
+            // Only flags the connection; it is reopened on the maintenance thread, not on the SDK's event thread.
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_disconnected = true;
+            }
+            m_wakeUp.notify_all();
+        }));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_statistics.Created++;
+        return recognizer;
+    }
+
+    void Release(std::unique_ptr<WarmRecognizer<TRecognizer>>&& recognizer, bool broken)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!broken && m_idle.size() < m_maxIdle)
+            {
+                m_idle.push_back(std::move(recognizer));
+                return;
+            }
+            m_statistics.Discarded++;
+        }
+        // Destroys the recognizer outside of the lock.
+        recognizer.reset();
+    }
+
+    // Reopens the closed connections of idle recognizers, after the service closed one or every keepWarmInterval.
+    // The recognizers are taken out of the pool meanwhile, so that they are neither leased nor destroyed.
+    void KeepWarm()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping)
+        {
+            m_wakeUp.wait_for(lock, m_keepWarmInterval, [this]() { return m_stopping || m_disconnected; });
+            m_disconnected = false;
+            if (m_stopping)
+            {
+                return;
+            }
+
+            std::vector<std::unique_ptr<WarmRecognizer<TRecognizer>>> closed;
+            for (auto it = m_idle.begin(); it != m_idle.end();)
+            {
+                if (!(*it)->IsConnected())
+                {
+                    closed.push_back(std::move(*it));
+                    it = m_idle.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            if (closed.empty())
+            {
+                continue;
+            }
+
+            lock.unlock();
+            for (auto& recognizer : closed)
+            {
+                recognizer->Open();
+            }
+            lock.lock();
+            m_statistics.Reopened += closed.size();
+            std::vector<std::unique_ptr<WarmRecognizer<TRecognizer>>> overflow;
+            for (auto& recognizer : closed)
+            {
+                // Recognizers released meanwhile may have filled the pool; the surplus is discarded, as in Release().
+                if (m_idle.size() >= m_maxIdle)
+                {
+                    overflow.push_back(std::move(recognizer));
+                    m_statistics.Discarded++;
+                    continue;
+                }
+                // The most recently used recognizers are leased first; reopened ones go to the back of the line.
+                m_idle.insert(m_idle.begin(), std::move(recognizer));
+            }
+            if (!overflow.empty())
+            {
+                // Destroys the recognizers outside of the lock.
+                lock.unlock();
+                overflow.clear();
+                lock.lock();
+            }
+        }
+    }
+
+    Factory m_factory;
+    size_t m_maxIdle;
+    std::chrono::milliseconds m_keepWarmInterval;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::vector<std::unique_ptr<WarmRecognizer<TRecognizer>>> m_idle;
+    Statistics m_statistics;
+    bool m_disconnected = false;
+    bool m_stopping = false;
+    std::thread m_maintenance;
+};
@@ -0,0 +1,464 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <speechapi_cxx.h>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+// The fields of a recognition result that the samples print. Records live in the slots of a ResultDispatcher and
+// are reused, so that their strings keep their capacity and publishing stops allocating once the strings have grown
+// to the usual result sizes.
+struct ResultRecord
+{
+    enum class Kind
+    {
+        Recognizing,
+        Recognized,
+        NoMatch,
+        Canceled
+    };
+
+    Kind Event = Kind::Recognized;
+    std::string Text;
+    uint64_t Offset = 0;
+    uint64_t Duration = 0;
+
+    // The speaker of conversation transcription results.
+    std::string SpeakerId;
+
+    // The first TranslationCount entries (language, text) are the translations of translation results.
+    std::vector<std::pair<std::string, std::string>> Translations;
+    size_t TranslationCount = 0;
+
+    // Of translation results whose speech was recognized but could not be translated.
+    bool Untranslated = false;
+
+    // Of canceled events; Text holds the error details.
+    int CancellationReason = 0;
+    int ErrorCode = 0;
+};
+
+// Moves the handling of recognition results off the SDK's event thread. The event handlers only copy the fields of
+// the result into a record of a bounded lock-free multi-producer single-consumer queue; a consumer thread formats
+// the records and hands them to a sink in batches, e.g. the console, a file or a socket. A slow sink then delays
+// the output instead of the recognition.
+//
+// The queue is a ring of slots with sequence numbers: a producer claims a slot by advancing the enqueue position
+// with a compare-and-swap, fills the record and publishes it by advancing the slot's sequence; the consumer frees
+// the slot by advancing the sequence by the ring size. If the ring is full, the result is dropped and counted
+// rather than blocking the event thread.
+class ResultDispatcher final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Receives the text of a batch of records, one line per record.
+    using Sink = std::function<void(const std::string& batch)>;
+
+    // Appends the text of a record to a batch, on the consumer thread. Every sample passes the format of its
+    // original event handlers.
+    using Formatter = std::function<void(const ResultRecord& record, std::string& out)>;
+
+    struct Statistics
+    {
+        uint64_t Published = 0;
+        uint64_t Dropped = 0;
+        uint64_t Batches = 0;
+
+        // The time the event handlers spent in Publish().
+        std::chrono::nanoseconds PublishTime{ 0 };
+        std::chrono::nanoseconds MaxPublishTime{ 0 };
+
+        std::string ToString() const
+        {
+            auto average = Published > 0 ? PublishTime.count() / 1000.0 / Published : 0.0;
+            return std::to_string(Published) + " results in " + std::to_string(Batches) + " batches, " +
+                std::to_string(Dropped) + " dropped, " + std::to_string(average) + " us per result on the event thread (max " +
+                std::to_string(MaxPublishTime.count() / 1000.0) + " us)";
+        }
+    };
+
+    // Returns a sink that writes every batch to a stream, e.g. std::cout or a std::ofstream, and flushes it.
+    static Sink StreamSink(std::ostream& stream)
+    {
+        return [&stream](const std::string& batch)
+        {
+            if (!stream.write(batch.data(), batch.size()).flush())
+            {
+                throw std::runtime_error("Failed to write the results to the sink.");
+            }
+        };
+    }
+
+#ifndef _WIN32
+    // Returns a sink that writes every batch to a file descriptor, e.g. a connected socket or a pipe.
+    static Sink DescriptorSink(int fd)
+    {
+        return [fd](const std::string& batch)
+        {
+            size_t written = 0;
+            while (written < batch.size())
+            {
+                auto result = write(fd, batch.data() + written, batch.size() - written);
+                if (result < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (result <= 0)
+                {
+                    throw std::runtime_error("Failed to write the results to the sink.");
+                }
+                written += static_cast<size_t>(result);
+            }
+        };
+    }
+#endif
+
+    // capacity is the number of records in the ring, rounded up to a power of two. maxBatch limits the records
+    // handed to the sink at once.
+    explicit ResultDispatcher(Sink sink, size_t capacity = 1024, size_t maxBatch = 64)
+        : ResultDispatcher(std::move(sink), Format, capacity, maxBatch)
+    {
+    }
+
+    ResultDispatcher(Sink sink, Formatter format, size_t capacity = 1024, size_t maxBatch = 64)
+        : m_sink(std::move(sink)), m_format(std::move(format)), m_maxBatch(maxBatch)
+    {
+        if (capacity == 0 || maxBatch == 0)
+        {
+            throw std::invalid_argument("The capacity and the batch size must be greater than 0.");
+        }
+        size_t rounded = 1;
+        while (rounded < capacity)
+        {
+            rounded <<= 1;
+        }
+        m_slots.reset(new Slot[rounded]);
+        m_mask = rounded - 1;
+        for (size_t i = 0; i < rounded; i++)
+        {
+            m_slots[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+        m_consumer = std::thread([this]() { Consume(); });
+    }
+
+    ResultDispatcher(const ResultDispatcher&) = delete;
+    ResultDispatcher& operator=(const ResultDispatcher&) = delete;
+
+    ~ResultDispatcher()
+    {
+        Join();
+    }
+
+    // Publishes a Recognizing or Recognized result; a Recognized result that is no match is published as NoMatch.
+    // Works for speech, translation and conversation transcription results.
+    template<typename Result>
+    bool Publish(ResultRecord::Kind kind, const std::shared_ptr<Result>& result)
+    {
+        using Microsoft::CognitiveServices::Speech::ResultReason;
+        if (kind == ResultRecord::Kind::Recognized && result->Reason == ResultReason::NoMatch)
+        {
+            kind = ResultRecord::Kind::NoMatch;
+        }
+        return TryPublish([&](ResultRecord& record)
+        {
+            record.Event = kind;
+            record.Text = result->Text;
+            record.Offset = result->Offset();
+            record.Duration = result->Duration();
+            CopyDetails(*result, record);
+        });
+    }
+
+    bool PublishCanceled(Microsoft::CognitiveServices::Speech::CancellationReason reason,
+        Microsoft::CognitiveServices::Speech::CancellationErrorCode errorCode, const std::string& errorDetails)
+    {
+        return TryPublish([&](ResultRecord& record)
+        {
+            record.Event = ResultRecord::Kind::Canceled;
+            record.Text = errorDetails;
+            record.CancellationReason = static_cast<int>(reason);
+            record.ErrorCode = static_cast<int>(errorCode);
+            record.SpeakerId.clear();
+            record.TranslationCount = 0;
+            record.Untranslated = false;
+        });
+    }
+
+    // Claims a slot and lets fill copy the result into its record; fill must not throw. Returns false if the ring
+    // is full or the dispatcher is stopped. Thread-safe and lock-free, apart from waking up an idle consumer.
+    template<typename Fill>
+    bool TryPublish(Fill fill)
+    {
+        auto start = Clock::now();
+        if (m_stopping.load(std::memory_order_relaxed))
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto position = m_enqueuePosition.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;)
+        {
+            slot = &m_slots[position & m_mask];
+            auto sequence = slot->Sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // The consumer has not freed the slot of the previous round yet: the ring is full.
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = m_enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(slot->Record);
+        slot->Sequence.store(position + 1, std::memory_order_release);
+        WakeUpConsumer();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        m_published.fetch_add(1, std::memory_order_relaxed);
+        m_publishNanoseconds.fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+        auto max = m_maxPublishNanoseconds.load(std::memory_order_relaxed);
+        while (static_cast<uint64_t>(elapsed) > max &&
+            !m_maxPublishNanoseconds.compare_exchange_weak(max, static_cast<uint64_t>(elapsed), std::memory_order_relaxed))
+        {
+        }
+        return true;
+    }
+
+    // Hands the remaining records to the sink and stops the consumer thread. Rethrows an exception of the sink.
+    void Stop()
+    {
+        Join();
+        if (m_error)
+        {
+            auto error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    Statistics GetStatistics() const
+    {
+        Statistics statistics;
+        statistics.Published = m_published.load(std::memory_order_relaxed);
+        statistics.Dropped = m_dropped.load(std::memory_order_relaxed);
+        statistics.Batches = m_batches.load(std::memory_order_relaxed);
+        statistics.PublishTime = std::chrono::nanoseconds(m_publishNanoseconds.load(std::memory_order_relaxed));
+        statistics.MaxPublishTime = std::chrono::nanoseconds(m_maxPublishNanoseconds.load(std::memory_order_relaxed));
+        return statistics;
+    }
+
+    // Appends the lines of a record, in the format of the event handlers of the speech recognition samples.
+    static void Format(const ResultRecord& record, std::string& out)
+    {
+        switch (record.Event)
+        {
+        case ResultRecord::Kind::Recognizing:
+            out += "Recognizing:" + record.Text + '\n';
+            break;
+        case ResultRecord::Kind::Recognized:
+            out += "RECOGNIZED: Text=" + record.Text + "\n  Offset=" + std::to_string(record.Offset) +
+                "\n  Duration=" + std::to_string(record.Duration) + '\n';
+            break;
+        case ResultRecord::Kind::NoMatch:
+            out += "NOMATCH: Speech could not be recognized.\n";
+            break;
+        case ResultRecord::Kind::Canceled:
+            switch (static_cast<Microsoft::CognitiveServices::Speech::CancellationReason>(record.CancellationReason))
+            {
+            case Microsoft::CognitiveServices::Speech::CancellationReason::EndOfStream:
+                out += "CANCELED: Reach the end of the file.\n";
+                break;
+            case Microsoft::CognitiveServices::Speech::CancellationReason::Error:
+                out += "CANCELED: ErrorCode=" + std::to_string(record.ErrorCode) + "\nCANCELED: ErrorDetails=" + record.Text + '\n';
+                break;
+            default:
+                out += "CANCELED: received unknown reason.\n";
+                break;
+            }
+            break;
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> Sequence{ 0 };
+        ResultRecord Record;
+    };
+
+    static void CopyDetails(const Microsoft::CognitiveServices::Speech::RecognitionResult&, ResultRecord& record)
+    {
+        record.SpeakerId.clear();
+        record.TranslationCount = 0;
+        record.Untranslated = false;
+    }
+
+    static void CopyDetails(const Microsoft::CognitiveServices::Speech::Transcription::ConversationTranscriptionResult& result, ResultRecord& record)
+    {
+        record.SpeakerId = result.UserId;
+        record.TranslationCount = 0;
+        record.Untranslated = false;
+    }
+
+    static void CopyDetails(const Microsoft::CognitiveServices::Speech::Translation::TranslationRecognitionResult& result, ResultRecord& record)
+    {
+        record.SpeakerId.clear();
+        const auto& translations = result.Translations;
+        if (record.Translations.size() < translations.size())
+        {
+            record.Translations.resize(translations.size());
+        }
+        size_t i = 0;
+        for (const auto& translation : translations)
+        {
+            record.Translations[i].first = translation.first;
+            record.Translations[i].second = translation.second;
+            i++;
+        }
+        record.TranslationCount = translations.size();
+        record.Untranslated = record.Event == ResultRecord::Kind::Recognized &&
+            result.Reason == Microsoft::CognitiveServices::Speech::ResultReason::RecognizedSpeech;
+    }
+
+    void Join()
+    {
+        if (m_consumer.joinable())
+        {
+            m_stopping.store(true);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            m_wakeUp.notify_one();
+            m_consumer.join();
+        }
+    }
+
+    // A producer takes the mutex only if the consumer is about to sleep, so that the wake-up cannot get lost
+    // between the consumer's check of the ring and its wait.
+    void WakeUpConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerWaiting.load(std::memory_order_relaxed))
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            m_wakeUp.notify_one();
+        }
+    }
+
+    bool HasRecord() const
+    {
+        return m_slots[m_dequeuePosition & m_mask].Sequence.load(std::memory_order_acquire) == m_dequeuePosition + 1;
+    }
+
+    void Consume()
+    {
+        std::string batch;
+        for (;;)
+        {
+            batch.clear();
+            size_t count = 0;
+            while (count < m_maxBatch && HasRecord())
+            {
+                auto& slot = m_slots[m_dequeuePosition & m_mask];
+                m_format(slot.Record, batch);
+                slot.Sequence.store(m_dequeuePosition + m_mask + 1, std::memory_order_release);
+                m_dequeuePosition++;
+                count++;
+            }
+
+            if (count > 0)
+            {
+                if (!m_error)
+                {
+                    try
+                    {
+                        m_sink(batch);
+                    }
+                    catch (...)
+                    {
+                        // Keeps draining the ring, so that the producers do not start dropping results.
+                        m_error = std::current_exception();
+                    }
+                }
+                m_batches.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_consumerWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!HasRecord())
+            {
+                if (m_stopping.load())
+                {
+                    m_consumerWaiting.store(false, std::memory_order_relaxed);
+                    return;
+                }
+                m_wakeUp.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            m_consumerWaiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    Sink m_sink;
+    Formatter m_format;
+    size_t m_maxBatch;
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask = 0;
+
+    static constexpr size_t cacheLineSize = 64;
+
+    // Written by the producers.
+    alignas(cacheLineSize) std::atomic<size_t> m_enqueuePosition{ 0 };
+    std::atomic<uint64_t> m_published{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_publishNanoseconds{ 0 };
+    std::atomic<uint64_t> m_maxPublishNanoseconds{ 0 };
+
+    // Written by the consumer.
+    alignas(cacheLineSize) size_t m_dequeuePosition = 0;
+    std::atomic<uint64_t> m_batches{ 0 };
+    std::exception_ptr m_error;
+
+    alignas(cacheLineSize) std::atomic<bool> m_consumerWaiting{ false };
+    std::atomic<bool> m_stopping{ false };
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::thread m_consumer;
+};
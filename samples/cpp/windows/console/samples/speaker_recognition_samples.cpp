@@ -10,6 +10,8 @@
 #include <vector>
 #include <speechapi_cxx.h>
 #include "wav_file_reader.h"
+#include "audio_input_from_file_callback.h"
+#include "audio_push_pump.h"
 
 using namespace std;
 using namespace Microsoft::CognitiveServices::Speech;
@@ -18,36 +20,6 @@ using namespace Microsoft::CognitiveServices::Speech::Audio;
 
 const string audioDirName{ "..\\..\\..\\..\\..\\SampleData\\audiofiles\\" };
 
-// AudioInputFromFileCallback implements PullAudioInputStreamCallback interface, and uses a wav file as source
-class AudioInputFromFileCallback final : public PullAudioInputStreamCallback
-{
-public:
-    // Constructor that creates an input stream from a file.
-    AudioInputFromFileCallback(const string& audioFileName)
-        : m_reader(audioFileName)
-    {
-    }
-
-    // Implements AudioInputStream::Read() which is called to get data from the audio stream.
-    // It copies data available in the stream to 'dataBuffer', but no more than 'size' bytes.
-    // If the data available is less than 'size' bytes, it is allowed to just return the amount of data that is currently available.
-    // If there is no data, this function must wait until data is available.
-    // It returns the number of bytes that have been copied in 'dataBuffer'.
-    // It returns 0 to indicate that the stream reaches end or is closed.
-    int Read(uint8_t* dataBuffer, uint32_t size) override
-    {
-        return m_reader.Read(dataBuffer, size);
-    }
-    // Implements AudioInputStream::Close() which is called when the stream needs to be closed.
-    void Close() override
-    {
-        m_reader.Close();
-    }
-
-private:
-    WavFileReader m_reader;
-};
-
 // helper functions
 shared_ptr<VoiceProfile> VoiceProfileEnrollmentWithMicrophone(const shared_ptr<VoiceProfileClient>& client);
 void VerifyVoiceProfileFromMicrophone(const shared_ptr<SpeechConfig>& config, const shared_ptr<VoiceProfile>& profile);
@@ -264,14 +236,19 @@ int PushData(const string& filename, shared_ptr<PushAudioInputStream>& pushStrea
     {
         WavFileReader reader(filename);
 
-        vector<uint8_t> buffer(1000);
-        // Read data and push them into the stream
-        int readSamples = 0;
-        while ((readSamples = reader.Read(buffer.data(), (uint32_t)buffer.size())) != 0)
-        {
-            // Push a buffer into the stream
-            pushStream->Write(buffer.data(), readSamples);
-        }
+        // Read data on a separate thread and push them into the stream from this one, decoupled by a ring buffer.
+        // The audio is pushed in chunks of 100 ms, whatever the format of the file.
+        const auto& format = reader.GetFormat();
+        AudioPushPump pump(ChunkSizeForDuration(format.SamplesPerSec, format.BlockAlign, chrono::milliseconds(100)));
+        // ReadView() hands out the audio data without copying it when the file is memory mapped.
+        auto statistics = pump.RunFromViews(
+            [&reader](uint32_t size) { return reader.ReadView(size); },
+            [&pushStream](const uint8_t* data, uint32_t size)
+            {
+                // Push a buffer into the stream. The stream copies the data, so it is not modified.
+                pushStream->Write(const_cast<uint8_t*>(data), size);
+            });
+        cout << "Push pump: " << statistics.ToString() << endl;
 
         // Close the push stream.
         pushStream->Close();
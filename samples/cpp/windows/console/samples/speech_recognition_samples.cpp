@@ -9,6 +9,12 @@
 #include <speechapi_cxx.h>
 #include <fstream>
 #include "wav_file_reader.h"
+#include "audio_input_from_file_callback.h"
+#include "parallel_recognition_runner.h"
+#include "audio_push_pump.h"
+#include "result_dispatcher.h"
+#include "speech_service_config.h"
+#include "recognizer_pool.h"
 
 using namespace std;
 using namespace Microsoft::CognitiveServices::Speech;
@@ -226,41 +232,13 @@ void SpeechRecognitionUsingCustomizedModel()
 void SpeechContinuousRecognitionWithPullStream()
 {
     // First, define your own pull audio input stream callback class that implements the
-    // PullAudioInputStreamCallback interface. The sample here illustrates how to define such
-    // a callback that reads audio data from a wav file.
-    // AudioInputFromFileCallback implements PullAudioInputStreamCallback interface, and uses a wav file as source
-    class AudioInputFromFileCallback final : public PullAudioInputStreamCallback
-    {
-    public:
-        // Constructor that creates an input stream from a file.
-        AudioInputFromFileCallback(const string& audioFileName)
-            : m_reader(audioFileName)
-        {
-        }
-
-        // Implements AudioInputStream::Read() which is called to get data from the audio stream.
-        // It copies data available in the stream to 'dataBuffer', but no more than 'size' bytes.
-        // If the data available is less than 'size' bytes, it is allowed to just return the amount of data that is currently available.
-        // If there is no data, this function must wait until data is available.
-        // It returns the number of bytes that have been copied in 'dataBuffer'.
-        // It returns 0 to indicate that the stream reaches end or is closed.
-        int Read(uint8_t* dataBuffer, uint32_t size) override
-        {
-            return m_reader.Read(dataBuffer, size);
-        }
-        // Implements AudioInputStream::Close() which is called when the stream needs to be closed.
-        void Close() override
-        {
-            m_reader.Close();
-        }
-
-    private:
-        WavFileReader m_reader;
-    };
+    // PullAudioInputStreamCallback interface. The sample here uses AudioInputFromFileCallback,
+    // defined in audio_input_from_file_callback.h, which reads audio data from a wav file.
 
     // Creates an instance of a speech config with specified subscription key and service region.
     // Replace with your own subscription key and service region (e.g., "westus").
-    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
 
     // Creates a callback that will read audio data from a WAV file.
     // Currently, the only supported WAV format is mono(single channel), 16 kHZ sample rate, 16 bits per sample.
@@ -268,6 +246,10 @@ void SpeechContinuousRecognitionWithPullStream()
     auto callback = make_shared<AudioInputFromFileCallback>("whatstheweatherlike.wav");
     auto pullStream = AudioInputStream::CreatePullStream(callback);
 
+    // Prints the results on a separate thread, so that the event handlers only copy them and return.
+    // Declared before the recognizer, so that it outlives the event handlers.
+    ResultDispatcher dispatcher(ResultDispatcher::StreamSink(cout));
+
     // Creates a speech recognizer from stream input;
     auto audioInput = AudioConfig::FromStreamInput(pullStream);
     auto recognizer = SpeechRecognizer::FromConfig(config, audioInput);
@@ -276,41 +258,22 @@ void SpeechContinuousRecognitionWithPullStream()
     promise<void> recognitionEnd;
 
     // Subscribes to events.
-    recognizer->Recognizing.Connect([](const SpeechRecognitionEventArgs& e)
+    recognizer->Recognizing.Connect([&dispatcher](const SpeechRecognitionEventArgs& e)
     {
-        cout << "Recognizing:" << e.Result->Text << std::endl;
+        dispatcher.Publish(ResultRecord::Kind::Recognizing, e.Result);
     });
 
-    recognizer->Recognized.Connect([] (const SpeechRecognitionEventArgs& e)
+    recognizer->Recognized.Connect([&dispatcher](const SpeechRecognitionEventArgs& e)
     {
-        if (e.Result->Reason == ResultReason::RecognizedSpeech)
-        {
-            cout << "RECOGNIZED: Text=" << e.Result->Text << std::endl
-                 << "  Offset=" << e.Result->Offset() << std::endl
-                 << "  Duration=" << e.Result->Duration() << std::endl;
-        }
-        else if (e.Result->Reason == ResultReason::NoMatch)
-        {
-            cout << "NOMATCH: Speech could not be recognized." << std::endl;
-        }
+        dispatcher.Publish(ResultRecord::Kind::Recognized, e.Result);
     });
 
-    recognizer->Canceled.Connect([&recognitionEnd](const SpeechRecognitionCanceledEventArgs& e)
+    recognizer->Canceled.Connect([&recognitionEnd, &dispatcher](const SpeechRecognitionCanceledEventArgs& e)
     {
-        switch (e.Reason)
+        dispatcher.PublishCanceled(e.Reason, e.ErrorCode, e.ErrorDetails);
+        if (e.Reason == CancellationReason::Error)
         {
-        case CancellationReason::EndOfStream:
-            cout << "CANCELED: Reach the end of the file." << std::endl;
-            break;
-
-        case CancellationReason::Error:
-            cout << "CANCELED: ErrorCode=" << (int)e.ErrorCode << std::endl;
-            cout << "CANCELED: ErrorDetails=" << e.ErrorDetails << std::endl;
             recognitionEnd.set_value();
-            break;
-
-        default:
-            cout << "unknown reason ?!" << std::endl;
         }
     });
 
@@ -328,17 +291,26 @@ void SpeechContinuousRecognitionWithPullStream()
 
     // Stops recognition.
     recognizer->StopContinuousRecognitionAsync().wait();
+
+    // Prints the remaining results.
+    dispatcher.Stop();
+    cout << "Result dispatcher: " << dispatcher.GetStatistics().ToString() << std::endl;
 }
 
 void SpeechContinuousRecognitionWithPushStream()
 {
     // Creates an instance of a speech config with specified subscription key and service region.
     // Replace with your own subscription key and service region (e.g., "westus").
-    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
 
     // Creates a push stream
     auto pushStream = AudioInputStream::CreatePushStream();
 
+    // Prints the results on a separate thread, so that the event handlers only copy them and return.
+    // Declared before the recognizer, so that it outlives the event handlers.
+    ResultDispatcher dispatcher(ResultDispatcher::StreamSink(cout));
+
     // Creates a speech recognizer from stream input;
     auto audioInput = AudioConfig::FromStreamInput(pushStream);
     auto recognizer = SpeechRecognizer::FromConfig(config, audioInput);
@@ -347,43 +319,23 @@ void SpeechContinuousRecognitionWithPushStream()
     promise<void> recognitionEnd;
 
     // Subscribes to events.
-    recognizer->Recognizing.Connect([](const SpeechRecognitionEventArgs& e)
+    recognizer->Recognizing.Connect([&dispatcher](const SpeechRecognitionEventArgs& e)
     {
-        cout << "Recognizing:" << e.Result->Text << std::endl;
+        dispatcher.Publish(ResultRecord::Kind::Recognizing, e.Result);
     });
 
-    recognizer->Recognized.Connect([](const SpeechRecognitionEventArgs& e)
+    recognizer->Recognized.Connect([&dispatcher](const SpeechRecognitionEventArgs& e)
     {
-        if (e.Result->Reason == ResultReason::RecognizedSpeech)
-        {
-            cout << "RECOGNIZED: Text=" << e.Result->Text << std::endl
-                << "  Offset=" << e.Result->Offset() << std::endl
-                << "  Duration=" << e.Result->Duration() << std::endl;
-        }
-        else if (e.Result->Reason == ResultReason::NoMatch)
-        {
-            cout << "NOMATCH: Speech could not be recognized." << std::endl;
-        }
+        dispatcher.Publish(ResultRecord::Kind::Recognized, e.Result);
     });
 
-    recognizer->Canceled.Connect([&recognitionEnd](const SpeechRecognitionCanceledEventArgs& e)
+    recognizer->Canceled.Connect([&recognitionEnd, &dispatcher](const SpeechRecognitionCanceledEventArgs& e)
     {
-        switch (e.Reason)
+        dispatcher.PublishCanceled(e.Reason, e.ErrorCode, e.ErrorDetails);
+        if (e.Reason == CancellationReason::Error)
         {
-        case CancellationReason::EndOfStream:
-            cout << "CANCELED: Reach the end of the file." << std::endl;
-            break;
-
-        case CancellationReason::Error:
-            cout << "CANCELED: ErrorCode=" << (int)e.ErrorCode << std::endl;
-            cout << "CANCELED: ErrorDetails=" << e.ErrorDetails << std::endl;
             recognitionEnd.set_value();
-            break;
-
-        default:
-            cout << "CANCELED: received unknown reason." << std::endl;
         }
-
     });
 
     recognizer->SessionStopped.Connect([&recognitionEnd](const SessionEventArgs& e)
@@ -393,19 +345,24 @@ void SpeechContinuousRecognitionWithPushStream()
     });
 
     WavFileReader reader("whatstheweatherlike.wav");
-
-    vector<uint8_t> buffer(1000);
+    const auto& format = reader.GetFormat();
 
     // Starts continuous recognition. Uses StopContinuousRecognitionAsync() to stop recognition.
     recognizer->StartContinuousRecognitionAsync().wait();
 
-    // Read data and push them into the stream
-    int readSamples = 0;
-    while((readSamples = reader.Read(buffer.data(), (uint32_t)buffer.size())) != 0)
-    {
-        // Push a buffer into the stream
-        pushStream->Write(buffer.data(), readSamples);
-    }
+    // Read data on a separate thread and push them into the stream from this one, decoupled by a ring buffer,
+    // so that a stall on either side does not hold up the other.
+    // The audio is pushed in chunks of 100 ms, whatever the format of the file.
+    AudioPushPump pump(ChunkSizeForDuration(format.SamplesPerSec, format.BlockAlign, chrono::milliseconds(100)));
+    // ReadView() hands out the audio data without copying it when the file is memory mapped.
+    auto statistics = pump.RunFromViews(
+        [&reader](uint32_t size) { return reader.ReadView(size); },
+        [&pushStream](const uint8_t* data, uint32_t size)
+        {
+            // Push a buffer into the stream. The stream copies the data, so it is not modified.
+            pushStream->Write(const_cast<uint8_t*>(data), size);
+        });
+    cout << "Push pump: " << statistics.ToString() << std::endl;
 
     // Close the push stream.
     pushStream->Close();
@@ -415,6 +372,10 @@ void SpeechContinuousRecognitionWithPushStream()
 
     // Stops recognition.
     recognizer->StopContinuousRecognitionAsync().get();
+
+    // Prints the remaining results.
+    dispatcher.Stop();
+    cout << "Result dispatcher: " << dispatcher.GetStatistics().ToString() << std::endl;
 }
 
 // Keyword-triggered speech recognition using microphone.
@@ -698,3 +659,89 @@ void PronunciationAssessmentWithMicrophone()
         }
     }
 }
+
+// Speech recognition of the wav files listed in a manifest, in parallel.
+void SpeechRecognitionWithManifestInParallel()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    // Reads the list of wav files to recognize, one file name per line.
+    // Replace with your own manifest file name.
+    auto files = ParallelRecognitionRunner::ReadManifest("recognition_manifest.txt");
+
+    // Uses one worker per hardware thread. Every worker recognizes one file at a time.
+    ParallelRecognitionRunner runner(config);
+    cout << "Recognizing " << files.size() << " files with " << runner.WorkerCount() << " workers." << std::endl;
+
+    // Results are printed in manifest order.
+    auto summary = runner.Run(files, [](const FileRecognitionResult& result)
+    {
+        cout << "FILE " << result.Index << ": " << result.FileName << std::endl;
+        if (!result.Error.empty())
+        {
+            cout << "  CANCELED: " << result.Error << std::endl;
+            return;
+        }
+        for (const auto& phrase : result.Phrases)
+        {
+            cout << "  RECOGNIZED: Text=" << phrase << std::endl;
+        }
+        cout << "  " << result.AudioSeconds << "s of audio in " << result.WallSeconds << "s" << std::endl;
+    });
+
+    cout << "Recognized " << summary.Files - summary.Failed << " of " << summary.Files << " files, "
+         << summary.AudioSeconds << "s of audio in " << summary.WallSeconds << "s: "
+         << summary.Throughput() << " audio seconds per second." << std::endl;
+}
+
+// Speech recognition of a series of short commands using microphone, with a recognizer whose connection is opened
+// before the first command.
+void SpeechRecognitionWithMicrophoneFromWarmPool()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    // The pool creates the recognizers using microphone as audio input, and opens their connections ahead of the
+    // commands. A recognizer that fails is replaced by a new one for the next command.
+    RecognizerPool<SpeechRecognizer> pool([config]() { return SpeechRecognizer::FromConfig(config); }, 1);
+    pool.Prewarm(1);
+    pool.WaitUntilConnected(std::chrono::seconds(10));
+
+    for (;;)
+    {
+        cout << "Say a command, or nothing to stop...\n";
+
+        auto recognizer = pool.Acquire();
+        auto result = recognizer->RecognizeOnceAsync().get();
+
+        if (result->Reason == ResultReason::RecognizedSpeech)
+        {
+            cout << "RECOGNIZED: Text=" << result->Text << std::endl;
+        }
+        else if (result->Reason == ResultReason::NoMatch)
+        {
+            cout << "NOMATCH: Speech could not be recognized." << std::endl;
+            break;
+        }
+        else if (result->Reason == ResultReason::Canceled)
+        {
+            auto cancellation = CancellationDetails::FromResult(result);
+            cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+            if (cancellation->Reason == CancellationReason::Error)
+            {
+                cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                cout << "CANCELED: ErrorDetails=" << cancellation->ErrorDetails << std::endl;
+                cout << "CANCELED: Did you update the subscription info?" << std::endl;
+                recognizer.MarkBroken();
+                break;
+            }
+        }
+    }
+
+    cout << "Pool: " << pool.GetStatistics().ToString() << "." << std::endl;
+}
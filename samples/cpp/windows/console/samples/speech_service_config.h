@@ -0,0 +1,46 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <speechapi_cxx.h>
+
+// The value of an environment variable, or an empty string if it is not set.
+inline std::string ReadEnvironmentVariable(const char* name)
+{
+#ifdef _WIN32
+    char* buffer = nullptr;
+    size_t size = 0;
+    std::string value;
+    if (_dupenv_s(&buffer, &size, name) == 0 && buffer != nullptr)
+    {
+        value = buffer;
+    }
+    free(buffer);
+    return value;
+#else
+    auto value = std::getenv(name);
+    return value != nullptr ? value : "";
+#endif
+}
+
+// Creates a speech config for the subscription key and service region, like SpeechConfig::FromSubscription().
+// If the environment variable SPEECH_SERVICE_HOST is set, e.g. to ws://localhost:8080, the config connects to that
+// host instead, e.g. a container or the mock speech service in samples/cpp/mock-speech-service, which lets the
+// benchmarks run offline.
+inline std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechConfig> SpeechConfigFromSubscriptionOrHost(
+    const std::string& subscriptionKey, const std::string& region)
+{
+    using Microsoft::CognitiveServices::Speech::SpeechConfig;
+
+    auto host = ReadEnvironmentVariable("SPEECH_SERVICE_HOST");
+    if (!host.empty())
+    {
+        return SpeechConfig::FromHost(host, subscriptionKey);
+    }
+    return SpeechConfig::FromSubscription(subscriptionKey, region);
+}
@@ -7,6 +7,13 @@
 
 #include <speechapi_cxx.h>
 #include <fstream>
+#include "audio_stream_forwarder.h"
+#include "batch_synthesis_renderer.h"
+#include "chunked_audio_buffer.h"
+#include "speech_service_config.h"
+#include "synthesis_cache.h"
+#include "synthesis_latency_tracker.h"
+#include "word_boundary_index.h"
 
 using namespace std;
 using namespace Microsoft::CognitiveServices::Speech;
@@ -265,11 +272,18 @@ void SpeechSynthesisToMp3File()
     // https://docs.microsoft.com/azure/cognitive-services/speech-service/rest-text-to-speech#audio-outputs
     config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Audio16Khz32KBitRateMonoMp3);
 
-    // Creates a speech synthesizer using file as audio output.
+    // Caches the audio of every text, so that a repeated text is not synthesized by the service again:
+    // up to 16 MB of the most recently used audio in memory, and all audio on disk in the "synthesis_cache"
+    // directory, where it is kept across runs. The key includes the voice, language and output format.
+    SynthesisCache cache(16 * 1024 * 1024, "synthesis_cache");
+
+    // Creates a speech synthesizer that synthesizes through the cache.
+    CachingSpeechSynthesizer synthesizer(config, cache);
+
+    // Writes the audio of all texts to one mp3 file.
     // Replace with your own audio file name.
     auto fileName = "outputaudio.mp3";
-    auto fileOutput = AudioConfig::FromWavFileOutput(fileName);
-    auto synthesizer = SpeechSynthesizer::FromConfig(config, fileOutput);
+    ofstream file(fileName, ios::binary);
 
     while (true)
     {
@@ -283,16 +297,19 @@ void SpeechSynthesisToMp3File()
             break;
         }
 
-        auto result = synthesizer->SpeakTextAsync(text).get();
+        auto cached = synthesizer.SpeakText(text);
 
         // Checks result.
-        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        if (cached.Audio)
         {
-            cout << "Speech synthesized for text [" << text << "], and the audio was saved to [" << fileName << "]" << std::endl;
+            file.write(reinterpret_cast<const char*>(cached.Audio->Data()), cached.Audio->Size());
+            file.flush();
+            cout << (cached.FromCache ? "Speech taken from the cache" : "Speech synthesized") << " for text [" << text
+                 << "], and the audio was saved to [" << fileName << "]" << std::endl;
         }
-        else if (result->Reason == ResultReason::Canceled)
+        else if (cached.SynthesisResult->Reason == ResultReason::Canceled)
         {
-            auto cancellation = SpeechSynthesisCancellationDetails::FromResult(result);
+            auto cancellation = SpeechSynthesisCancellationDetails::FromResult(cached.SynthesisResult);
             cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
 
             if (cancellation->Reason == CancellationReason::Error)
@@ -303,6 +320,11 @@ void SpeechSynthesisToMp3File()
             }
         }
     }
+
+    auto statistics = cache.GetStatistics();
+    cout << "Cache: " << statistics.MemoryHits << " memory hits and " << statistics.DiskHits << " disk hits of "
+         << statistics.Lookups << " lookups (hit rate " << statistics.HitRate() * 100 << "%), "
+         << statistics.BytesSaved << " bytes not synthesized again." << endl;
 }
 
 // Speech synthesis to pull audio output stream.
@@ -315,10 +337,24 @@ void SpeechSynthesisToPullAudioOutputStream()
     // Creates an audio out stream.
     auto stream = AudioOutputStream::CreatePullStream();
 
+    // Reads(pulls) data from the stream on a separate thread while the synthesizer writes to it, and forwards every
+    // chunk to a file as soon as it arrives. A named pipe or socket works the same way, e.g. to play the audio
+    // while the rest of it is still being synthesized.
+    // Declared before the synthesizer, so that the synthesizer is destroyed first and closes the stream.
+    auto fileName = "outputaudio_pull.pcm";
+    ofstream output(fileName, ios::binary);
+    AudioStreamForwarder forwarder;
+
     // Creates a speech synthesizer using audio stream output.
     auto streamConfig = AudioConfig::FromStreamOutput(stream);
     auto synthesizer = SpeechSynthesizer::FromConfig(config, streamConfig);
 
+    // Starts forwarding only once the synthesizer exists: if creating it throws, no thread is left blocked in
+    // Read() on a stream that nobody closes.
+    forwarder.Start(
+        [stream](uint8_t* buffer, uint32_t size) { return stream->Read(buffer, size); },
+        AudioStreamForwarder::StreamSink(output));
+
     while (true)
     {
         // Receives a text from console input and synthesize it to pull audio output stream.
@@ -331,12 +367,20 @@ void SpeechSynthesisToPullAudioOutputStream()
             break;
         }
 
+        auto start = chrono::steady_clock::now();
+        forwarder.BeginRequest();
         auto result = synthesizer->SpeakTextAsync(text).get();
+        auto completed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
 
         // Checks result.
         if (result->Reason == ResultReason::SynthesizingAudioCompleted)
         {
             cout << "Speech synthesized for text [" << text << "], and the audio was written to output stream." << std::endl;
+
+            // The first audio reached the file long before the synthesis completed, which is when reading would
+            // start otherwise.
+            cout << "First audio forwarded after " << forwarder.CurrentRequest().FirstChunk.count() << " ms, synthesis completed after "
+                 << completed.count() << " ms." << endl;
         }
         else if (result->Reason == ResultReason::Canceled)
         {
@@ -352,21 +396,11 @@ void SpeechSynthesisToPullAudioOutputStream()
         }
     }
 
-    // Destroys the synthesizer so that the while statement below won't infinitely wait for data from the stream.
+    // Destroys the synthesizer, which closes the stream, so that the forwarder reaches the end of it.
     synthesizer = nullptr;
+    forwarder.Join();
 
-    // Reads(pulls) data from the stream
-    uint8_t buffer[32000];
-    uint32_t totalSize = 0;
-    uint32_t filledSize = 0;
-
-    while ((filledSize = stream->Read(buffer, sizeof(buffer))) > 0)
-    {
-        cout << filledSize << " bytes received." << endl;
-        totalSize += filledSize;
-    }
-
-    cout << "Totally " << totalSize << " bytes received." << endl;
+    cout << "The audio was saved to [" << fileName << "]" << endl;
 }
 
 // Speech synthesis to push audio output stream.
@@ -374,14 +408,15 @@ void SpeechSynthesisToPushAudioOutputStream()
 {
     // First, defines push audio output stream callback class that implements the
     // PushAudioOutputStreamCallback interface. The sample here illustrates how to define such
-    // a callback that writes audio data to a byte vector.
+    // a callback that collects the audio data in memory.
     // PushAudioOutputStreamSampleCallback implements PushAudioOutputStreamCallback interface
     class PushAudioOutputStreamSampleCallback : public PushAudioOutputStreamCallback
     {
     public:
-        PushAudioOutputStreamSampleCallback()
+        explicit PushAudioOutputStreamSampleCallback(SynthesisLatencyTracker& latency)
+            : m_latency(latency)
         {
-            m_audioData = std::make_shared<std::vector<uint8_t>>();
+            m_audioData = std::make_shared<ChunkedAudioBuffer>();
         }
 
         /// <summary>
@@ -392,9 +427,10 @@ void SpeechSynthesisToPushAudioOutputStream()
         /// <returns>Tell synthesizer how many bytes are received.</returns>
         int Write(uint8_t* dataBuffer, uint32_t size) override
         {
-            auto oldSize = m_audioData->size();
-            m_audioData->resize(oldSize + size);
-            memcpy(m_audioData->data() + oldSize, dataBuffer, size);
+            m_latency.OnWrite();
+
+            // Appends to pooled blocks, so that the audio received so far is never copied again, however long it gets.
+            m_audioData->Append(dataBuffer, size);
 
             cout << size << " bytes received." << endl;
 
@@ -415,28 +451,34 @@ void SpeechSynthesisToPushAudioOutputStream()
         /// <returns>The received audio data size</returns>
         size_t GetAudioSize()
         {
-            return m_audioData->size();
+            return m_audioData->Size();
         }
 
         /// <summary>
         /// Gets the received audio data
         /// </summary>
-        /// <returns>The received audio data in byte vector</returns>
-        std::shared_ptr<std::vector<uint8_t>> GetAudioData()
+        /// <returns>The received audio data as a list of segments</returns>
+        std::shared_ptr<ChunkedAudioBuffer> GetAudioData()
         {
             return m_audioData;
         }
 
     private:
-        std::shared_ptr<std::vector<uint8_t>> m_audioData;
+        SynthesisLatencyTracker& m_latency;
+        std::shared_ptr<ChunkedAudioBuffer> m_audioData;
     };
 
     // Creates an instance of a speech config with specified subscription key and service region.
     // Replace with your own subscription key and service region (e.g., "westus").
-    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    // Measures the time to the first audio byte, among other stages, of every request.
+    // Declared before the callback and the synthesizer, so that it outlives both.
+    SynthesisLatencyTracker latency;
 
     // Creates an instance of the callback class inherited from PushAudioOutputStreamCallback.
-    auto callback = std::make_shared<PushAudioOutputStreamSampleCallback>();
+    auto callback = std::make_shared<PushAudioOutputStreamSampleCallback>(latency);
 
     // Creates an audio out stream from the callback.
     auto stream = AudioOutputStream::CreatePushStream(callback);
@@ -444,6 +486,7 @@ void SpeechSynthesisToPushAudioOutputStream()
     // Creates a speech synthesizer using audio stream output.
     auto streamConfig = AudioConfig::FromStreamOutput(stream);
     auto synthesizer = SpeechSynthesizer::FromConfig(config, streamConfig);
+    latency.Attach(*synthesizer);
 
     while (true)
     {
@@ -457,7 +500,9 @@ void SpeechSynthesisToPushAudioOutputStream()
             break;
         }
 
+        latency.BeginRequest();
         auto result = synthesizer->SpeakTextAsync(text).get();
+        cout << "Latency: " << latency.RequestSummary() << endl;
 
         // Checks result.
         if (result->Reason == ResultReason::SynthesizingAudioCompleted)
@@ -479,6 +524,20 @@ void SpeechSynthesisToPushAudioOutputStream()
     }
 
     cout << "Totally " << callback->GetAudioSize() << " bytes received." << endl;
+
+    // Writes the received audio segment by segment, without joining it into one buffer first.
+    // The push stream receives raw 16kHz 16bit mono PCM audio by default.
+    auto audioData = callback->GetAudioData();
+    if (audioData->Size() > 0)
+    {
+        auto fileName = "outputaudio.pcm";
+        ofstream file(fileName, ios::binary);
+        audioData->WriteTo(file);
+        cout << "Audio data in " << audioData->SegmentCount() << " segments was saved to [" << fileName << "]" << endl;
+    }
+
+    // Latency over all requests, in the Prometheus text exposition format.
+    latency.WritePrometheus(cout);
 }
 
 // Gets synthesized audio data from result.
@@ -486,12 +545,18 @@ void SpeechSynthesisToResult()
 {
     // Creates an instance of a speech config with specified subscription key and service region.
     // Replace with your own subscription key and service region (e.g., "westus").
-    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    // Measures the time to the first audio byte, among other stages, of every request.
+    // Declared before the synthesizer, so that it outlives it.
+    SynthesisLatencyTracker latency;
 
     // Creates a speech synthesizer with a null output stream.
     // This means the audio output data will not be written to any stream.
     // You can just get the audio from the result.
     auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
+    latency.Attach(*synthesizer);
 
     while (true)
     {
@@ -505,7 +570,9 @@ void SpeechSynthesisToResult()
             break;
         }
 
+        latency.BeginRequest();
         auto result = synthesizer->SpeakTextAsync(text).get();
+        cout << "Latency: " << latency.RequestSummary() << endl;
 
         // Checks result.
         if (result->Reason == ResultReason::SynthesizingAudioCompleted)
@@ -527,6 +594,9 @@ void SpeechSynthesisToResult()
             }
         }
     }
+
+    // Latency over all requests, in the Prometheus text exposition format.
+    latency.WritePrometheus(cout);
 }
 
 // Speech synthesis to audio data stream.
@@ -553,35 +623,60 @@ void SpeechSynthesisToAudioDataStream()
             break;
         }
 
-        auto result = synthesizer->SpeakTextAsync(text).get();
+        // StartSpeakingTextAsync() returns as soon as the synthesis started, instead of when it completed, so that
+        // the audio can be read from the audio data stream while the rest of it is still being synthesized.
+        // Both the first audio and the completion are measured from the request.
+        AudioStreamForwarder forwarder;
+        auto start = chrono::steady_clock::now();
+        forwarder.BeginRequest();
+        auto result = synthesizer->StartSpeakingTextAsync(text).get();
 
         // Checks result.
-        if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+        if (result->Reason == ResultReason::SynthesizingAudioStarted)
         {
-            cout << "Speech synthesized for text [" << text << "]" << std::endl;
             auto audioDataStream = AudioDataStream::FromResult(result);
 
-            // You can save all the data in the audio data stream to a file
+            // Forwards every chunk to a file as soon as it was synthesized; ReadData() waits for more audio until
+            // the synthesis completed. A named pipe or socket works the same way, e.g. to play the audio.
+            auto pcmFileName = "outputaudio.pcm";
+            ofstream output(pcmFileName, ios::binary);
+            forwarder.Start(
+                [audioDataStream](uint8_t* buffer, uint32_t size) { return audioDataStream->ReadData(buffer, size); },
+                AudioStreamForwarder::StreamSink(output));
+            forwarder.Join();
+            auto completed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+
+            // The stream ends early if the synthesis was canceled after it started.
+            if (audioDataStream->GetStatus() == StreamStatus::Canceled)
+            {
+                auto cancellation = SpeechSynthesisCancellationDetails::FromStream(audioDataStream);
+                cout << "CANCELED: Reason=" << (int)cancellation->Reason << std::endl;
+
+                if (cancellation->Reason == CancellationReason::Error)
+                {
+                    cout << "CANCELED: ErrorCode=" << (int)cancellation->ErrorCode << std::endl;
+                    cout << "CANCELED: ErrorDetails=[" << cancellation->ErrorDetails << "]" << std::endl;
+                    cout << "CANCELED: Did you update the subscription info?" << std::endl;
+                }
+                continue;
+            }
+
+            auto forwarded = forwarder.CurrentRequest();
+            cout << "Speech synthesized for text [" << text << "]" << std::endl;
+            cout << forwarded.Bytes << " bytes in " << forwarded.Chunks << " chunks were forwarded to [" << pcmFileName << "]" << endl;
+
+            // The first audio reached the file long before the synthesis completed, which is when SpeakTextAsync()
+            // returns and reading would start otherwise.
+            cout << "First audio forwarded after " << forwarded.FirstChunk.count() << " ms, synthesis completed after "
+                 << completed.count() << " ms." << endl;
+
+            // You can still save all the data in the audio data stream to a file
+            // Reset the stream position to the beginnging since reading puts the postion to end.
+            audioDataStream->SetPosition(0);
             stringstream fileName;
             fileName << "outputaudio.wav";
             audioDataStream->SaveToWavFile(fileName.str());
             cout << "Audio data for text [" << text << "] was saved to [" << fileName.str() << "]" << endl;
-
-            // You can also read data from audio data stream and process it in memory
-            // Reset the stream position to the beginnging since saving to file puts the postion to end.
-            audioDataStream->SetPosition(0);
-
-            uint8_t buffer[16000];
-            uint32_t totalSize = 0;
-            uint32_t filledSize = 0;
-
-            while ((filledSize = audioDataStream->ReadData(buffer, sizeof(buffer))) > 0)
-            {
-                cout << filledSize << " bytes received." << endl;
-                totalSize += filledSize;
-            }
-
-            cout << "Totally " << totalSize << " bytes received for text [" << text << "]" << endl;
         }
         else if (result->Reason == ResultReason::Canceled)
         {
@@ -603,12 +698,18 @@ void SpeechSynthesisEvents()
 {
     // Creates an instance of a speech config with specified subscription key and service region.
     // Replace with your own subscription key and service region (e.g., "westus").
-    auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    // Measures the time to the first audio byte, among other stages, of every request.
+    // Declared before the synthesizer, so that it outlives it.
+    SynthesisLatencyTracker latency;
 
     // Creates a speech synthesizer with a null output stream.
     // This means the audio output data will not be written to any stream.
     // You can just get the audio from the result.
     auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
+    latency.Attach(*synthesizer);
 
     // Subscribes to events
     synthesizer->SynthesisStarted += [](const SpeechSynthesisEventArgs& e)
@@ -640,7 +741,9 @@ void SpeechSynthesisEvents()
             break;
         }
 
+        latency.BeginRequest();
         auto result = synthesizer->SpeakTextAsync(text).get();
+        cout << "Latency: " << latency.RequestSummary() << endl;
 
         // Checks result.
         if (result->Reason == ResultReason::SynthesizingAudioCompleted)
@@ -662,6 +765,9 @@ void SpeechSynthesisEvents()
             }
         }
     }
+
+    // Latency over all requests, in the Prometheus text exposition format.
+    latency.WritePrometheus(cout);
 }
 
 // Speech synthesis word boundary event.
@@ -671,14 +777,24 @@ void SpeechSynthesisWordBoundaryEvent()
     // Replace with your own subscription key and service region (e.g., "westus").
     auto config = SpeechConfig::FromSubscription("YourSubscriptionKey", "YourServiceRegion");
 
+    // Uses raw PCM audio, so that a word boundary maps directly to a byte position in the audio.
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm);
+
+    // Collects the word boundaries of each request into an index, to seek to any word of the audio.
+    // 16 kHz 16 bit mono PCM audio has 32000 bytes per second and 2 bytes per frame.
+    // Declared before the synthesizer, so that it outlives it.
+    WordBoundaryIndex index(32000, 2);
+
     // Creates a speech synthesizer with a null output stream.
     // This means the audio output data will not be written to any stream.
     // You can just get the audio from the result.
     auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
 
     // Subscribes to word boundary event
-    synthesizer->WordBoundary += [](const SpeechSynthesisWordBoundaryEventArgs& e)
+    synthesizer->WordBoundary += [&index](const SpeechSynthesisWordBoundaryEventArgs& e)
     {
+        index.Add(e.AudioOffset, e.TextOffset, e.WordLength);
+
         cout << "Word boundary event received. "
             // The unit of e.AudioOffset is tick (1 tick = 100 nanoseconds), divide by 10,000 to convert to milliseconds.
             << "Audio offset: " << (e.AudioOffset + 5000) / 10000 << "ms, "
@@ -699,6 +815,7 @@ void SpeechSynthesisWordBoundaryEvent()
             break;
         }
 
+        index.Clear();
         auto result = synthesizer->SpeakTextAsync(text).get();
 
         // Checks result.
@@ -707,6 +824,31 @@ void SpeechSynthesisWordBoundaryEvent()
             cout << "Speech synthesized for text [" << text << "]" << std::endl;
             auto audioData = result->GetAudioData();
             cout << audioData->size() << " bytes of audio data received for text [" << text << "]" << endl;
+
+            // Stores the index next to the audio.
+            auto audioFileName = "outputaudio.pcm";
+            auto indexFileName = "outputaudio.pcm.words";
+            ofstream(audioFileName, ios::binary).write(reinterpret_cast<const char*>(audioData->data()), audioData->size());
+            index.Seal(static_cast<uint32_t>(audioData->size()));
+            index.Save(indexFileName);
+            cout << "Audio and " << index.Size() << " word boundaries were saved to [" << audioFileName << "] and [" << indexFileName << "]" << endl;
+
+            // A player loads the index and reads only the bytes of the word it seeks to, here the middle word.
+            auto loadedIndex = WordBoundaryIndex::Load(indexFileName);
+            if (loadedIndex->Size() > 0)
+            {
+                auto wordIndex = loadedIndex->FindByTextOffset((*loadedIndex)[loadedIndex->Size() / 2].TextOffset);
+                const auto& word = (*loadedIndex)[wordIndex];
+                auto range = loadedIndex->BytesOf(wordIndex);
+
+                auto audioDataStream = AudioDataStream::FromResult(result);
+                audioDataStream->SetPosition(range.Begin);
+                vector<uint8_t> wordAudio(range.End - range.Begin);
+                auto read = audioDataStream->ReadData(wordAudio.data(), static_cast<uint32_t>(wordAudio.size()));
+
+                cout << "Word [" << text.substr(word.TextOffset, word.WordLength) << "] at " << (word.AudioOffset + 5000) / 10000 << "ms: "
+                     << read << " bytes read from position " << range.Begin << "." << endl;
+            }
         }
         else if (result->Reason == ResultReason::Canceled)
         {
@@ -765,3 +907,36 @@ void SpeechSynthesisWithSourceLanguageAutoDetection()
         }
     }
 }
+
+// Batch speech synthesis of the prompts of a manifest to wave files, on a pool of synthesizers.
+void SpeechSynthesisBatchFromManifest()
+{
+    // Creates an instance of a speech config with specified subscription key and service region.
+    // Replace with your own subscription key and service region (e.g., "westus").
+    // Set SPEECH_SERVICE_HOST (e.g., "ws://localhost:8080") to run against a local mock service instead.
+    auto config = SpeechConfigFromSubscriptionOrHost("YourSubscriptionKey", "YourServiceRegion");
+
+    // Reads the prompts to render, one per line: output file name, voice name and text or SSML, separated by tabs.
+    // Replace with your own manifest file name.
+    auto prompts = BatchSynthesisRenderer::ReadManifest("synthesis_manifest.txt");
+
+    // Uses one synthesizer per worker. The synthesizers are warmed up in parallel before the first prompt.
+    const size_t workerCount = 8;
+    BatchSynthesisRenderer renderer(config, workerCount);
+    cout << "Rendering " << prompts.size() << " prompts with " << renderer.WorkerCount() << " synthesizers." << std::endl;
+
+    // Results are printed in manifest order.
+    auto summary = renderer.Run(prompts, [](const PromptRenderResult& result)
+    {
+        if (!result.Error.empty())
+        {
+            cout << "PROMPT " << result.Index << ": CANCELED: " << result.Error << std::endl;
+            return;
+        }
+        cout << "PROMPT " << result.Index << ": " << result.AudioBytes << " bytes saved to [" << result.OutputFile << "] in " << result.WallSeconds << "s" << std::endl;
+    });
+
+    cout << "Rendered " << summary.Prompts - summary.Failed << " of " << summary.Prompts << " prompts, "
+         << summary.AudioBytes << " bytes of audio in " << summary.WallSeconds << "s: "
+         << summary.PromptsPerSecond() << " prompts per second." << std::endl;
+}
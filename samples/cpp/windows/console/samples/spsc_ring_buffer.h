@@ -0,0 +1,191 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Lock-free byte ring buffer for exactly one producer thread and one consumer thread.
+//
+// The producer only writes m_head and the consumer only writes m_tail; each side reads the other's index
+// with acquire semantics and publishes its own with release semantics, so no locks are needed. Both
+// indices grow monotonically and are masked into the buffer, which is why the capacity is a power of two.
+// The indices live on separate cache lines, so that the two threads do not invalidate each other's line
+// on every update.
+//
+// The buffer never blocks; callers decide how to wait. It counts how often the producer found it full
+// (overruns) and the consumer found it empty before the end of the stream (underruns), and records the
+// highest fill level seen by the producer.
+class SpscRingBuffer final
+{
+public:
+    // capacity is rounded up to the next power of two.
+    explicit SpscRingBuffer(size_t capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("Ring buffer capacity must be greater than 0.");
+        }
+        size_t rounded = 1;
+        while (rounded < capacity)
+        {
+            rounded <<= 1;
+        }
+        m_storage.resize(rounded);
+        m_data = m_storage.data();
+        m_mask = rounded - 1;
+    }
+
+    // Uses caller-provided memory, e.g. a pooled buffer, which must outlive the ring.
+    // capacity must be a power of two.
+    SpscRingBuffer(uint8_t* storage, size_t capacity)
+        : m_data(storage), m_mask(capacity - 1)
+    {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+        {
+            throw std::invalid_argument("Ring buffer capacity must be a power of two.");
+        }
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t Capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    // Producer: copies as many bytes as fit, and returns the number of bytes copied.
+    size_t Write(const uint8_t* data, size_t size)
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        auto tail = m_tail.load(std::memory_order_acquire);
+        auto used = head - tail;
+        auto count = (std::min)(size, Capacity() - used);
+
+        // Counts the start of every period in which the producer is held up, not every retry.
+        if (count < size && !m_producerBlocked)
+        {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_producerBlocked = count < size;
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        // The free space may wrap around the end of the buffer.
+        auto offset = head & m_mask;
+        auto first = (std::min)(count, Capacity() - offset);
+        memcpy(m_data + offset, data, first);
+        memcpy(m_data, data + first, count - first);
+
+        m_head.store(head + count, std::memory_order_release);
+
+        auto fill = used + count;
+        if (fill > m_highWaterMark.load(std::memory_order_relaxed))
+        {
+            m_highWaterMark.store(fill, std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    // Producer: marks the end of the stream. No more data is written afterwards.
+    void Close()
+    {
+        m_closed.store(true, std::memory_order_release);
+    }
+
+    // Consumer: returns the largest contiguous readable block, without copying it. The block stays valid
+    // until it is released with Consume(). Returns 0 if the buffer is empty.
+    size_t Peek(const uint8_t*& data)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto head = m_head.load(std::memory_order_acquire);
+        auto available = head - tail;
+        if (available == 0)
+        {
+            // An empty buffer after Close() is drained, not starved.
+            if (!m_consumerStarved && !m_closed.load(std::memory_order_acquire))
+            {
+                m_underruns.fetch_add(1, std::memory_order_relaxed);
+                m_consumerStarved = true;
+            }
+            return 0;
+        }
+        m_consumerStarved = false;
+
+        auto offset = tail & m_mask;
+        data = m_data + offset;
+        return (std::min)(available, Capacity() - offset);
+    }
+
+    // Consumer: releases bytes returned by Peek() to the producer.
+    void Consume(size_t size)
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+    // Consumer: copies up to size bytes, and returns the number of bytes copied.
+    size_t Read(uint8_t* data, size_t size)
+    {
+        size_t copied = 0;
+        while (copied < size)
+        {
+            const uint8_t* block;
+            auto available = Peek(block);
+            if (available == 0)
+            {
+                break;
+            }
+            auto count = (std::min)(available, size - copied);
+            memcpy(data + copied, block, count);
+            Consume(count);
+            copied += count;
+        }
+        return copied;
+    }
+
+    // Consumer: true once the producer has closed the stream and all data has been consumed.
+    bool IsDrained() const
+    {
+        // Checks closed first: data written before Close() is visible once the flag is.
+        return m_closed.load(std::memory_order_acquire) &&
+            m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed);
+    }
+
+    // The highest number of bytes that were buffered at the same time.
+    size_t HighWaterMark() const { return m_highWaterMark.load(std::memory_order_relaxed); }
+
+    // The number of times a write did not fit completely, i.e. the producer had to wait for the consumer.
+    // Retries of the same write are not counted again.
+    uint64_t Overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+
+    // The number of times the consumer found no data before the end of the stream, i.e. had to wait for the producer.
+    // Repeated empty reads are not counted again until data has arrived.
+    uint64_t Underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t cacheLineSize = 64;
+
+    std::vector<uint8_t> m_storage;
+    uint8_t* m_data;
+    size_t m_mask;
+
+    alignas(cacheLineSize) std::atomic<size_t> m_head{ 0 };
+    std::atomic<size_t> m_highWaterMark{ 0 };
+    std::atomic<uint64_t> m_overruns{ 0 };
+    bool m_producerBlocked = false;
+
+    alignas(cacheLineSize) std::atomic<size_t> m_tail{ 0 };
+    std::atomic<uint64_t> m_underruns{ 0 };
+    bool m_consumerStarved = false;
+
+    alignas(cacheLineSize) std::atomic<bool> m_closed{ false };
+};
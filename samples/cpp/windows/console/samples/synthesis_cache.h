@@ -0,0 +1,385 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <speechapi_cxx.h>
+#include "memory_mapped_file.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Everything that determines the synthesized audio of a request.
+struct SynthesisCacheKey
+{
+    std::string Input;
+    bool IsSsml = false;
+    std::string Voice;
+    std::string Language;
+    std::string OutputFormat;
+
+    // All fields, length-prefixed so that different keys can never serialize to the same string.
+    std::string Serialize() const
+    {
+        std::string serialized;
+        for (const auto* field : { &Input, &Voice, &Language, &OutputFormat })
+        {
+            serialized += std::to_string(field->size()) + ":" + *field;
+        }
+        serialized += IsSsml ? "s" : "t";
+        return serialized;
+    }
+
+    // FNV-1a hash of the serialized key, as 16 hex digits.
+    static std::string Hash(const std::string& serialized)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (auto c : serialized)
+        {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+        }
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        return hex;
+    }
+};
+
+// Synthesized audio, either held in memory or read from a mapped cache file. A mapped file stays mapped as long as
+// its audio is referenced, so that a disk hit does not copy the audio.
+class CachedAudio final
+{
+public:
+    explicit CachedAudio(std::shared_ptr<const std::vector<uint8_t>> bytes)
+        : m_data(bytes->data()), m_size(bytes->size()), m_bytes(std::move(bytes))
+    {
+    }
+
+    CachedAudio(std::shared_ptr<const MemoryMappedFile> file, const uint8_t* data, size_t size)
+        : m_data(data), m_size(size), m_file(std::move(file))
+    {
+    }
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    std::shared_ptr<const std::vector<uint8_t>> m_bytes;
+    std::shared_ptr<const MemoryMappedFile> m_file;
+};
+
+// Caches synthesized audio by the key of its request: in memory for the most recently used prompts, bounded by
+// bytes, and optionally on disk for all prompts, so that repeated prompts never go to the service again.
+//
+// Disk entries are named by the hash of the key and store the full key next to the audio. A lookup maps the file
+// and compares the key, so that a hash collision is a miss instead of the audio of another prompt. Writing to the
+// disk store is best-effort: a failed write is counted and logged, and the audio is still cached in memory.
+// Thread-safe.
+class SynthesisCache final
+{
+public:
+    struct Statistics
+    {
+        uint64_t Lookups = 0;
+        uint64_t MemoryHits = 0;
+        uint64_t DiskHits = 0;
+
+        // Audio bytes served from the cache instead of the service.
+        uint64_t BytesSaved = 0;
+
+        // Entries that could not be written to the disk store.
+        uint64_t WriteFailures = 0;
+
+        double HitRate() const
+        {
+            return Lookups > 0 ? static_cast<double>(MemoryHits + DiskHits) / Lookups : 0;
+        }
+    };
+
+    using Audio = std::shared_ptr<const CachedAudio>;
+
+    // memoryCapacity is the limit of the audio bytes held in memory. An empty directory disables the disk store;
+    // otherwise the directory is created if it does not exist (its parent must exist).
+    explicit SynthesisCache(size_t memoryCapacity, const std::string& directory = std::string())
+        : m_memoryCapacity(memoryCapacity), m_directory(directory)
+    {
+        if (m_directory.empty())
+        {
+            return;
+        }
+        // Fails harmlessly if the directory exists.
+#ifdef _WIN32
+        _mkdir(m_directory.c_str());
+#else
+        mkdir(m_directory.c_str(), 0755);
+#endif
+        if (m_directory.back() != '/' && m_directory.back() != '\\')
+        {
+            m_directory += '/';
+        }
+    }
+
+    SynthesisCache(const SynthesisCache&) = delete;
+    SynthesisCache& operator=(const SynthesisCache&) = delete;
+
+    // Returns the cached audio of the key, or null.
+    Audio Find(const SynthesisCacheKey& key)
+    {
+        auto serialized = key.Serialize();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_statistics.Lookups++;
+            auto entry = m_entries.find(serialized);
+            if (entry != m_entries.end())
+            {
+                // Moves the entry to the front of the LRU list.
+                m_lru.splice(m_lru.begin(), m_lru, entry->second);
+                m_statistics.MemoryHits++;
+                m_statistics.BytesSaved += entry->second->Data->Size();
+                return entry->second->Data;
+            }
+        }
+
+        auto audio = ReadFromDisk(serialized);
+        if (audio)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_statistics.DiskHits++;
+            m_statistics.BytesSaved += audio->Size();
+            AddToMemory(serialized, audio);
+        }
+        return audio;
+    }
+
+    void Add(const SynthesisCacheKey& key, Audio audio)
+    {
+        auto serialized = key.Serialize();
+        std::string error;
+        auto written = WriteToDisk(serialized, *audio, error);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!written)
+        {
+            m_statistics.WriteFailures++;
+            std::cerr << "Synthesis cache: " << error << std::endl;
+        }
+        AddToMemory(serialized, audio);
+    }
+
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_statistics;
+    }
+
+    // Audio bytes currently held in memory.
+    size_t MemoryBytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memoryBytes;
+    }
+
+private:
+    struct Entry
+    {
+        std::string Key;
+        Audio Data;
+    };
+
+    // Disk entry layout: magic, key size (4 bytes, little endian), key, audio.
+    static constexpr const char* Magic() { return "TTSC"; }
+    static const size_t HeaderSize = 8;
+
+    void AddToMemory(const std::string& serialized, const Audio& audio)
+    {
+        if (audio->Size() > m_memoryCapacity)
+        {
+            return;
+        }
+        auto existing = m_entries.find(serialized);
+        if (existing != m_entries.end())
+        {
+            m_memoryBytes -= existing->second->Data->Size();
+            m_lru.erase(existing->second);
+            m_entries.erase(existing);
+        }
+
+        m_lru.push_front(Entry{ serialized, audio });
+        m_entries[serialized] = m_lru.begin();
+        m_memoryBytes += audio->Size();
+
+        // Evicts the least recently used entries.
+        while (m_memoryBytes > m_memoryCapacity)
+        {
+            m_memoryBytes -= m_lru.back().Data->Size();
+            m_entries.erase(m_lru.back().Key);
+            m_lru.pop_back();
+        }
+    }
+
+    std::string FileName(const std::string& serialized) const
+    {
+        return m_directory + SynthesisCacheKey::Hash(serialized) + ".tts";
+    }
+
+    Audio ReadFromDisk(const std::string& serialized) const
+    {
+        if (m_directory.empty())
+        {
+            return nullptr;
+        }
+
+        auto file = std::make_shared<MemoryMappedFile>();
+        if (!file->Open(FileName(serialized)) || file->Size() < HeaderSize || memcmp(file->Data(), Magic(), 4) != 0)
+        {
+            return nullptr;
+        }
+        auto data = file->Data();
+        auto keySize = static_cast<size_t>(data[4]) | static_cast<size_t>(data[5]) << 8 | static_cast<size_t>(data[6]) << 16 | static_cast<size_t>(data[7]) << 24;
+        if (keySize != serialized.size() || file->Size() - HeaderSize < keySize ||
+            memcmp(data + HeaderSize, serialized.data(), keySize) != 0)
+        {
+            return nullptr;
+        }
+
+        // The audio stays in the mapping, which lives as long as the returned audio.
+        auto audioSize = static_cast<size_t>(file->Size()) - HeaderSize - keySize;
+        return std::make_shared<const CachedAudio>(file, data + HeaderSize + keySize, audioSize);
+    }
+
+    // Returns false with a description of the error if the entry could not be written.
+    bool WriteToDisk(const std::string& serialized, const CachedAudio& audio, std::string& error) const
+    {
+        if (m_directory.empty())
+        {
+            return true;
+        }
+
+        // Writes a temporary file first and renames it, so that a concurrent or interrupted write never leaves
+        // a truncated entry behind.
+        auto fileName = FileName(serialized);
+        auto temporaryFileName = fileName + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream file(temporaryFileName, std::ios::binary);
+            uint8_t header[HeaderSize] = { 'T', 'T', 'S', 'C',
+                static_cast<uint8_t>(serialized.size()), static_cast<uint8_t>(serialized.size() >> 8),
+                static_cast<uint8_t>(serialized.size() >> 16), static_cast<uint8_t>(serialized.size() >> 24) };
+            file.write(reinterpret_cast<const char*>(header), HeaderSize);
+            file.write(serialized.data(), serialized.size());
+            file.write(reinterpret_cast<const char*>(audio.Data()), audio.Size());
+            if (!file)
+            {
+                file.close();
+                std::remove(temporaryFileName.c_str());
+                error = "Failed to write the cache file " + temporaryFileName;
+                return false;
+            }
+        }
+        // rename() does not replace an existing file on Windows; the entry is the same either way.
+        std::remove(fileName.c_str());
+        if (std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+        {
+            std::remove(temporaryFileName.c_str());
+        }
+        return true;
+    }
+
+    size_t m_memoryCapacity;
+    std::string m_directory;
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_entries;
+    size_t m_memoryBytes = 0;
+    Statistics m_statistics;
+};
+
+// Synthesizes through a SynthesisCache: repeated requests are served from the cache without a round trip to the
+// service. The synthesizer writes no audio output; the audio of every request, cached or not, is returned as the
+// bytes that SpeechSynthesisResult::GetAudioData() and AudioDataStream would provide.
+class CachingSpeechSynthesizer final
+{
+public:
+    struct Result
+    {
+        // The audio, or null if the synthesis was canceled.
+        SynthesisCache::Audio Audio;
+        bool FromCache = false;
+
+        // The result of the service; null for cache hits.
+        std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesisResult> SynthesisResult;
+    };
+
+    CachingSpeechSynthesizer(std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechConfig> config, SynthesisCache& cache)
+        : m_synthesizer(Microsoft::CognitiveServices::Speech::SpeechSynthesizer::FromConfig(config, nullptr)),
+          m_voice(config->GetSpeechSynthesisVoiceName()),
+          m_language(config->GetSpeechSynthesisLanguage()),
+          m_outputFormat(config->GetSpeechSynthesisOutputFormat()),
+          m_cache(cache)
+    {
+    }
+
+    Result SpeakText(const std::string& text)
+    {
+        return Speak(text, false);
+    }
+
+    Result SpeakSsml(const std::string& ssml)
+    {
+        return Speak(ssml, true);
+    }
+
+private:
+    Result Speak(const std::string& input, bool isSsml)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        SynthesisCacheKey key;
+        key.Input = input;
+        key.IsSsml = isSsml;
+        key.Voice = m_voice;
+        key.Language = m_language;
+        key.OutputFormat = m_outputFormat;
+
+        Result result;
+        result.Audio = m_cache.Find(key);
+        if (result.Audio)
+        {
+            result.FromCache = true;
+            return result;
+        }
+
+        result.SynthesisResult = (isSsml ? m_synthesizer->SpeakSsmlAsync(input) : m_synthesizer->SpeakTextAsync(input)).get();
+        if (result.SynthesisResult->Reason == ResultReason::SynthesizingAudioCompleted)
+        {
+            result.Audio = std::make_shared<const CachedAudio>(result.SynthesisResult->GetAudioData());
+            m_cache.Add(key, result.Audio);
+        }
+        return result;
+    }
+
+    std::shared_ptr<Microsoft::CognitiveServices::Speech::SpeechSynthesizer> m_synthesizer;
+    std::string m_voice;
+    std::string m_language;
+    std::string m_outputFormat;
+    SynthesisCache& m_cache;
+};
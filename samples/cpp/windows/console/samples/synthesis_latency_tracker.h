@@ -0,0 +1,139 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <speechapi_cxx.h>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include "latency_histogram.h"
+
+// Measures how long a synthesis request takes to reach each stage, from the moment the request is sent:
+//   started:     the SynthesisStarted event.
+//   first chunk: the first Synthesizing event with audio, i.e. the time to the first audio byte.
+//   first write: the first Write() to a push audio output stream, if the synthesizer writes to one.
+//   completed:   the SynthesisCompleted (or SynthesisCanceled) event.
+// Each stage has its own LatencyHistogram over all requests, which can be exported in the Prometheus text format.
+//
+// Tracks one request at a time, like the samples send them; call BeginRequest() right before SpeakTextAsync().
+class SynthesisLatencyTracker final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Subscribes to the events of the synthesizer. The tracker must outlive the synthesizer.
+    void Attach(Microsoft::CognitiveServices::Speech::SpeechSynthesizer& synthesizer)
+    {
+        using namespace Microsoft::CognitiveServices::Speech;
+
+        synthesizer.SynthesisStarted += [this](const SpeechSynthesisEventArgs&)
+        {
+            Mark(m_current.Started, m_started);
+        };
+        synthesizer.Synthesizing += [this](const SpeechSynthesisEventArgs& e)
+        {
+            if (e.Result->GetAudioLength() > 0)
+            {
+                Mark(m_current.FirstChunk, m_firstChunk);
+            }
+        };
+        synthesizer.SynthesisCompleted += [this](const SpeechSynthesisEventArgs&)
+        {
+            Mark(m_current.Completed, m_completed);
+        };
+        synthesizer.SynthesisCanceled += [this](const SpeechSynthesisEventArgs&)
+        {
+            Mark(m_current.Completed, m_completed);
+        };
+    }
+
+    void BeginRequest()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_current = Request();
+        m_current.Start = Clock::now();
+        m_active = true;
+    }
+
+    // Call from PushAudioOutputStreamCallback::Write().
+    void OnWrite()
+    {
+        Mark(m_current.FirstWrite, m_firstWrite);
+    }
+
+    // The stages of the current (or last) request, e.g. "started 85 ms, first chunk 212 ms, completed 630 ms".
+    std::string RequestSummary() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::ostringstream summary;
+        auto append = [&](const char* stage, const Clock::time_point& time)
+        {
+            if (time != Clock::time_point())
+            {
+                summary << (summary.tellp() > 0 ? ", " : "") << stage << " "
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(time - m_current.Start).count() << " ms";
+            }
+        };
+        append("started", m_current.Started);
+        append("first chunk", m_current.FirstChunk);
+        append("first write", m_current.FirstWrite);
+        append("completed", m_current.Completed);
+        return summary.str();
+    }
+
+    // Writes the histograms of all stages that occurred, as Prometheus summaries.
+    void WritePrometheus(std::ostream& out) const
+    {
+        Write(out, m_started, "speech_synthesis_started_seconds", "Time from sending a synthesis request to the SynthesisStarted event.");
+        Write(out, m_firstChunk, "speech_synthesis_first_chunk_seconds", "Time from sending a synthesis request to the first audio chunk.");
+        Write(out, m_firstWrite, "speech_synthesis_first_write_seconds", "Time from sending a synthesis request to the first write to the push audio output stream.");
+        Write(out, m_completed, "speech_synthesis_completed_seconds", "Time from sending a synthesis request to the SynthesisCompleted event.");
+    }
+
+private:
+    struct Request
+    {
+        Clock::time_point Start;
+        Clock::time_point Started;
+        Clock::time_point FirstChunk;
+        Clock::time_point FirstWrite;
+        Clock::time_point Completed;
+    };
+
+    // Records the first occurrence of a stage in the current request.
+    void Mark(Clock::time_point& stage, LatencyHistogram& histogram)
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_active || stage != Clock::time_point())
+        {
+            return;
+        }
+        stage = now;
+        histogram.Add(now - m_current.Start);
+        if (&stage == &m_current.Completed)
+        {
+            m_active = false;
+        }
+    }
+
+    static void Write(std::ostream& out, const LatencyHistogram& histogram, const std::string& name, const std::string& help)
+    {
+        if (histogram.Count() > 0)
+        {
+            histogram.WritePrometheus(out, name, help);
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    Request m_current;
+    bool m_active = false;
+
+    LatencyHistogram m_started;
+    LatencyHistogram m_firstChunk;
+    LatencyHistogram m_firstWrite;
+    LatencyHistogram m_completed;
+};
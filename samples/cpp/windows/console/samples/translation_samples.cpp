@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include <speechapi_cxx.h>
+#include "result_dispatcher.h"
 
 using namespace std;
 using namespace Microsoft::CognitiveServices::Speech;
@@ -90,49 +91,55 @@ void TranslationContinuousRecognition()
     config->AddTargetLanguage("de");
     config->AddTargetLanguage("fr");
 
+    // Prints the results and their translations on a separate thread, so that the event handlers only copy them.
+    // Declared before the recognizer, so that it outlives the event handlers.
+    ResultDispatcher dispatcher(ResultDispatcher::StreamSink(cout), [](const ResultRecord& record, string& out)
+    {
+        switch (record.Event)
+        {
+        case ResultRecord::Kind::Recognizing:
+            out += "Recognizing:" + record.Text + '\n';
+            break;
+        case ResultRecord::Kind::Recognized:
+            out += "RECOGNIZED: Text=" + record.Text + (record.Untranslated ? " (text could not be translated)\n" : "\n");
+            break;
+        case ResultRecord::Kind::NoMatch:
+            out += "NOMATCH: Speech could not be recognized.\n";
+            break;
+        case ResultRecord::Kind::Canceled:
+            out += "CANCELED: Reason=" + to_string(record.CancellationReason) + '\n';
+            if (record.CancellationReason == static_cast<int>(CancellationReason::Error))
+            {
+                out += "CANCELED: ErrorCode=" + to_string(record.ErrorCode) + '\n';
+                out += "CANCELED: ErrorDetails=" + record.Text + '\n';
+                out += "CANCELED: Did you update the subscription info?\n";
+            }
+            break;
+        }
+
+        for (size_t i = 0; i < record.TranslationCount; i++)
+        {
+            out += "  Translated into '" + record.Translations[i].first + "': " + record.Translations[i].second + '\n';
+        }
+    });
+
     // Creates a translation recognizer using microphone as audio input.
     auto recognizer = TranslationRecognizer::FromConfig(config);
 
     // Subscribes to events.
-    recognizer->Recognizing.Connect([](const TranslationRecognitionEventArgs& e)
+    recognizer->Recognizing.Connect([&dispatcher](const TranslationRecognitionEventArgs& e)
     {
-        cout << "Recognizing:" << e.Result->Text << std::endl;
-        for (const auto& it : e.Result->Translations)
-        {
-            cout << "  Translated into '" << it.first.c_str() << "': " << it.second.c_str() << std::endl;
-        }
+        dispatcher.Publish(ResultRecord::Kind::Recognizing, e.Result);
     });
 
-    recognizer->Recognized.Connect([](const TranslationRecognitionEventArgs& e)
+    recognizer->Recognized.Connect([&dispatcher](const TranslationRecognitionEventArgs& e)
     {
-        if (e.Result->Reason == ResultReason::TranslatedSpeech)
-        {
-            cout << "RECOGNIZED: Text=" << e.Result->Text << std::endl;
-        }
-        else if (e.Result->Reason == ResultReason::RecognizedSpeech)
-        {
-            cout << "RECOGNIZED: Text=" << e.Result->Text << " (text could not be translated)" << std::endl;
-        }
-        else if (e.Result->Reason == ResultReason::NoMatch)
-        {
-            cout << "NOMATCH: Speech could not be recognized." << std::endl;
-        }
-
-        for (const auto& it : e.Result->Translations)
-        {
-            cout << "  Translated into '" << it.first.c_str() << "': " << it.second.c_str() << std::endl;
-        }
+        dispatcher.Publish(ResultRecord::Kind::Recognized, e.Result);
     });
 
-    recognizer->Canceled.Connect([](const TranslationRecognitionCanceledEventArgs& e)
+    recognizer->Canceled.Connect([&dispatcher](const TranslationRecognitionCanceledEventArgs& e)
     {
-        cout << "CANCELED: Reason=" << (int)e.Reason << std::endl;
-        if (e.Reason == CancellationReason::Error)
-        {
-            cout << "CANCELED: ErrorCode=" << (int)e.ErrorCode << std::endl;
-            cout << "CANCELED: ErrorDetails=" << e.ErrorDetails << std::endl;
-            cout << "CANCELED: Did you update the subscription info?" << std::endl;
-        }
+        dispatcher.PublishCanceled(e.Reason, e.ErrorCode, e.ErrorDetails);
     });
 
     recognizer->Synthesizing.Connect([](const TranslationSynthesisEventArgs& e)
@@ -153,4 +160,8 @@ void TranslationContinuousRecognition()
 
     // Stops recognition.
     recognizer->StopContinuousRecognitionAsync().get();
+
+    // Prints the remaining results.
+    dispatcher.Stop();
+    cout << "Result dispatcher: " << dispatcher.GetStatistics().ToString() << std::endl;
 }
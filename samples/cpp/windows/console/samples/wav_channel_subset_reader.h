@@ -0,0 +1,129 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "channel_interleaver.h"
+#include "wav_file_reader.h"
+
+// A view of selected channels of a 16 bit PCM wave file, e.g. the microphone channels 0 to 6 and the reference
+// channel of an 8-channel recording, for consumers that need only some of the channels.
+//
+// The audio is read through the WavFileReader (without copying when it is memory mapped), de-interleaved into one
+// plane per channel, and either handed out planar or re-interleaved for the selected channels only.
+class WavChannelSubsetReader final
+{
+public:
+    // channels are the indices of the channels to read, in the order in which they are handed out; a channel may
+    // be selected more than once. framesPerRead limits the frames converted at a time.
+    WavChannelSubsetReader(WavFileReader& reader, const std::vector<uint16_t>& channels, size_t framesPerRead = 1600)
+        : m_reader(reader), m_framesPerRead(framesPerRead)
+    {
+        const auto& source = reader.GetFormat();
+        if (source.BitsPerSample != 16)
+        {
+            throw std::invalid_argument("Only 16 bit PCM audio can be split into channels.");
+        }
+        if (channels.empty() || framesPerRead == 0)
+        {
+            throw std::invalid_argument("At least one channel must be selected.");
+        }
+        for (auto channel : channels)
+        {
+            if (channel >= source.Channels)
+            {
+                throw std::invalid_argument("The selected channel does not exist in the audio file.");
+            }
+        }
+
+        m_isAllChannels = channels.size() == source.Channels;
+        for (size_t i = 0; i < channels.size() && m_isAllChannels; i++)
+        {
+            m_isAllChannels = channels[i] == i;
+        }
+
+        m_format = source;
+        m_format.Channels = static_cast<uint16_t>(channels.size());
+        m_format.BlockAlign = static_cast<uint16_t>(channels.size() * sizeof(int16_t));
+        m_format.AvgBytesPerSec = m_format.SamplesPerSec * m_format.BlockAlign;
+
+        m_planes.resize(source.Channels, std::vector<int16_t>(framesPerRead));
+        for (auto& plane : m_planes)
+        {
+            m_planePointers.push_back(plane.data());
+        }
+        for (auto channel : channels)
+        {
+            m_selectedPlanes.push_back(m_planes[channel].data());
+        }
+    }
+
+    WavChannelSubsetReader(const WavChannelSubsetReader&) = delete;
+    WavChannelSubsetReader& operator=(const WavChannelSubsetReader&) = delete;
+
+    // The format of the selected channels, e.g. for AudioStreamFormat::GetWaveFormatPCM().
+    const WavFileReader::WAVEFORMAT& GetFormat() const
+    {
+        return m_format;
+    }
+
+    // Reads the selected channels interleaved, like WavFileReader::Read(); size is rounded down to whole frames.
+    int Read(uint8_t* dataBuffer, uint32_t size)
+    {
+        if (m_isAllChannels)
+        {
+            // Nothing to select; the frames are copied as they are.
+            return m_reader.Read(dataBuffer, size - size % m_format.BlockAlign);
+        }
+
+        size_t frames = size / m_format.BlockAlign;
+        size_t done = 0;
+        while (done < frames)
+        {
+            auto read = ReadAllPlanes((std::min)(frames - done, m_framesPerRead));
+            if (read == 0)
+            {
+                break;
+            }
+            ChannelInterleaver::Interleave(m_selectedPlanes.data(), read, m_format.Channels,
+                reinterpret_cast<int16_t*>(dataBuffer) + done * m_format.Channels);
+            done += read;
+        }
+        return static_cast<int>(done * m_format.BlockAlign);
+    }
+
+    // Reads up to framesPerRead frames and returns the number of frames read, 0 at the end of the audio. planes
+    // receives one plane per selected channel; the memory is owned by the reader and stays valid until the next read.
+    size_t ReadPlanar(std::vector<const int16_t*>& planes)
+    {
+        auto read = ReadAllPlanes(m_framesPerRead);
+        planes.assign(m_selectedPlanes.begin(), m_selectedPlanes.end());
+        return read;
+    }
+
+private:
+    // Reads up to maxFrames frames and de-interleaves all channels of the file into m_planes.
+    size_t ReadAllPlanes(size_t maxFrames)
+    {
+        auto blockAlign = m_reader.GetFormat().BlockAlign;
+        auto view = m_reader.ReadView(static_cast<uint32_t>(maxFrames * blockAlign));
+        // A trailing partial frame is dropped.
+        size_t frames = view.Size / blockAlign;
+        ChannelInterleaver::Deinterleave(reinterpret_cast<const int16_t*>(view.Data), frames, m_reader.GetFormat().Channels, m_planePointers.data());
+        return frames;
+    }
+
+    WavFileReader& m_reader;
+    size_t m_framesPerRead;
+    bool m_isAllChannels = false;
+    WavFileReader::WAVEFORMAT m_format;
+
+    std::vector<std::vector<int16_t>> m_planes;
+    std::vector<int16_t*> m_planePointers;
+    std::vector<const int16_t*> m_selectedPlanes;
+};
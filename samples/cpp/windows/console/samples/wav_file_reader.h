@@ -5,21 +5,59 @@
 #pragma once
 
 #include <speechapi_cxx.h>
+#include <cstring>
 #include <fstream>
+#include <vector>
+#include "memory_mapped_file.h"
+
+// A range of audio bytes handed out by WavFileReader::ReadView().
+// The memory is owned by the reader and stays valid until the next read or Close().
+struct WavDataView
+{
+    const uint8_t* Data;
+    uint32_t Size;
+};
 
 // Helper functions
 class WavFileReader final
 {
 public:
+    // How the audio file is accessed.
+    enum class AccessMode
+    {
+        // Maps the file into memory and hands out views into the data chunk.
+        // Falls back to Stream if the file cannot be mapped.
+        MemoryMapped,
+        // Reads the file through std::fstream.
+        Stream
+    };
+
+    // The format structure expected in wav files.
+    struct WAVEFORMAT
+    {
+        uint16_t FormatTag;        // format type.
+        uint16_t Channels;         // number of channels (i.e. mono, stereo...).
+        uint32_t SamplesPerSec;    // sample rate.
+        uint32_t AvgBytesPerSec;   // for buffer estimation.
+        uint16_t BlockAlign;       // block size of data.
+        uint16_t BitsPerSample;    // Number of bits per sample of mono data.
+    };
 
     // Constructor that creates an input stream from a file.
-    WavFileReader(const std::string& audioFileName)
+    WavFileReader(const std::string& audioFileName, AccessMode accessMode = AccessMode::MemoryMapped)
     {
         if (audioFileName.empty())
         {
             throw std::invalid_argument("Audio filename is empty");
         }
 
+        if (accessMode == AccessMode::MemoryMapped && m_mappedFile.Open(audioFileName))
+        {
+            // Get audio format and the data chunk from the mapped file.
+            GetFormatFromMappedFile();
+            return;
+        }
+
         std::ios_base::openmode mode = std::ios_base::binary | std::ios_base::in;
         m_fs.open(audioFileName, mode);
         if (!m_fs.good())
@@ -31,8 +69,27 @@ public:
         GetFormatFromWavFile();
     }
 
+    // Returns true if the audio data is read from a memory mapping rather than through std::fstream.
+    bool IsMemoryMapped() const
+    {
+        return m_mappedFile.IsOpen();
+    }
+
+    // Returns the audio format read from the file header.
+    const WAVEFORMAT& GetFormat() const
+    {
+        return m_formatHeader;
+    }
+
     int Read(uint8_t* dataBuffer, uint32_t size)
     {
+        if (IsMemoryMapped())
+        {
+            auto view = ReadView(size);
+            memcpy(dataBuffer, view.Data, view.Size);
+            return (int)view.Size;
+        }
+
         if (m_fs.eof())
             // returns 0 to indicate that the stream reaches end.
             return 0;
@@ -45,8 +102,36 @@ public:
             return (int)m_fs.gcount();
     }
 
+    // Returns the next audio bytes, but no more than 'size' bytes, without copying them when the
+    // file is memory mapped. In Stream mode the bytes are read into a buffer owned by the reader.
+    // Returns an empty view when the stream reaches end or on read error.
+    WavDataView ReadView(uint32_t size)
+    {
+        if (IsMemoryMapped())
+        {
+            size_t remaining = m_dataEnd - m_position;
+            uint32_t viewSize = remaining < size ? (uint32_t)remaining : size;
+            WavDataView view{ m_mappedFile.Data() + m_position, viewSize };
+            m_position += viewSize;
+            return view;
+        }
+
+        if (m_viewBuffer.size() < size)
+        {
+            m_viewBuffer.resize(size);
+        }
+        int read = Read(m_viewBuffer.data(), size);
+        return WavDataView{ m_viewBuffer.data(), (uint32_t)read };
+    }
+
     void Close()
     {
+        if (IsMemoryMapped())
+        {
+            m_mappedFile.Close();
+            m_position = m_dataEnd = 0;
+            return;
+        }
         m_fs.close();
     }
 
@@ -129,6 +214,71 @@ private:
         m_fs.exceptions(std::ifstream::goodbit);
     }
 
+    // Get format data and the bounds of the data chunk from a memory-mapped wav file.
+    void GetFormatFromMappedFile()
+    {
+        const uint8_t* data = m_mappedFile.Data();
+        size_t size = m_mappedFile.Size();
+        size_t position = 0;
+
+        // The RIFF tag, the RIFF chunk size and the 'WAVE' tag.
+        if (size < tagBufferSize + chunkSizeBufferSize + chunkTypeBufferSize)
+        {
+            throw std::runtime_error("Unexpected end of file or error when reading audio file.");
+        }
+        if (memcmp(data, "RIFF", tagBufferSize) != 0)
+        {
+            throw std::runtime_error("Invalid file header, tag 'RIFF' is expected.");
+        }
+        position += tagBufferSize + chunkSizeBufferSize;
+        if (memcmp(data + position, "WAVE", chunkTypeBufferSize) != 0)
+        {
+            throw std::runtime_error("Invalid file header, tag 'WAVE' is expected.");
+        }
+        position += chunkTypeBufferSize;
+
+        while (size - position >= chunkTypeBufferSize + chunkSizeBufferSize)
+        {
+            const uint8_t* chunkType = data + position;
+            uint32_t chunkSize = ToChunkSize(data + position + chunkTypeBufferSize);
+            position += chunkTypeBufferSize + chunkSizeBufferSize;
+            size_t remaining = size - position;
+
+            if (memcmp(chunkType, "fmt ", chunkTypeBufferSize) == 0)
+            {
+                if (remaining < sizeof(m_formatHeader))
+                {
+                    throw std::runtime_error("Unexpected end of file or error when reading audio file.");
+                }
+                memcpy(&m_formatHeader, data + position, sizeof(m_formatHeader));
+            }
+            else if (memcmp(chunkType, "data", chunkTypeBufferSize) == 0)
+            {
+                // Streamed wav files may carry a zero or oversized data chunk size; read to the end of file then.
+                m_position = position;
+                m_dataEnd = (chunkSize == 0 || chunkSize > remaining) ? size : position + chunkSize;
+                return;
+            }
+
+            if (chunkSize > remaining)
+            {
+                break;
+            }
+            position += chunkSize;
+        }
+
+        throw std::runtime_error("Did not find data chunk.");
+    }
+
+    // chunk size is little endian
+    static uint32_t ToChunkSize(const uint8_t* chunkSizeBuffer)
+    {
+        return ((uint32_t)chunkSizeBuffer[3] << 24) |
+            ((uint32_t)chunkSizeBuffer[2] << 16) |
+            ((uint32_t)chunkSizeBuffer[1] << 8) |
+            (uint32_t)chunkSizeBuffer[0];
+    }
+
     void ReadChunkTypeAndSize(char* chunkType, uint32_t* chunkSize)
     {
         // Read the chunk type
@@ -138,25 +288,16 @@ private:
         uint8_t chunkSizeBuffer[chunkSizeBufferSize];
         m_fs.read((char*)chunkSizeBuffer, chunkSizeBufferSize);
 
-        // chunk size is little endian
-        *chunkSize = ((uint32_t)chunkSizeBuffer[3] << 24) |
-            ((uint32_t)chunkSizeBuffer[2] << 16) |
-            ((uint32_t)chunkSizeBuffer[1] << 8) |
-            (uint32_t)chunkSizeBuffer[0];
+        *chunkSize = ToChunkSize(chunkSizeBuffer);
     }
 
-    // The format structure expected in wav files.
-    struct WAVEFORMAT
-    {
-        uint16_t FormatTag;        // format type.
-        uint16_t Channels;         // number of channels (i.e. mono, stereo...).
-        uint32_t SamplesPerSec;    // sample rate.
-        uint32_t AvgBytesPerSec;   // for buffer estimation.
-        uint16_t BlockAlign;       // block size of data.
-        uint16_t BitsPerSample;    // Number of bits per sample of mono data.
-    } m_formatHeader;
+    WAVEFORMAT m_formatHeader;
     static_assert(sizeof(m_formatHeader) == 16, "unexpected size of m_formatHeader");
 
-private:
     std::fstream m_fs;
+    std::vector<uint8_t> m_viewBuffer;
+
+    MemoryMappedFile m_mappedFile;
+    size_t m_position = 0;
+    size_t m_dataEnd = 0;
 };
@@ -0,0 +1,247 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Index of the word boundaries of a synthesized text, to seek in its audio by time or by text position.
+//
+// The index is collected from the WordBoundary events during synthesis, sorted once by Seal(), and then answers
+// lookups by binary search in O(log n). It is stored next to the audio in a small binary file, so that a player
+// (e.g. for captions or word highlighting) can read only the byte range of a word from the audio, e.g. with
+// AudioDataStream::SetPosition(), instead of decoding from the start.
+//
+// Byte positions are computed for raw PCM audio (e.g. SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm),
+// whose byte rate and frame size are stored in the index.
+class WordBoundaryIndex final
+{
+public:
+    struct Word
+    {
+        // In ticks of 100 ns from the start of the audio, like SpeechSynthesisWordBoundaryEventArgs::AudioOffset.
+        uint64_t AudioOffset = 0;
+        uint32_t TextOffset = 0;
+        uint32_t WordLength = 0;
+    };
+
+    // A range [Begin, End) of bytes in the audio.
+    struct ByteRange
+    {
+        uint32_t Begin = 0;
+        uint32_t End = 0;
+    };
+
+    // bytesPerSecond and blockAlign describe the raw PCM audio, e.g. 32000 and 2 for 16 kHz 16 bit mono.
+    WordBoundaryIndex(uint32_t bytesPerSecond, uint16_t blockAlign)
+        : m_bytesPerSecond(bytesPerSecond), m_blockAlign(blockAlign)
+    {
+        if (bytesPerSecond == 0 || blockAlign == 0)
+        {
+            throw std::invalid_argument("The byte rate and the frame size must be greater than 0.");
+        }
+    }
+
+    // Adds a word; call from the WordBoundary event handler. Thread-safe.
+    void Add(uint64_t audioOffset, uint32_t textOffset, uint32_t wordLength)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Word word;
+        word.AudioOffset = audioOffset;
+        word.TextOffset = textOffset;
+        word.WordLength = wordLength;
+        m_words.push_back(word);
+        m_sealed = false;
+    }
+
+    // Starts a new index, e.g. for the next request.
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_words.clear();
+        m_byText.clear();
+        m_sealed = false;
+    }
+
+    // Sorts the words for lookups; call once the synthesis completed. totalBytes is the size of the audio,
+    // which ends the range of the last word.
+    void Seal(uint32_t totalBytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::stable_sort(m_words.begin(), m_words.end(), [](const Word& a, const Word& b) { return a.AudioOffset < b.AudioOffset; });
+        m_totalBytes = totalBytes;
+        SortByText();
+        m_sealed = true;
+    }
+
+    size_t Size() const
+    {
+        return m_words.size();
+    }
+
+    WordBoundaryIndex(const WordBoundaryIndex&) = delete;
+    WordBoundaryIndex& operator=(const WordBoundaryIndex&) = delete;
+
+    const Word& operator[](size_t index) const
+    {
+        return m_words.at(index);
+    }
+
+    // The index of the word that is spoken at the audio offset (in ticks), or Size() before the first word.
+    size_t FindByAudioOffset(uint64_t audioOffset) const
+    {
+        RequireSealed();
+        auto next = std::upper_bound(m_words.begin(), m_words.end(), audioOffset,
+            [](uint64_t offset, const Word& word) { return offset < word.AudioOffset; });
+        return next == m_words.begin() ? m_words.size() : static_cast<size_t>(next - m_words.begin()) - 1;
+    }
+
+    // The index of the word that contains the text offset, or Size() if no word does.
+    size_t FindByTextOffset(uint32_t textOffset) const
+    {
+        RequireSealed();
+        auto next = std::upper_bound(m_byText.begin(), m_byText.end(), textOffset,
+            [this](uint32_t offset, uint32_t index) { return offset < m_words[index].TextOffset; });
+        if (next == m_byText.begin())
+        {
+            return m_words.size();
+        }
+        auto index = *(next - 1);
+        const auto& word = m_words[index];
+        return textOffset < word.TextOffset + word.WordLength ? index : m_words.size();
+    }
+
+    // The bytes of the audio from the start of the word to the start of the next word, or to the end of the audio
+    // for the last word.
+    ByteRange BytesOf(size_t index) const
+    {
+        RequireSealed();
+        ByteRange range;
+        range.Begin = BytePosition(m_words.at(index).AudioOffset);
+        range.End = index + 1 < m_words.size() ? BytePosition(m_words[index + 1].AudioOffset) : m_totalBytes;
+        range.End = (std::max)(range.Begin, range.End);
+        return range;
+    }
+
+    // File layout, little endian: "WBIX", version, byte rate, frame size, total bytes, word count, then per word
+    // the audio offset (8 bytes), text offset and word length (4 bytes each).
+    void Save(const std::string& fileName) const
+    {
+        RequireSealed();
+        std::ofstream file(fileName, std::ios::binary);
+        file.write("WBIX", 4);
+        WriteLittleEndian(file, Version, 4);
+        WriteLittleEndian(file, m_bytesPerSecond, 4);
+        WriteLittleEndian(file, m_blockAlign, 2);
+        WriteLittleEndian(file, m_totalBytes, 4);
+        WriteLittleEndian(file, m_words.size(), 4);
+        for (const auto& word : m_words)
+        {
+            WriteLittleEndian(file, word.AudioOffset, 8);
+            WriteLittleEndian(file, word.TextOffset, 4);
+            WriteLittleEndian(file, word.WordLength, 4);
+        }
+        if (!file)
+        {
+            throw std::runtime_error("Failed to write the word boundary index " + fileName);
+        }
+    }
+
+    static std::unique_ptr<WordBoundaryIndex> Load(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        char magic[4];
+        if (!file.read(magic, 4) || std::string(magic, 4) != "WBIX" || ReadLittleEndian(file, 4) != Version)
+        {
+            throw std::runtime_error("Not a word boundary index: " + fileName);
+        }
+
+        auto bytesPerSecond = static_cast<uint32_t>(ReadLittleEndian(file, 4));
+        auto blockAlign = static_cast<uint16_t>(ReadLittleEndian(file, 2));
+        std::unique_ptr<WordBoundaryIndex> index(new WordBoundaryIndex(bytesPerSecond, blockAlign));
+        index->m_totalBytes = static_cast<uint32_t>(ReadLittleEndian(file, 4));
+        auto count = ReadLittleEndian(file, 4);
+        for (uint64_t i = 0; i < count && file; i++)
+        {
+            Word word;
+            word.AudioOffset = ReadLittleEndian(file, 8);
+            word.TextOffset = static_cast<uint32_t>(ReadLittleEndian(file, 4));
+            word.WordLength = static_cast<uint32_t>(ReadLittleEndian(file, 4));
+            index->m_words.push_back(word);
+        }
+        if (!file)
+        {
+            throw std::runtime_error("The word boundary index is truncated: " + fileName);
+        }
+
+        // The words are stored sorted by audio offset.
+        index->SortByText();
+        index->m_sealed = true;
+        return index;
+    }
+
+private:
+    static const uint32_t Version = 1;
+
+    void RequireSealed() const
+    {
+        if (!m_sealed)
+        {
+            throw std::logic_error("The word boundary index must be sealed before lookups.");
+        }
+    }
+
+    // Text offsets usually grow with the audio offsets, but not necessarily for SSML, hence a separate order.
+    void SortByText()
+    {
+        m_byText.resize(m_words.size());
+        for (uint32_t i = 0; i < m_byText.size(); i++)
+        {
+            m_byText[i] = i;
+        }
+        std::stable_sort(m_byText.begin(), m_byText.end(), [this](uint32_t a, uint32_t b) { return m_words[a].TextOffset < m_words[b].TextOffset; });
+    }
+
+    // Rounds down to a whole frame, so that a range never starts in the middle of a sample.
+    uint32_t BytePosition(uint64_t audioOffset) const
+    {
+        auto bytes = audioOffset * m_bytesPerSecond / 10000000;
+        bytes -= bytes % m_blockAlign;
+        return static_cast<uint32_t>((std::min)(bytes, static_cast<uint64_t>(m_totalBytes)));
+    }
+
+    static void WriteLittleEndian(std::ostream& stream, uint64_t value, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            stream.put(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    static uint64_t ReadLittleEndian(std::istream& stream, int size)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < size; i++)
+        {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(stream.get())) << (8 * i);
+        }
+        return value;
+    }
+
+    uint32_t m_bytesPerSecond;
+    uint16_t m_blockAlign;
+    uint32_t m_totalBytes = 0;
+
+    std::mutex m_mutex;
+    std::vector<Word> m_words;
+    std::vector<uint32_t> m_byText;
+    bool m_sealed = false;
+};